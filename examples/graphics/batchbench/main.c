@@ -0,0 +1,361 @@
+/*
+ * PSn00bSDK batched GTE function benchmark
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * This example measures how many CPU cycles RotTransPersN(), ApplyMatrixN(),
+ * NormalColorN() and NormalizeN() take to process an array of vectors,
+ * compared to processing each vector with a separate function call. libpsn00b
+ * has no single vector equivalents of the first three functions (which are
+ * named RotTransPers(), ApplyMatrixSV() and NormalColor() in the official
+ * SDK), so they are implemented below using inline_c.h macros. NormalizeN() is
+ * compared against VectorNormalS(). Hardware timer 2 is used as a cycle
+ * counter. The outputs of both versions are also compared, as they are meant
+ * to be identical.
+ *
+ * The results are displayed on screen and printed to the TTY.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <psxgpu.h>
+#include <psxgte.h>
+#include <psxetc.h>
+#include <psxapi.h>
+#include <inline_c.h>
+#include <hwregs_c.h>
+
+/* Display/GPU context utilities */
+
+#define SCREEN_XRES 320
+#define SCREEN_YRES 240
+
+#define BGCOLOR_R 48
+#define BGCOLOR_G 24
+#define BGCOLOR_B  0
+
+typedef struct {
+	DISPENV disp;
+	DRAWENV draw;
+} Framebuffer;
+
+typedef struct {
+	Framebuffer db[2];
+	int         db_active;
+} RenderContext;
+
+void init_context(RenderContext *ctx) {
+	Framebuffer *db;
+
+	ResetGraph(0);
+	ctx->db_active = 0;
+
+	db = &(ctx->db[0]);
+	SetDefDispEnv(&(db->disp),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	db = &(ctx->db[1]);
+	SetDefDispEnv(&(db->disp), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	PutDrawEnv(&(db->draw));
+	//PutDispEnv(&(db->disp));
+
+	// Create a text stream at the top of the screen.
+	FntLoad(960, 0);
+	FntOpen(8, 16, 304, 208, 2, 1024);
+}
+
+void display(RenderContext *ctx) {
+	Framebuffer *db;
+
+	DrawSync(0);
+	VSync(0);
+	ctx->db_active ^= 1;
+
+	db = &(ctx->db[ctx->db_active]);
+	PutDrawEnv(&(db->draw));
+	PutDispEnv(&(db->disp));
+	SetDispMask(1);
+}
+
+/* Cycle counter */
+
+// Timer 2 runs at 1/8 of the CPU clock and is only 16 bits wide, so its
+// overflow IRQ is used to extend it.
+static volatile uint32_t timer_overflows;
+
+static void timer2_handler(void) {
+	timer_overflows++;
+}
+
+static void start_timer(void) {
+	timer_overflows = 0;
+	TIMER_CTRL(2)   = 0x0260; // CLK/8 input, repeated IRQ on overflow
+}
+
+// Returns the number of CPU cycles elapsed since start_timer() was called.
+static uint32_t read_timer(void) {
+	uint32_t overflows, value;
+
+	// Read the counter again if it overflowed while it was being read.
+	do {
+		overflows = timer_overflows;
+		value     = TIMER_VALUE(2);
+	} while (overflows != timer_overflows);
+
+	return ((overflows << 16) | value) * 8;
+}
+
+/* Single vector functions */
+
+// These are marked as noinline to measure the overhead of calling a function
+// for each vector, as with the official SDK's functions.
+static int __attribute__((noinline)) rot_trans_pers(
+	SVECTOR *v0, DVECTOR *v1, uint16_t *sz
+) {
+	uint32_t z;
+	int      flag;
+
+	gte_ldv0(v0);
+	gte_rtps();
+	gte_stsxy(v1);
+	gte_stsz(&z);
+	gte_stflg(&flag);
+
+	*sz = z;
+	return flag;
+}
+
+static SVECTOR *__attribute__((noinline)) apply_matrix_sv(
+	MATRIX *m, SVECTOR *v0, SVECTOR *v1
+) {
+	gte_SetRotMatrix(m);
+	gte_ldv0(v0);
+	gte_rtv0();
+	gte_stsv(v1);
+
+	return v1;
+}
+
+static void __attribute__((noinline)) normal_color(SVECTOR *v0, CVECTOR *v1) {
+	gte_ldv0(v0);
+	gte_ncs();
+	gte_strgb(v1);
+}
+
+/* Benchmark */
+
+// Not a multiple of 3, so the batched functions' tail loops are also used.
+#define NUM_VECTORS	1000
+
+typedef struct {
+	const char *name;
+	uint32_t   batch_cycles, single_cycles;
+	int        mismatches;
+} BenchResult;
+
+static SVECTOR  vectors[NUM_VECTORS];
+static VECTOR   raw_normals[NUM_VECTORS];
+static SVECTOR  normals[NUM_VECTORS];
+static DVECTOR  batch_xy[NUM_VECTORS], single_xy[NUM_VECTORS];
+static uint16_t batch_sz[NUM_VECTORS], single_sz[NUM_VECTORS];
+static SVECTOR  batch_sv[NUM_VECTORS], single_sv[NUM_VECTORS];
+static CVECTOR  batch_rgb[NUM_VECTORS], single_rgb[NUM_VECTORS];
+
+static MATRIX apply_mtx;
+
+static MATRIX color_mtx = {
+	.m = {
+		{ ONE, 0, 0 },
+		{ 0, ONE, 0 },
+		{ 0, 0, ONE }
+	}
+};
+
+static MATRIX light_mtx = {
+	.m = {
+		{ -2048, -2048, -2048 },
+		{  2048, -2048,     0 },
+		{     0,     0,     0 }
+	}
+};
+
+static void setup_gte(void) {
+	SVECTOR rot = { 256, 512, 0 };
+	VECTOR  pos = { 0, 0, 2000 };
+	MATRIX  mtx;
+	CVECTOR color = { 128, 128, 128, 0 };
+
+	InitGeom();
+	gte_SetGeomOffset(SCREEN_XRES / 2, SCREEN_YRES / 2);
+	gte_SetGeomScreen(SCREEN_XRES / 2);
+	gte_SetBackColor(32, 32, 32);
+	gte_SetColorMatrix(&color_mtx);
+	gte_SetLightMatrix(&light_mtx);
+	gte_ldrgb(&color);
+
+	RotMatrix(&rot, &mtx);
+	TransMatrix(&mtx, &pos);
+	gte_SetRotMatrix(&mtx);
+	gte_SetTransMatrix(&mtx);
+
+	rot.vx = 1024;
+	rot.vz = 300;
+	RotMatrix(&rot, &apply_mtx);
+}
+
+// Counts how many elements differ between two arrays of the given element
+// size.
+static int count_mismatches(const void *a, const void *b, size_t size) {
+	const uint8_t *pa = (const uint8_t *) a;
+	const uint8_t *pb = (const uint8_t *) b;
+	int           count = 0;
+
+	for (int i = 0; i < NUM_VECTORS; i++, pa += size, pb += size) {
+		if (memcmp(pa, pb, size))
+			count++;
+	}
+
+	return count;
+}
+
+static void bench_rot_trans_pers(BenchResult *result) {
+	start_timer();
+	RotTransPersN(vectors, batch_xy, batch_sz, NUM_VECTORS);
+	result->batch_cycles = read_timer();
+
+	start_timer();
+	for (int i = 0; i < NUM_VECTORS; i++)
+		rot_trans_pers(&vectors[i], &single_xy[i], &single_sz[i]);
+	result->single_cycles = read_timer();
+
+	result->mismatches =
+		count_mismatches(batch_xy, single_xy, sizeof(DVECTOR)) +
+		count_mismatches(batch_sz, single_sz, sizeof(uint16_t));
+}
+
+static void bench_apply_matrix(BenchResult *result) {
+	MATRIX saved;
+
+	// Both functions replace the GTE rotation matrix, which is restored
+	// afterwards.
+	gte_ReadRotMatrix(&saved);
+
+	start_timer();
+	ApplyMatrixN(&apply_mtx, vectors, batch_sv, NUM_VECTORS);
+	result->batch_cycles = read_timer();
+
+	start_timer();
+	for (int i = 0; i < NUM_VECTORS; i++)
+		apply_matrix_sv(&apply_mtx, &vectors[i], &single_sv[i]);
+	result->single_cycles = read_timer();
+
+	gte_SetRotMatrix(&saved);
+
+	result->mismatches = count_mismatches(batch_sv, single_sv, 6);
+}
+
+static void bench_normal_color(BenchResult *result) {
+	start_timer();
+	NormalColorN(normals, batch_rgb, NUM_VECTORS);
+	result->batch_cycles = read_timer();
+
+	start_timer();
+	for (int i = 0; i < NUM_VECTORS; i++)
+		normal_color(&normals[i], &single_rgb[i]);
+	result->single_cycles = read_timer();
+
+	result->mismatches = count_mismatches(batch_rgb, single_rgb, sizeof(CVECTOR));
+}
+
+static void bench_normalize(BenchResult *result) {
+	start_timer();
+	NormalizeN(raw_normals, batch_sv, NUM_VECTORS);
+	result->batch_cycles = read_timer();
+
+	start_timer();
+	for (int i = 0; i < NUM_VECTORS; i++)
+		VectorNormalS(&raw_normals[i], &single_sv[i]);
+	result->single_cycles = read_timer();
+
+	result->mismatches = count_mismatches(batch_sv, single_sv, 6);
+}
+
+/* Main */
+
+#define NUM_BENCHES 4
+
+static RenderContext ctx;
+
+static BenchResult results[NUM_BENCHES] = {
+	{ .name = "ROTTRANSPERSN" },
+	{ .name = "APPLYMATRIXN" },
+	{ .name = "NORMALCOLORN" },
+	{ .name = "NORMALIZEN" }
+};
+
+int main(int argc, const char* argv[]) {
+	init_context(&ctx);
+	setup_gte();
+
+	EnterCriticalSection();
+	InterruptCallback(IRQ_TIMER2, &timer2_handler);
+	ExitCriticalSection();
+
+	// Generate random vertices and normals. The normals are generated as raw
+	// vectors and normalized once to get the inputs for NormalColorN().
+	srand(1);
+
+	for (int i = 0; i < NUM_VECTORS; i++) {
+		vectors[i].vx = (rand() % 2048) - 1024;
+		vectors[i].vy = (rand() % 2048) - 1024;
+		vectors[i].vz = (rand() % 2048) - 1024;
+
+		raw_normals[i].vx = (rand() % 65536) - 32768;
+		raw_normals[i].vy = (rand() % 65536) - 32768;
+		raw_normals[i].vz = (rand() % 65536) - 32768;
+
+		VectorNormalS(&raw_normals[i], &normals[i]);
+	}
+
+	bench_rot_trans_pers(&results[0]);
+	bench_apply_matrix(&results[1]);
+	bench_normal_color(&results[2]);
+	bench_normalize(&results[3]);
+
+	for (int i = 0; i < NUM_BENCHES; i++)
+		printf(
+			"%s: batched %d cycles, per-vector %d cycles, %d mismatches\n",
+			results[i].name, results[i].batch_cycles,
+			results[i].single_cycles, results[i].mismatches
+		);
+
+	while (1) {
+		FntPrint(-1, "BATCHED GTE FUNCTION BENCHMARK\n");
+		FntPrint(-1, "(CPU CYCLES FOR %d VECTORS)\n\n", NUM_VECTORS);
+
+		for (int i = 0; i < NUM_BENCHES; i++) {
+			const BenchResult *result = &results[i];
+			int speedup = (result->single_cycles * 100) / result->batch_cycles;
+
+			FntPrint(-1, "%s:\n", result->name);
+			FntPrint(-1, " BATCHED:    %d\n", result->batch_cycles);
+			FntPrint(-1, " PER-VECTOR: %d\n", result->single_cycles);
+			FntPrint(-1, " SPEEDUP:    %d.%02dX, %d MISMATCHES\n\n",
+				speedup / 100, speedup % 100, result->mismatches);
+		}
+
+		FntFlush(-1);
+		display(&ctx);
+	}
+
+	return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * PSn00bSDK rotation matrix benchmark
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * This example measures how many CPU cycles RotMatrix() takes to build a
+ * rotation matrix, compared to the previous implementation which built the
+ * three axis rotation matrices and multiplied them together using the GTE
+ * (included below as old_rot_matrix()). Hardware timer 2 is used as a cycle
+ * counter. Both implementations are also run on the same angles and their
+ * outputs compared, as they are meant to return identical matrices.
+ *
+ * The results are displayed on screen and printed to the TTY.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <psxgpu.h>
+#include <psxgte.h>
+#include <psxetc.h>
+#include <psxapi.h>
+#include <hwregs_c.h>
+
+/* Display/GPU context utilities */
+
+#define SCREEN_XRES 320
+#define SCREEN_YRES 240
+
+#define BGCOLOR_R 48
+#define BGCOLOR_G 24
+#define BGCOLOR_B  0
+
+typedef struct {
+	DISPENV disp;
+	DRAWENV draw;
+} Framebuffer;
+
+typedef struct {
+	Framebuffer db[2];
+	int         db_active;
+} RenderContext;
+
+void init_context(RenderContext *ctx) {
+	Framebuffer *db;
+
+	ResetGraph(0);
+	ctx->db_active = 0;
+
+	db = &(ctx->db[0]);
+	SetDefDispEnv(&(db->disp),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	db = &(ctx->db[1]);
+	SetDefDispEnv(&(db->disp), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	PutDrawEnv(&(db->draw));
+	//PutDispEnv(&(db->disp));
+
+	// Create a text stream at the top of the screen.
+	FntLoad(960, 0);
+	FntOpen(8, 16, 304, 208, 2, 1024);
+}
+
+void display(RenderContext *ctx) {
+	Framebuffer *db;
+
+	DrawSync(0);
+	VSync(0);
+	ctx->db_active ^= 1;
+
+	db = &(ctx->db[ctx->db_active]);
+	PutDrawEnv(&(db->draw));
+	PutDispEnv(&(db->disp));
+	SetDispMask(1);
+}
+
+/* Cycle counter */
+
+// Timer 2 runs at 1/8 of the CPU clock and is only 16 bits wide, so its
+// overflow IRQ is used to extend it.
+static volatile uint32_t timer_overflows;
+
+static void timer2_handler(void) {
+	timer_overflows++;
+}
+
+static void start_timer(void) {
+	timer_overflows = 0;
+	TIMER_CTRL(2)   = 0x0260; // CLK/8 input, repeated IRQ on overflow
+}
+
+// Returns the number of CPU cycles elapsed since start_timer() was called.
+static uint32_t read_timer(void) {
+	uint32_t overflows, value;
+
+	// Read the counter again if it overflowed while it was being read.
+	do {
+		overflows = timer_overflows;
+		value     = TIMER_VALUE(2);
+	} while (overflows != timer_overflows);
+
+	return ((overflows << 16) | value) * 8;
+}
+
+/* Previous RotMatrix() implementation */
+
+static MATRIX *old_rot_matrix(SVECTOR *r, MATRIX *m) {
+	short s[3],c[3];
+	MATRIX tm[3];
+
+	s[0] = isin(r->vx);		s[1] = isin(r->vy);		s[2] = isin(r->vz);
+	c[0] = icos(r->vx);		c[1] = icos(r->vy);		c[2] = icos(r->vz);
+
+	// mX
+	m->m[0][0] = ONE;		m->m[0][1] = 0;			m->m[0][2] = 0;
+	m->m[1][0] = 0;			m->m[1][1] = c[0];		m->m[1][2] = -s[0];
+	m->m[2][0] = 0;			m->m[2][1] = s[0];		m->m[2][2] = c[0];
+
+	// mY
+	tm[0].m[0][0] = c[1];	tm[0].m[0][1] = 0;		tm[0].m[0][2] = s[1];
+	tm[0].m[1][0] = 0;		tm[0].m[1][1] = ONE;	tm[0].m[1][2] = 0;
+	tm[0].m[2][0] = -s[1];	tm[0].m[2][1] = 0;		tm[0].m[2][2] = c[1];
+
+	// mZ
+	tm[1].m[0][0] = c[2];	tm[1].m[0][1] = -s[2];	tm[1].m[0][2] = 0;
+	tm[1].m[1][0] = s[2];	tm[1].m[1][1] = c[2];	tm[1].m[1][2] = 0;
+	tm[1].m[2][0] = 0;		tm[1].m[2][1] = 0;		tm[1].m[2][2] = ONE;
+
+	PushMatrix();
+	MulMatrix0( m, &tm[0], &tm[2] );
+	MulMatrix0( &tm[2], &tm[1], m );
+	PopMatrix();
+
+	return m;
+}
+
+/* Benchmark */
+
+#define NUM_ANGLES	1024
+
+typedef MATRIX *(*RotFunction)(SVECTOR *r, MATRIX *m);
+
+static SVECTOR angles[NUM_ANGLES];
+static MATRIX  new_results[NUM_ANGLES];
+static MATRIX  old_results[NUM_ANGLES];
+
+// Returns the average number of cycles taken by each call to the given
+// function.
+static uint32_t run_benchmark(RotFunction func, MATRIX *results) {
+	start_timer();
+
+	for (int i = 0; i < NUM_ANGLES; i++)
+		func(&angles[i], &results[i]);
+
+	return read_timer() / NUM_ANGLES;
+}
+
+static int count_mismatches(void) {
+	int count = 0;
+
+	for (int i = 0; i < NUM_ANGLES; i++) {
+		for (int j = 0; j < 9; j++) {
+			if (new_results[i].m[j / 3][j % 3] != old_results[i].m[j / 3][j % 3]) {
+				count++;
+				break;
+			}
+		}
+	}
+
+	return count;
+}
+
+/* Main */
+
+static RenderContext ctx;
+
+int main(int argc, const char* argv[]) {
+	init_context(&ctx);
+	InitGeom();
+
+	EnterCriticalSection();
+	InterruptCallback(IRQ_TIMER2, &timer2_handler);
+	ExitCriticalSection();
+
+	// Generate random angles (covering the full range of isin()'s input) to
+	// prevent the results from being skewed by any particular angle.
+	srand(1);
+
+	for (int i = 0; i < NUM_ANGLES; i++) {
+		angles[i].vx = rand() % 4096;
+		angles[i].vy = rand() % 4096;
+		angles[i].vz = rand() % 4096;
+	}
+
+	uint32_t new_cycles = run_benchmark(&RotMatrix,      new_results);
+	uint32_t old_cycles = run_benchmark(&old_rot_matrix, old_results);
+	int      mismatches = count_mismatches();
+	int      speedup    = (old_cycles * 100) / new_cycles;
+
+	printf(
+		"RotMatrix() %d cycles, old implementation %d cycles, %d mismatches\n",
+		new_cycles, old_cycles, mismatches
+	);
+
+	while (1) {
+		FntPrint(-1, "ROTATION MATRIX BENCHMARK\n");
+		FntPrint(-1, "(CPU CYCLES, AVERAGE OF %d CALLS)\n\n", NUM_ANGLES);
+
+		FntPrint(-1, "ROTMATRIX:         %d\n", new_cycles);
+		FntPrint(-1, "MULMATRIX0 CHAIN:  %d\n", old_cycles);
+		FntPrint(-1, "SPEEDUP:           %d.%02dX\n\n", speedup / 100, speedup % 100);
+
+		FntPrint(-1, "MISMATCHING MATRICES: %d\n", mismatches);
+
+		FntFlush(-1);
+		display(&ctx);
+	}
+
+	return 0;
+}
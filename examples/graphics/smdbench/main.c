@@ -0,0 +1,297 @@
+/*
+ * PSn00bSDK SMD renderer benchmark
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * This example measures how many CPU cycles it takes to sort the same models
+ * using smdSortModel() and using the vertex cache based renderer, i.e.
+ * smdTransformVerts() followed by smdSortModelCached(). Hardware timer 2 is
+ * used as a cycle counter. The vertex cache of the small model fits in the
+ * scratchpad, while the larger model's cache has to be kept in main RAM.
+ *
+ * smdSortModelGrouped() is also timed, both on copies of the models converted
+ * by smxlink -g (built along with this example) and on the original models.
+ * The latter have no group markers, so the grouped renderer has to treat each
+ * primitive as a group of its own.
+ *
+ * The models are taken from n00bdemo's data directory. They are only sorted
+ * into an ordering table that is never drawn; the results are displayed on
+ * screen and printed to the TTY.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <psxgpu.h>
+#include <psxgte.h>
+#include <psxetc.h>
+#include <psxapi.h>
+#include <inline_c.h>
+#include <hwregs_c.h>
+#include <smd/smd.h>
+
+/* Display/GPU context utilities */
+
+#define SCREEN_XRES 320
+#define SCREEN_YRES 240
+
+#define BGCOLOR_R 48
+#define BGCOLOR_G 24
+#define BGCOLOR_B  0
+
+typedef struct {
+	DISPENV disp;
+	DRAWENV draw;
+} Framebuffer;
+
+typedef struct {
+	Framebuffer db[2];
+	int         db_active;
+} RenderContext;
+
+void init_context(RenderContext *ctx) {
+	Framebuffer *db;
+
+	ResetGraph(0);
+	ctx->db_active = 0;
+
+	db = &(ctx->db[0]);
+	SetDefDispEnv(&(db->disp),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	db = &(ctx->db[1]);
+	SetDefDispEnv(&(db->disp), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	PutDrawEnv(&(db->draw));
+	//PutDispEnv(&(db->disp));
+
+	// Create a text stream at the top of the screen.
+	FntLoad(960, 0);
+	FntOpen(8, 16, 304, 208, 2, 1024);
+}
+
+void display(RenderContext *ctx) {
+	Framebuffer *db;
+
+	DrawSync(0);
+	VSync(0);
+	ctx->db_active ^= 1;
+
+	db = &(ctx->db[ctx->db_active]);
+	PutDrawEnv(&(db->draw));
+	PutDispEnv(&(db->disp));
+	SetDispMask(1);
+}
+
+/* Cycle counter */
+
+// Timer 2 runs at 1/8 of the CPU clock and is only 16 bits wide, so its
+// overflow IRQ is used to extend it.
+static volatile uint32_t timer_overflows;
+
+static void timer2_handler(void) {
+	timer_overflows++;
+}
+
+static void start_timer(void) {
+	timer_overflows = 0;
+	TIMER_CTRL(2)   = 0x0260; // CLK/8 input, repeated IRQ on overflow
+}
+
+// Returns the number of CPU cycles elapsed since start_timer() was called.
+static uint32_t read_timer(void) {
+	uint32_t overflows, value;
+
+	// Read the counter again if it overflowed while it was being read.
+	do {
+		overflows = timer_overflows;
+		value     = TIMER_VALUE(2);
+	} while (overflows != timer_overflows);
+
+	return ((overflows << 16) | value) * 8;
+}
+
+/* Benchmark */
+
+#define NUM_RUNS	16
+#define OT_LEN		1024
+#define PRIBUFF_LEN	131072
+#define CACHE_LEN	1536
+
+#define SCRATCHPAD_CACHE	((SMD_VCACHE *) 0x1f800000)
+
+typedef struct {
+	const char *name;
+	SMD        *smd, *grouped_smd;
+	SMD_VCACHE *cache;
+	uint32_t   sort_cycles, xform_cycles, cached_cycles;
+	uint32_t   grouped_cycles, ungrouped_cycles;
+} ModelBench;
+
+extern uint8_t bungirl_smd[];
+extern uint8_t bulb_smd[];
+extern uint8_t bungirl_grouped_smd[];
+extern uint8_t bulb_grouped_smd[];
+
+static uint32_t   ot[OT_LEN];
+static uint32_t   pribuff[PRIBUFF_LEN / 4];
+static SMD_VCACHE ram_cache[CACHE_LEN];
+
+static MATRIX color_mtx = {
+	.m = {
+		{ ONE, 0, 0 },
+		{ ONE, 0, 0 },
+		{ ONE, 0, 0 }
+	}
+};
+
+static MATRIX light_mtx = {
+	.m = {
+		{ -2048, -2048, -2048 },
+		{     0,     0,     0 },
+		{     0,     0,     0 }
+	}
+};
+
+static void setup_gte(void) {
+	SVECTOR rot = { 0, 512, 0 };
+	VECTOR  pos = { 0, 50, 350 };
+	MATRIX  mtx, lmtx;
+
+	InitGeom();
+	gte_SetGeomOffset(SCREEN_XRES / 2, SCREEN_YRES / 2);
+	gte_SetGeomScreen(SCREEN_XRES / 2);
+	gte_SetBackColor(64, 64, 64);
+	gte_SetColorMatrix(&color_mtx);
+
+	RotMatrix(&rot, &mtx);
+	TransMatrix(&mtx, &pos);
+	gte_SetRotMatrix(&mtx);
+	gte_SetTransMatrix(&mtx);
+
+	MulMatrix0(&light_mtx, &mtx, &lmtx);
+	gte_SetLightMatrix(&lmtx);
+}
+
+static void run_benchmark(ModelBench *bench) {
+	SMD      *smd   = bench->smd;
+	uint32_t sort   = 0;
+	uint32_t xform  = 0;
+	uint32_t cached = 0;
+	uint32_t grouped = 0;
+	uint32_t ungrouped = 0;
+	SC_OT    s_ot;
+
+	s_ot.ot    = ot;
+	s_ot.otlen = OT_LEN;
+	s_ot.zdiv  = 1;
+	s_ot.zoff  = 0;
+
+	for (int i = 0; i < NUM_RUNS; i++) {
+		ClearOTagR(ot, OT_LEN);
+		start_timer();
+		smdSortModel(&s_ot, (uint8_t *) pribuff, smd);
+		sort += read_timer();
+
+		// The time taken by the transformation pass is recorded separately,
+		// but also counted in the total for the cached renderer.
+		ClearOTagR(ot, OT_LEN);
+		start_timer();
+		smdTransformVerts(bench->cache, smd->p_verts, smd->n_verts);
+		xform += read_timer();
+		smdSortModelCached(&s_ot, (uint8_t *) pribuff, smd, bench->cache);
+		cached += read_timer();
+
+		ClearOTagR(ot, OT_LEN);
+		start_timer();
+		smdSortModelGrouped(&s_ot, (uint8_t *) pribuff, bench->grouped_smd);
+		grouped += read_timer();
+
+		ClearOTagR(ot, OT_LEN);
+		start_timer();
+		smdSortModelGrouped(&s_ot, (uint8_t *) pribuff, smd);
+		ungrouped += read_timer();
+	}
+
+	bench->sort_cycles      = sort      / NUM_RUNS;
+	bench->xform_cycles     = xform     / NUM_RUNS;
+	bench->cached_cycles    = cached    / NUM_RUNS;
+	bench->grouped_cycles   = grouped   / NUM_RUNS;
+	bench->ungrouped_cycles = ungrouped / NUM_RUNS;
+}
+
+static void print_results(int fnt, const ModelBench *bench) {
+	int speedup = (bench->sort_cycles * 100) / bench->cached_cycles;
+	int grouped = (bench->sort_cycles * 100) / bench->grouped_cycles;
+
+	FntPrint(fnt, "%s (%d VERTS, %d PRIMS):\n",
+		bench->name, bench->smd->n_verts, bench->smd->n_prims);
+	FntPrint(fnt, " SORTMODEL:       %d\n", bench->sort_cycles);
+	FntPrint(fnt, " TRANSFORMVERTS:  %d\n", bench->xform_cycles);
+	FntPrint(fnt, " +SORTMODELCACHED:%d\n", bench->cached_cycles);
+	FntPrint(fnt, " SPEEDUP:         %d.%02dX\n", speedup / 100, speedup % 100);
+	FntPrint(fnt, " SORTMODELGROUPED:%d\n", bench->grouped_cycles);
+	FntPrint(fnt, " (UNGROUPED SMD): %d\n", bench->ungrouped_cycles);
+	FntPrint(fnt, " SPEEDUP:         %d.%02dX\n\n", grouped / 100, grouped % 100);
+}
+
+/* Main */
+
+static RenderContext ctx;
+
+static ModelBench benches[2];
+
+int main(int argc, const char* argv[]) {
+	init_context(&ctx);
+	setup_gte();
+	smdSetBaseTPage(0x200);
+
+	EnterCriticalSection();
+	InterruptCallback(IRQ_TIMER2, &timer2_handler);
+	ExitCriticalSection();
+
+	benches[0].name  = "BULB";
+	benches[0].smd   = smdInitData(bulb_smd);
+	benches[0].cache = SCRATCHPAD_CACHE;
+	benches[1].name  = "BUNGIRL";
+	benches[1].smd   = smdInitData(bungirl_smd);
+	benches[1].cache = ram_cache;
+
+	benches[0].grouped_smd = smdInitData(bulb_grouped_smd);
+	benches[1].grouped_smd = smdInitData(bungirl_grouped_smd);
+
+	for (int i = 0; i < 2; i++) {
+		ModelBench *bench = &benches[i];
+
+		run_benchmark(bench);
+		printf(
+			"%s: smdSortModel() %d cycles, smdTransformVerts() %d cycles, "
+			"total with smdSortModelCached() %d cycles, "
+			"smdSortModelGrouped() %d cycles (%d cycles without groups)\n",
+			bench->name, bench->sort_cycles, bench->xform_cycles,
+			bench->cached_cycles, bench->grouped_cycles,
+			bench->ungrouped_cycles
+		);
+	}
+
+	while (1) {
+		FntPrint(-1, "SMD RENDERER BENCHMARK\n");
+		FntPrint(-1, "(CPU CYCLES, AVERAGE OF %d RUNS)\n\n", NUM_RUNS);
+
+		for (int i = 0; i < 2; i++)
+			print_results(-1, &benches[i]);
+
+		FntPrint(-1, "BULB CACHE IN SCRATCHPAD,\n");
+		FntPrint(-1, "BUNGIRL CACHE IN MAIN RAM\n");
+
+		FntFlush(-1);
+		display(&ctx);
+	}
+
+	return 0;
+}
@@ -150,7 +150,7 @@ void Stream_Init(Stream_Context *ctx, const Stream_Config *config) {
 
 	int _exit            = EnterCriticalSection();
 	ctx->old_irq_handler = InterruptCallback(IRQ_SPU, &_spu_irq_handler);
-	ctx->old_dma_handler = DMACallback(DMA_SPU, &_spu_dma_handler);
+	ctx->old_dma_handler = SpuSetTransferCallback(&_spu_dma_handler);
 
 	if (_exit)
 		ExitCriticalSection();
@@ -161,7 +161,7 @@ void Stream_Destroy(Stream_Context *ctx) {
 
 	int _exit = EnterCriticalSection();
 	InterruptCallback(IRQ_SPU, ctx->old_irq_handler);
-	DMACallback(DMA_SPU, ctx->old_dma_handler);
+	SpuSetTransferCallback(ctx->old_dma_handler);
 
 	if (_exit)
 		ExitCriticalSection();
@@ -206,7 +206,7 @@ void reset_spu_channels(void) {
 void init_stream(const VAG_Header *vag) {
 	EnterCriticalSection();
 	InterruptCallback(IRQ_SPU, &spu_irq_handler);
-	DMACallback(DMA_SPU, &spu_dma_handler);
+	SpuSetTransferCallback(&spu_dma_handler);
 	ExitCriticalSection();
 
 	int buf_size = vag->interleave;
@@ -0,0 +1,226 @@
+/*
+ * PSn00bSDK LZP compression benchmark
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * This example compares the compression levels supported by liblzp on a small
+ * corpus made up of n00bdemo's models and textures. The corpus is packed by
+ * lzpack at build time into one archive per compression level, as
+ * LZP_COMPRESS_OPTIMAL is only available when liblzp is built with
+ * LZP_USE_MALLOC (which is the case on the host but not on the PlayStation).
+ *
+ * For each archive the example shows the total compressed size and how many
+ * CPU cycles lzDecompress() takes to unpack all files, measured using
+ * hardware timer 2 as a cycle counter. The decompressed files are also
+ * checked against the ones unpacked from the first archive, which should
+ * always be identical.
+ *
+ * The results are displayed on screen and printed to the TTY.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <psxgpu.h>
+#include <psxetc.h>
+#include <psxapi.h>
+#include <hwregs_c.h>
+#include <lzp/lzp.h>
+
+/* Display/GPU context utilities */
+
+#define SCREEN_XRES 320
+#define SCREEN_YRES 240
+
+#define BGCOLOR_R 48
+#define BGCOLOR_G 24
+#define BGCOLOR_B  0
+
+typedef struct {
+	DISPENV disp;
+	DRAWENV draw;
+} Framebuffer;
+
+typedef struct {
+	Framebuffer db[2];
+	int         db_active;
+} RenderContext;
+
+void init_context(RenderContext *ctx) {
+	Framebuffer *db;
+
+	ResetGraph(0);
+	ctx->db_active = 0;
+
+	db = &(ctx->db[0]);
+	SetDefDispEnv(&(db->disp),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	db = &(ctx->db[1]);
+	SetDefDispEnv(&(db->disp), SCREEN_XRES, 0, SCREEN_XRES, SCREEN_YRES);
+	SetDefDrawEnv(&(db->draw),           0, 0, SCREEN_XRES, SCREEN_YRES);
+	setRGB0(&(db->draw), BGCOLOR_R, BGCOLOR_G, BGCOLOR_B);
+	db->draw.isbg = 1;
+	db->draw.dtd  = 1;
+
+	PutDrawEnv(&(db->draw));
+	//PutDispEnv(&(db->disp));
+
+	// Create a text stream at the top of the screen.
+	FntLoad(960, 0);
+	FntOpen(8, 16, 304, 208, 2, 1024);
+}
+
+void display(RenderContext *ctx) {
+	Framebuffer *db;
+
+	DrawSync(0);
+	VSync(0);
+	ctx->db_active ^= 1;
+
+	db = &(ctx->db[ctx->db_active]);
+	PutDrawEnv(&(db->draw));
+	PutDispEnv(&(db->disp));
+	SetDispMask(1);
+}
+
+/* Cycle counter */
+
+// Timer 2 runs at 1/8 of the CPU clock and is only 16 bits wide, so its
+// overflow IRQ is used to extend it.
+static volatile uint32_t timer_overflows;
+
+static void timer2_handler(void) {
+	timer_overflows++;
+}
+
+static void start_timer(void) {
+	timer_overflows = 0;
+	TIMER_CTRL(2)   = 0x0260; // CLK/8 input, repeated IRQ on overflow
+}
+
+// Returns the number of CPU cycles elapsed since start_timer() was called.
+static uint32_t read_timer(void) {
+	uint32_t overflows, value;
+
+	// Read the counter again if it overflowed while it was being read.
+	do {
+		overflows = timer_overflows;
+		value     = TIMER_VALUE(2);
+	} while (overflows != timer_overflows);
+
+	return ((overflows << 16) | value) * 8;
+}
+
+/* Benchmark */
+
+#define NUM_LEVELS		4
+#define MAX_FILES		32
+#define BUFFER_LENGTH	0x20000
+
+typedef struct {
+	const char *name;
+	const void *archive;
+	uint32_t   file_size, packed_size, cycles;
+	int        num_files, mismatches;
+} LevelBench;
+
+extern const uint8_t corpus0[];
+extern const uint8_t corpus1[];
+extern const uint8_t corpus2[];
+extern const uint8_t corpus3[];
+
+static uint32_t buffer[BUFFER_LENGTH / 4];
+static uint32_t file_crcs[MAX_FILES];
+
+static LevelBench benches[NUM_LEVELS] = {
+	{ .name = "FAST",    .archive = corpus0 },
+	{ .name = "NORMAL",  .archive = corpus1 },
+	{ .name = "MAX",     .archive = corpus2 },
+	{ .name = "OPTIMAL", .archive = corpus3 }
+};
+
+// Unpacks all files in the given archive. The first archive's files are used
+// as a reference for all other archives.
+static void run_benchmark(LevelBench *bench, int reference) {
+	const LZP_HEAD *head = (const LZP_HEAD *) bench->archive;
+
+	bench->num_files   = head->numFiles;
+	bench->file_size   = 0;
+	bench->packed_size = 0;
+	bench->cycles      = 0;
+	bench->mismatches  = 0;
+
+	for (int i = 0; (i < head->numFiles) && (i < MAX_FILES); i++) {
+		const LZP_FILE *entry = lzpFileEntry(head, i);
+		const uint8_t  *data  = (const uint8_t *) head + entry->offset;
+
+		start_timer();
+		int length = lzDecompress(buffer, data, entry->packedSize);
+		bench->cycles += read_timer();
+
+		bench->file_size   += entry->fileSize;
+		bench->packed_size += entry->packedSize;
+
+		if (length != (int) entry->fileSize) {
+			bench->mismatches++;
+			continue;
+		}
+
+		uint32_t crc = lzCRC32(buffer, length, LZP_CRC32_REMAINDER);
+
+		if (reference)
+			file_crcs[i] = crc;
+		else if (crc != file_crcs[i])
+			bench->mismatches++;
+	}
+}
+
+/* Main */
+
+static RenderContext ctx;
+
+int main(int argc, const char* argv[]) {
+	init_context(&ctx);
+
+	EnterCriticalSection();
+	InterruptCallback(IRQ_TIMER2, &timer2_handler);
+	ExitCriticalSection();
+
+	for (int i = 0; i < NUM_LEVELS; i++) {
+		LevelBench *bench = &benches[i];
+
+		run_benchmark(bench, !i);
+		printf(
+			"%s: %d files, %d -> %d bytes, lzDecompress() %d cycles, "
+			"%d mismatches\n",
+			bench->name, bench->num_files, bench->file_size,
+			bench->packed_size, bench->cycles, bench->mismatches
+		);
+	}
+
+	while (1) {
+		FntPrint(-1, "LZP COMPRESSION BENCHMARK\n");
+		FntPrint(-1, "(%d FILES, %d BYTES)\n\n", benches[0].num_files, benches[0].file_size);
+
+		for (int i = 0; i < NUM_LEVELS; i++) {
+			const LevelBench *bench = &benches[i];
+
+			int ratio = (bench->packed_size * 1000) / bench->file_size;
+			int speed = (bench->cycles * 100) / bench->file_size;
+
+			FntPrint(-1, "LEVEL %d (%s):\n", i, bench->name);
+			FntPrint(-1, " SIZE:   %d (%d.%d%%)\n", bench->packed_size, ratio / 10, ratio % 10);
+			FntPrint(-1, " CYCLES: %d (%d.%02d/BYTE)\n\n", bench->cycles, speed / 100, speed % 100);
+		}
+
+		for (int i = 0; i < NUM_LEVELS; i++)
+			FntPrint(-1, "MISMATCHES AT LEVEL %d: %d\n", i, benches[i].mismatches);
+
+		FntFlush(-1);
+		display(&ctx);
+	}
+
+	return 0;
+}
@@ -43,11 +43,11 @@ link_libraries(-lgcc)
 # DON'T CHANGE THE ORDER or you'll break the libraries' internal dependencies.
 set(
 	PSN00BSDK_LIBRARIES
+		psxpress
 		psxgpu
 		psxgte
 		psxspu
 		psxcd
-		psxpress
 		psxsio
 		psxetc
 		psxapi
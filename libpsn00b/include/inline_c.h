@@ -327,6 +327,16 @@
 	: "r"( r0 ), "r"( r1 ), "r"( r2 )	\
 	: "$12", "$13", "$14" )
 
+#define gte_lddqa( r0 ) __asm__ volatile ( \
+	"ctc2	%0, $27;"		\
+	:						\
+	: "r"( r0 ) )
+
+#define gte_lddqb( r0 ) __asm__ volatile ( \
+	"ctc2	%0, $28;"		\
+	:						\
+	: "r"( r0 ) )
+
 /**
  * @brief Sets the GTE screen offset
  *
@@ -242,6 +242,51 @@ typedef struct {
 	char	name[16];	// File name
 } CdlFILE;
 
+/**
+ * @brief PCK v2 archive header.
+ *
+ * @details This structure is at the beginning of each PCK v2 archive created
+ * by lzpack and is followed by an array of PCK_Entry structures (sorted by name
+ * hash) and by the null-terminated names of all entries. The header, entry
+ * table and name table make up the archive's table of contents (TOC), which is
+ * toc_length bytes long. The data of each entry starts at a sector boundary.
+ *
+ * @see CdOpenPack()
+ */
+typedef struct {
+	char		magic[4];		// Must be "PCK2"
+	uint32_t	num_entries;	// Number of entries
+	uint32_t	toc_length;		// Length of TOC in bytes
+	uint32_t	reserved;
+} PCK_Header;
+
+/**
+ * @brief PCK v2 archive entry.
+ *
+ * @see CdHashPackName(), CdReadPackEntry()
+ */
+typedef struct {
+	uint32_t	hash;			// Hash of entry name (see CdHashPackName())
+	uint32_t	offset;			// Offset of data in sectors (relative to TOC)
+	uint32_t	size;			// Size of entry in bytes
+	uint32_t	packed_size;	// LZP compressed size, 0 if not compressed
+	uint32_t	name_offset;	// Offset of entry name (relative to TOC)
+} PCK_Entry;
+
+/**
+ * @brief PCK v2 archive handle.
+ *
+ * @details This structure holds the location of a PCK v2 archive on the disc
+ * and a copy of its TOC in main RAM. It is initialized by CdOpenPack().
+ *
+ * @see CdOpenPack(), CdClosePack()
+ */
+typedef struct {
+	int					lba;		// LBA of the archive's first sector
+	PCK_Header			*toc;		// TOC (allocated by CdOpenPack())
+	const PCK_Entry		*entries;	// Entry table within TOC
+} PCK_Archive;
+
 /**
  * @brief Current CD-ROM settings structure.
  *
@@ -1142,6 +1187,86 @@ CdlIsoError CdIsoError(void);
  */
 int CdLoadSession(int session);
 
+/**
+ * @brief Calculates the hash of a PCK v2 archive entry name.
+ *
+ * @details Returns the 32-bit FNV-1a hash of the given name, converted to
+ * lowercase. This is the same hash lzpack stores in each PCK_Entry, and can be
+ * used to precompute hashes of frequently accessed entries.
+ *
+ * @param name
+ * @return Hash value
+ *
+ * @see CdFindPackEntry()
+ */
+uint32_t CdHashPackName(const char *name);
+
+/**
+ * @brief Loads the table of contents of a PCK v2 archive.
+ *
+ * @details Reads the TOC of the PCK v2 archive starting at the given location
+ * (usually obtained using CdSearchFile()) into a buffer allocated using
+ * malloc(). The TOC only has to be loaded once; entries can then be looked up
+ * and read from the disc without any further TOC accesses. The buffer shall be
+ * freed using CdClosePack() once the archive is no longer needed.
+ *
+ * This function is blocking.
+ *
+ * @param pack Pointer to archive handle to initialize
+ * @param loc
+ * @return 0 on success or -1 in case of errors (read error, invalid archive or
+ * out of memory)
+ *
+ * @see CdClosePack(), CdFindPackEntry(), CdReadPackEntry()
+ */
+int CdOpenPack(PCK_Archive *pack, const CdlLOC *loc);
+
+/**
+ * @brief Frees the TOC of a PCK v2 archive.
+ *
+ * @param pack
+ *
+ * @see CdOpenPack()
+ */
+void CdClosePack(PCK_Archive *pack);
+
+/**
+ * @brief Looks up an entry in a PCK v2 archive by name.
+ *
+ * @details Finds the index of the entry with the given name (case
+ * insensitive). As entries are sorted by name hash, lookups take O(log n) time
+ * and only the names of entries with a matching hash are compared.
+ *
+ * @param pack
+ * @param name
+ * @return Entry index or -1 if no entry was found
+ *
+ * @see CdReadPackEntry()
+ */
+int CdFindPackEntry(const PCK_Archive *pack, const char *name);
+
+/**
+ * @brief Reads an entry from a PCK v2 archive.
+ *
+ * @details Reads the entry with the given index from the disc into the buffer,
+ * which must be at least as large as the entry's size (pack->entries[index].size)
+ * and 32-bit aligned. Compressed entries are read continuously into a small
+ * internal ring buffer and each sector is decompressed using the LZP streaming
+ * decompressor as soon as it arrives, so no additional buffer is needed to
+ * hold the compressed data.
+ *
+ * This function is blocking. Any callback set using CdReadyCallback() is
+ * temporarily disabled while a compressed entry is being read.
+ *
+ * @param pack
+ * @param index
+ * @param buffer
+ * @return Size of entry in bytes or -1 in case of errors
+ *
+ * @see CdFindPackEntry()
+ */
+int CdReadPackEntry(const PCK_Archive *pack, int index, void *buffer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,25 @@ typedef struct _DVECTOR {
 	int16_t vx, vy;
 } DVECTOR;
 
+// Quaternion in 4.12 fixed-point format. The vector part comes first so it has
+// the same layout as an SVECTOR.
+typedef struct _QUATERNION {
+	int16_t vx, vy, vz, vw;
+} QUATERNION;
+
+// Axis-aligned bounding box, defined by its center and half of its size along
+// each axis.
+typedef struct _AABB {
+	SVECTOR center, size;
+} AABB;
+
+// View frustum planes in world space, set up by InitFrustum(). Each plane
+// matrix holds three plane normals in its rows and their distances in its
+// translation vector, the extent matrices the absolute values of the normals.
+typedef struct _FRUSTUM {
+	MATRIX planes[2], extents[2];
+} FRUSTUM;
+
 /* Public API */
 
 #define csin(a) isin(a)
@@ -179,6 +198,40 @@ MATRIX *RotMatrix(SVECTOR *r, MATRIX *m);
  */
 MATRIX *HiRotMatrix(VECTOR *r, MATRIX *m);
 
+/**
+ * @brief Defines the rotation matrix of a MATRIX (Y, X, Z order)
+ *
+ * @details Variant of RotMatrix() that multiplies the axis rotation matrices
+ * in a different order, i.e. computes Ry * Rx * Rz. Commonly used for cameras
+ * and characters, as the Y (yaw) rotation is not affected by the X (pitch)
+ * rotation.
+ *
+ * See RotMatrix() for more details.
+ *
+ * @param r Rotation vector (input)
+ * @param m Matrix (output)
+ * @return Pointer to m.
+ *
+ * @see RotMatrix(), RotMatrixZYX()
+ */
+MATRIX *RotMatrixYXZ(SVECTOR *r, MATRIX *m);
+
+/**
+ * @brief Defines the rotation matrix of a MATRIX (Z, Y, X order)
+ *
+ * @details Variant of RotMatrix() that multiplies the axis rotation matrices
+ * in reverse order, i.e. computes Rz * Ry * Rx.
+ *
+ * See RotMatrix() for more details.
+ *
+ * @param r Rotation vector (input)
+ * @param m Matrix (output)
+ * @return Pointer to m.
+ *
+ * @see RotMatrix(), RotMatrixYXZ()
+ */
+MATRIX *RotMatrixZYX(SVECTOR *r, MATRIX *m);
+
 /**
  * @brief Defines the translation vector of a MATRIX
  *
@@ -255,6 +308,252 @@ void VectorNormalS(VECTOR *v0, SVECTOR *v1);
  */
 void Square0(VECTOR *v0, VECTOR *v1);
 
+/**
+ * @brief Rotates, translates and perspective transforms an array of vectors
+ *
+ * @details Projects n vectors from v0 using the current GTE rotation matrix,
+ * translation vector and screen parameters, storing screen coordinates to v1
+ * and depth values (SZ) to sz. Vectors are processed three at a time using
+ * RTPT and the GTE state is not modified, so this is much faster than
+ * transforming each vector individually. The output arrays can be placed in
+ * the scratchpad.
+ *
+ * @param v0 Input vectors
+ * @param v1 Output screen coordinates
+ * @param sz Output depth values
+ * @param n Number of vectors
+ * @return GTE flags of all vectors ORed together (bit 31 is set if any vector
+ * overflowed).
+ */
+int RotTransPersN(SVECTOR *v0, DVECTOR *v1, uint16_t *sz, int n);
+
+/**
+ * @brief Multiplies an array of vectors by a matrix
+ *
+ * @details Multiplies n vectors from v0 by the rotation matrix of m (the
+ * translation vector is ignored) and stores the results to v1, which may be
+ * the same as v0. The results are saturated to 16 bits. Replaces the current
+ * GTE rotation matrix with m, which is only loaded once.
+ *
+ * @param m Input matrix
+ * @param v0 Input vectors
+ * @param v1 Output vectors
+ * @param n Number of vectors
+ *
+ * @see ApplyMatrixLV()
+ */
+void ApplyMatrixN(MATRIX *m, SVECTOR *v0, SVECTOR *v1, int n);
+
+/**
+ * @brief Calculates light colors for an array of normals
+ *
+ * @details Calculates the color of n normals from v0 using the current GTE
+ * light matrix, light color matrix and back color, storing the results to v1.
+ * Normals are processed three at a time using NCT. The code field of each
+ * output color is copied from the current GTE color (set with gte_ldrgb()).
+ *
+ * @param v0 Input normals
+ * @param v1 Output colors
+ * @param n Number of normals
+ */
+void NormalColorN(SVECTOR *v0, CVECTOR *v1, int n);
+
+/**
+ * @brief Normalizes an array of VECTORs into SVECTOR format
+ *
+ * @details Equivalent to calling VectorNormalS() on each of the n vectors
+ * from v0, storing the results to v1, without the overhead of a function call
+ * per vector.
+ *
+ * @param v0 Input (raw) 32-bit vectors
+ * @param v1 Output (normalized) 16-bit vectors
+ * @param n Number of vectors
+ *
+ * @see VectorNormalS()
+ */
+void NormalizeN(VECTOR *v0, SVECTOR *v1, int n);
+
+/**
+ * @brief Defines a quaternion from a rotation axis and angle
+ *
+ * @details Sets q to a rotation of the given angle (4096 = 360 degrees)
+ * around axis, which must be a unit vector.
+ *
+ * @param axis Rotation axis (input)
+ * @param angle Rotation angle
+ * @param q Quaternion (output)
+ * @return Pointer to q.
+ */
+QUATERNION *QuatAxisAngle(SVECTOR *axis, int angle, QUATERNION *q);
+
+/**
+ * @brief Defines a quaternion from rotation angles
+ *
+ * @details Sets q to the same rotation RotMatrix() would build from the
+ * rotation vector r, to ease converting Euler angle based code.
+ *
+ * @param r Rotation vector (input)
+ * @param q Quaternion (output)
+ * @return Pointer to q.
+ *
+ * @see RotMatrix()
+ */
+QUATERNION *QuatFromEuler(SVECTOR *r, QUATERNION *q);
+
+/**
+ * @brief Multiplies two quaternions
+ *
+ * @details Multiplies q0 by q1 and stores the result to q2, which may be the
+ * same as either input. The result represents the rotation of q1 followed by
+ * the rotation of q0, like multiplying the respective matrices would.
+ *
+ * @param q0 Input quaternion A
+ * @param q1 Input quaternion B
+ * @param q2 Output quaternion
+ * @return Pointer to q2.
+ */
+QUATERNION *QuatMul(QUATERNION *q0, QUATERNION *q1, QUATERNION *q2);
+
+/**
+ * @brief Normalizes a quaternion
+ *
+ * @details Scales q0 to unit length and stores the result to q1, which may be
+ * the same as q0. Should be used every now and then on quaternions that are
+ * repeatedly multiplied, to prevent rounding errors from accumulating.
+ *
+ * @param q0 Input quaternion
+ * @param q1 Output quaternion
+ * @return Pointer to q1.
+ */
+QUATERNION *QuatNormal(QUATERNION *q0, QUATERNION *q1);
+
+/**
+ * @brief Interpolates between two quaternions (normalized linear)
+ *
+ * @details Linearly interpolates between q0 and q1 through the shortest path
+ * and normalizes the result, which is stored to q2. This is faster than
+ * QuatSlerp() but the rotation speed is not constant, which is mostly
+ * noticeable on large angles.
+ *
+ * @param q0 Start quaternion
+ * @param q1 End quaternion
+ * @param t Interpolation factor (0 = q0, 4096 = q1)
+ * @param q2 Output quaternion
+ * @return Pointer to q2.
+ *
+ * @see QuatSlerp()
+ */
+QUATERNION *QuatNlerp(QUATERNION *q0, QUATERNION *q1, int t, QUATERNION *q2);
+
+/**
+ * @brief Interpolates between two quaternions (spherical linear)
+ *
+ * @details Interpolates between q0 and q1 through the shortest path at
+ * constant rotation speed and stores the result to q2. The angle between the
+ * quaternions is looked up from a table and the interpolation weights are
+ * calculated using hisin(). Falls back to QuatNlerp() if the quaternions are
+ * very close to each other.
+ *
+ * @param q0 Start quaternion
+ * @param q1 End quaternion
+ * @param t Interpolation factor (0 = q0, 4096 = q1)
+ * @param q2 Output quaternion
+ * @return Pointer to q2.
+ *
+ * @see QuatNlerp()
+ */
+QUATERNION *QuatSlerp(QUATERNION *q0, QUATERNION *q1, int t, QUATERNION *q2);
+
+/**
+ * @brief Converts a quaternion into a rotation matrix
+ *
+ * @details Sets the rotation matrix of m to the rotation represented by q.
+ * The translation vector of m is left unchanged.
+ *
+ * @param q Quaternion (input)
+ * @param m Matrix (output)
+ * @return Pointer to m.
+ */
+MATRIX *QuatToMatrix(QUATERNION *q, MATRIX *m);
+
+/**
+ * @brief Rotates an array of vectors by a quaternion
+ *
+ * @details Converts q into a matrix and rotates n vectors from v0 with it
+ * using the GTE, storing the results to v1. Replaces the current GTE rotation
+ * matrix.
+ *
+ * @param q Quaternion
+ * @param v0 Input vectors
+ * @param v1 Output vectors
+ * @param n Number of vectors
+ *
+ * @see ApplyMatrixN()
+ */
+void QuatRotateN(QUATERNION *q, SVECTOR *v0, SVECTOR *v1, int n);
+
+/**
+ * @brief Calculates the view frustum planes from the current GTE settings
+ *
+ * @details Sets up f with the planes of the view frustum, in world space,
+ * defined by the rotation matrix, translation vector, projection plane
+ * distance and screen offset currently set in the GTE. The screen is assumed
+ * to span from (0, 0) to (w, h) in screen coordinates. The near and far planes
+ * are placed at the given Z coordinates in view space; if zfar is zero, there
+ * is no far plane.
+ *
+ * This function shall be called after setting the view (camera) matrix and
+ * before any object's matrix is composited onto it.
+ *
+ * All planes are moved outwards by a small margin to make up for rounding
+ * errors, so objects up to about 24 units outside the frustum may not be
+ * culled. The margin is only guaranteed to be sufficient for objects whose
+ * world space coordinates are within the SVECTOR range.
+ *
+ * @param f Frustum (output)
+ * @param w Screen width
+ * @param h Screen height
+ * @param znear Near plane Z distance
+ * @param zfar Far plane Z distance (0 = none)
+ *
+ * @see FrustumCullSpheres(), FrustumCullBoxes()
+ */
+void InitFrustum(FRUSTUM *f, int w, int h, int znear, int zfar);
+
+/**
+ * @brief Culls an array of bounding spheres against a view frustum
+ *
+ * @details Tests n bounding spheres, defined by SVECTORs with the radius in
+ * the pad field, against the planes of f using the GTE. The indices of the
+ * spheres that are at least partially inside the frustum are written in
+ * ascending order to visible, which must be large enough to hold n indices.
+ * Replaces the current GTE rotation matrix and translation vector.
+ *
+ * @param f Frustum
+ * @param spheres Bounding spheres in world space
+ * @param visible Indices of visible spheres (output)
+ * @param n Number of spheres
+ * @return Number of visible spheres.
+ */
+int FrustumCullSpheres(FRUSTUM *f, SVECTOR *spheres, uint16_t *visible, int n);
+
+/**
+ * @brief Culls an array of bounding boxes against a view frustum
+ *
+ * @details Tests n axis-aligned bounding boxes against the planes of f using
+ * the GTE. The indices of the boxes that are at least partially inside the
+ * frustum are written in ascending order to visible, which must be large
+ * enough to hold n indices. Replaces the current GTE rotation, translation
+ * and light matrices.
+ *
+ * @param f Frustum
+ * @param boxes Bounding boxes in world space
+ * @param visible Indices of visible boxes (output)
+ * @param n Number of boxes
+ * @return Number of visible boxes.
+ */
+int FrustumCullBoxes(FRUSTUM *f, AABB *boxes, uint16_t *visible, int n);
+
 #ifdef __cplusplus
 }
 #endif
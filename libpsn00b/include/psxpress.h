@@ -20,12 +20,18 @@
  * Currently bitstream versions 1, 2 and 3 are supported. Version 0 and .IKI
  * bitstreams are not supported, but no encoder is publicly available for those
  * anyway.
+ *
+ * An encoder for SPU ADPCM (the format used by .VAG files and SPU RAM) is also
+ * provided, allowing raw 16-bit PCM audio (e.g. generated procedurally or
+ * decompressed from another format) to be converted at runtime. It does not
+ * depend on any hardware and can be compiled on the host as well.
  */
 
 #pragma once
 
 #include <stdint.h>
 #include <stddef.h>
+#include <psxgpu.h>
 
 /* Structure definitions */
 
@@ -76,6 +82,47 @@ typedef struct {
 	uint16_t version;
 } BS_Header;
 
+typedef enum {
+	ENCSPU_QUALITY_FAST		= 0,
+	ENCSPU_QUALITY_NORMAL	= 1
+} ENCSPU_Quality;
+
+typedef enum {
+	ENCSPU_FLAG_START		= 1 << 0,	// Reset state and mark first block as loop start
+	ENCSPU_FLAG_END			= 1 << 1,	// Mark last block as loop end
+	ENCSPU_FLAG_LOOP		= 1 << 2,	// Make loop end jump back to loop start
+	ENCSPU_FLAG_LOOP_START	= 1 << 3	// Mark first block as loop start
+} ENCSPU_Flag;
+
+typedef struct {
+	int16_t	state[2];
+	uint8_t	quality, num_filters;
+} ENCSPU_Context;
+
+typedef struct {
+	short	*src;		// Source 16-bit PCM data
+	short	*dest;		// Destination SPU ADPCM buffer
+	short	*work;		// Byte swapping buffer (only used if byte_swap = 1)
+	long	size;		// Length of source data in bytes
+	long	loop_start;	// Loop point in bytes (relative to source data)
+	char	loop;
+	char	byte_swap;
+	char	proceed;
+	char	quality;
+} ENCSPUENV;
+
+#define ENCSPU_ENCODE_WHOLE			0
+#define ENCSPU_ENCODE_START			(1 << 0)
+#define ENCSPU_ENCODE_CONTINUE		(1 << 1)
+#define ENCSPU_ENCODE_END			(1 << 2)
+
+#define ENCSPU_ENCODE_LOOP			1
+#define ENCSPU_ENCODE_NO_LOOP		0
+#define ENCSPU_ENCODE_ENDIAN_LITTLE	0
+#define ENCSPU_ENCODE_ENDIAN_BIG	1
+#define ENCSPU_ENCODE_MIDDLE_QULITY	0
+#define ENCSPU_ENCODE_HIGH_QULITY	1
+
 /* Public API */
 
 #ifdef __cplusplus
@@ -223,6 +270,90 @@ void DecDCTout(uint32_t *data, size_t length);
  */
 int DecDCToutSync(int mode);
 
+/**
+ * @brief Starts decoding MDEC data directly into a VRAM rectangle.
+ *
+ * @details Feeds the given run-length code buffer (as generated by
+ * DecDCTvlc() or one of its variants) to the MDEC and sets up a DMA callback
+ * to retrieve the decoded image one 16-pixel-wide vertical slice at a time,
+ * uploading each slice to the specified VRAM rectangle using LoadImage() while
+ * the MDEC decodes the next one into a second buffer. This function returns
+ * immediately, allowing the CPU to do other work (e.g. decompressing the next
+ * image with DecDCTvlc()) while the image is being decoded.
+ *
+ * The rectangle is in VRAM coordinates, so its width must be a multiple of 16
+ * when using 16bpp output modes or a multiple of 24 (i.e. 16 pixels at 24bpp)
+ * when using DECDCT_MODE_24BPP; its height must be a multiple of 16. The
+ * image's dimensions (which are not stored in .BS files) must match the
+ * rectangle's. Any rectangle can be used as a destination, including texture
+ * pages: DECDCT_MODE_16BPP_BIT15 can be used to set the semi-transparency bit
+ * on all decoded pixels when generating 15bpp textures.
+ *
+ * The buffer must be large enough to hold two slices, i.e. 16 * rect->h words
+ * for 16bpp modes or 24 * rect->h words for 24bpp mode.
+ * It must not be freed or modified until DecDCTImageSync() returns 0 and all
+ * queued LoadImage() calls have completed (see DrawSync()).
+ *
+ * A buffer is only reused once the LoadImage() call for the slice it holds
+ * has completed. If the GPU's draw queue is not empty when a slice finishes
+ * decoding, the next slice is started from a DrawSync() callback once the
+ * queue drains, so drawing commands issued during decoding will delay it.
+ *
+ * The MDEC shall be idle and no other callback shall be set up to handle MDEC
+ * output while decoding is in progress. Any existing DMACallback(1) handler is
+ * saved and restored by DecDCTImageSync(), as is any DrawSyncCallback()
+ * handler, which is still called when the queue drains. Neither callback shall
+ * be changed until DecDCTImageSync() returns.
+ *
+ * @param data Pointer to MDEC data (run-length codes)
+ * @param rect Destination VRAM rectangle
+ * @param mode DECDCT_MODE_16BPP, DECDCT_MODE_16BPP_BIT15 or DECDCT_MODE_24BPP
+ * @param buffer Pointer to buffer for two slices
+ * @return 0 or -1 in case of failure
+ *
+ * @see DecDCTImageSync(), DecDCTImage()
+ */
+int DecDCTImageStart(
+	const uint32_t *data, const RECT *rect, DECDCTMODE mode, uint32_t *buffer
+);
+
+/**
+ * @brief Waits for decoding to VRAM to finish or returns its status.
+ *
+ * @details Waits for the decoding operation started by DecDCTImageStart() to
+ * finish (if mode = 0) or returns whether it is still in progress (if
+ * mode = 1). Once decoding is finished, the DMACallback(1) and DrawSync()
+ * callbacks that were set before calling DecDCTImageStart() are restored. Note that the last slices
+ * might still be in the GPU's draw queue when this function returns; DrawSync()
+ * shall be used to wait for them to be uploaded.
+ *
+ * @param mode
+ * @return 0 or -1 in case of a timeout (mode = 0), busy flag (mode = 1)
+ *
+ * @see DecDCTImageStart()
+ */
+int DecDCTImageSync(int mode);
+
+/**
+ * @brief Decodes MDEC data directly into a VRAM rectangle (blocking).
+ *
+ * @details A wrapper around DecDCTImageStart() and DecDCTImageSync() that
+ * waits for the entire image to be decoded and uploaded to VRAM. Slices are
+ * still uploaded while the MDEC is decoding the next one. See
+ * DecDCTImageStart() for more details.
+ *
+ * @param data Pointer to MDEC data (run-length codes)
+ * @param rect Destination VRAM rectangle
+ * @param mode DECDCT_MODE_16BPP, DECDCT_MODE_16BPP_BIT15 or DECDCT_MODE_24BPP
+ * @param buffer Pointer to buffer for two slices
+ * @return 0 or -1 in case of failure
+ *
+ * @see DecDCTImageStart()
+ */
+int DecDCTImage(
+	const uint32_t *data, const RECT *rect, DECDCTMODE mode, uint32_t *buffer
+);
+
 /**
  * @brief Decompresses or begins decompressing a .BS file into MDEC codes.
  *
@@ -505,6 +636,95 @@ size_t DecDCTvlcSize2(size_t size);
  */
 void DecDCTvlcBuild(DECDCTTAB *table);
 
+/**
+ * @brief Initializes an SPU ADPCM encoder context.
+ *
+ * @details Resets the state of the given context (i.e. the last two decoded
+ * samples used for prediction) and sets the encoding quality. In
+ * ENCSPU_QUALITY_FAST mode the filter and shift for each block are picked by
+ * only analyzing the input samples, while ENCSPU_QUALITY_NORMAL trial-encodes
+ * each block with all filter and shift combinations and picks the one
+ * resulting in the lowest error. The latter is several times slower; the
+ * improvement is small on simple tonal signals (under 1 dB) and largest on
+ * mixed or noisy content (up to about 3 dB).
+ *
+ * A context must be initialized once before being passed to EncSPUEncode().
+ * Multiple contexts can be used at the same time to encode different streams
+ * (e.g. each channel of a stereo sound).
+ *
+ * @param ctx
+ * @param quality ENCSPU_QUALITY_FAST or ENCSPU_QUALITY_NORMAL
+ *
+ * @see EncSPUEncode()
+ */
+void EncSPUInit(ENCSPU_Context *ctx, ENCSPU_Quality quality);
+
+/**
+ * @brief Encodes 16-bit mono PCM samples into SPU ADPCM data.
+ *
+ * @details Converts the given number of 16-bit signed PCM samples into SPU
+ * ADPCM blocks, each of which holds 28 samples in 16 bytes. The output buffer
+ * must be large enough to hold ((length + 27) / 28) * 16 bytes. If length is
+ * not a multiple of 28, the last block is padded with silence; as such, all
+ * calls but the last one should pass a multiple of 28 samples when encoding a
+ * sound in multiple chunks.
+ *
+ * The flags argument is a bitfield of ENCSPU_Flag values:
+ *
+ * - ENCSPU_FLAG_START resets the context's state (the SPU always starts
+ *   decoding a sound with empty history) and sets the loop start flag on the
+ *   first block generated. It should be passed when encoding the first chunk
+ *   of a sound.
+ * - ENCSPU_FLAG_END sets the loop end flag on the last block generated, which
+ *   will either stop the SPU channel or (if ENCSPU_FLAG_LOOP is also set) make
+ *   it jump back to the loop start point.
+ * - ENCSPU_FLAG_LOOP_START sets the loop start flag on the first block without
+ *   resetting the state, and can be used to place a loop point in the middle
+ *   of a sound.
+ *
+ * The output can be uploaded directly to SPU RAM or prefixed with a .VAG
+ * header. No data is written for sample rate or channel information.
+ *
+ * @param ctx
+ * @param output Pointer to output buffer
+ * @param input Pointer to 16-bit signed PCM samples
+ * @param length Number of samples to encode
+ * @param flags
+ * @return Number of bytes written to the output buffer
+ *
+ * @see EncSPUInit()
+ */
+size_t EncSPUEncode(
+	ENCSPU_Context *ctx, uint8_t *output, const int16_t *input, size_t length,
+	int flags
+);
+
+/**
+ * @brief Encodes 16-bit mono PCM samples into SPU ADPCM data (Sony SDK
+ * compatible).
+ *
+ * @details A wrapper around EncSPUEncode() for compatibility with the official
+ * SDK. This function uses an internal context and takes its parameters from an
+ * ENCSPUENV structure. The proceed field specifies whether the data is a whole
+ * sound (ENCSPU_ENCODE_WHOLE) or a chunk of a larger one, in which case it
+ * shall be set to ENCSPU_ENCODE_START for the first chunk, to
+ * ENCSPU_ENCODE_CONTINUE for subsequent chunks and to ENCSPU_ENCODE_END for the
+ * last chunk. The size of all chunks except the last one must be a multiple of
+ * 56 bytes (28 samples).
+ *
+ * If loop is set, the loop start flag is placed on the block containing the
+ * sample at offset loop_start (in bytes, relative to the beginning of the
+ * sound) and the last block is set to jump back to it. If byte_swap is set,
+ * the input is assumed to be big endian and is converted into the work buffer
+ * (or in-place if work = 0) prior to encoding.
+ *
+ * @param env
+ * @return Number of bytes written to the output buffer
+ *
+ * @see EncSPUEncode()
+ */
+long EncSPU(ENCSPUENV *env);
+
 #ifdef __cplusplus
 }
 #endif
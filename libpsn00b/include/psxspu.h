@@ -13,6 +13,37 @@
  * control sample playback on each channel, configure reverb and enable more
  * advanced features such as interrupts.
  *
+ * All DMA transfers (SpuRead(), SpuWrite() and SpuQueueWrite()) are placed in
+ * a queue and started one after another by the SPU DMA interrupt handler, in a
+ * similar way to the GPU library's draw queue. These functions return
+ * immediately and the buffers passed to them must remain valid until
+ * SpuIsTransferCompleted() or SpuQueueSync() report that the queue is empty. A
+ * callback can be registered with SpuSetTransferCallback() to be notified (from
+ * the DMA interrupt handler) whenever the transfer queued by a call to any of
+ * these functions has completed; DMACallback(DMA_SPU) shall not be used
+ * directly as it is reserved by the library.
+ *
+ * In the rare case the SPU takes too long to switch transfer modes, the
+ * interrupt handler leaves the next transfer queued rather than waiting for it
+ * and the transfer is started by the next SPU library call instead, such as
+ * SpuQueueSync() or SpuIsTransferCompleted().
+ *
+ * SPU RAM can be managed using a heap allocator whose metadata is kept in main
+ * RAM (in a table passed to SpuInitHeap()). Blocks are referenced by handles
+ * returned by SpuAllocBlock() and their current address can be obtained with
+ * SpuGetBlockAddr(), as SpuCompactHeap() may move them to defragment free
+ * space. Data can be uploaded to a block asynchronously with SpuUploadBlock(),
+ * which uses the same transfer queue as SpuQueueWrite().
+ *
+ * A simple voice manager is also provided for sound effect playback. Calling
+ * SpuInitVoiceManager() hands over a set of channels to the manager; sounds can
+ * then be started with SpuPlaySound(), which returns a handle that can be used
+ * to stop the sound or change its volume and pitch. If all channels are busy,
+ * the channel playing the sound with the lowest priority (then the quietest
+ * and oldest one) is stolen. All register writes, including key on and key
+ * off, are deferred to SpuUpdateVoices() which shall be called once per frame.
+ * Channels not handed over to the manager can still be controlled manually.
+ *
  * This library currently has fewer functions than its Sony SDK counterpart, in
  * part because it is not yet complete but also since the vast majority of the
  * Sony library's functions are redundant, inefficient and can be replaced with
@@ -63,6 +94,21 @@ typedef enum _SPU_WaitMode {
 
 /* Structure definitions */
 
+typedef struct _SPU_HeapBlock {
+	uint32_t	addr, size;	// Address and size in SPU RAM (in bytes)
+	int16_t		next;		// Index of next block (sorted by address)
+	uint8_t		flags;
+} SPU_HeapBlock;
+
+typedef struct _SPU_SoundParams {
+	uint32_t	addr;		// Sample start address in SPU RAM (in bytes)
+	uint32_t	adsr;		// ADSR envelope settings (see getSPUADSR())
+	uint16_t	pitch;		// Sample rate (see getSPUSampleRate())
+	int16_t		vol_l;		// Left volume (0-0x3fff)
+	int16_t		vol_r;		// Right volume (0-0x3fff)
+	uint8_t		priority;	// Higher priority sounds can steal channels
+} SPU_SoundParams;
+
 #if 0
 typedef struct _SpuVolume {
 	int16_t left, right;
@@ -160,6 +206,26 @@ SPU_TransferMode SpuGetTransferMode(void);
 uint32_t SpuSetTransferStartAddr(uint32_t addr);
 uint32_t SpuGetTransferStartAddr(void);
 int SpuIsTransferCompleted(int mode);
+int SpuQueueWrite(uint32_t addr, const uint32_t *data, size_t size);
+int SpuQueueSync(int mode);
+void *SpuSetTransferCallback(void (*func)(void));
+
+void SpuInitHeap(SPU_HeapBlock *table, int num_blocks, uint32_t end_addr);
+int SpuAllocBlock(size_t size);
+void SpuFreeBlock(int handle);
+uint32_t SpuGetBlockAddr(int handle);
+size_t SpuGetHeapFree(size_t *largest);
+int SpuUploadBlock(int handle, const uint32_t *data, size_t size);
+int SpuCompactHeap(uint32_t *buffer, size_t buffer_size);
+
+void SpuInitVoiceManager(uint32_t channel_mask);
+int SpuPlaySound(const SPU_SoundParams *params);
+void SpuStopSound(int handle);
+void SpuStopAllSounds(void);
+int SpuIsSoundPlaying(int handle);
+void SpuSetSoundVolume(int handle, int left, int right);
+void SpuSetSoundPitch(int handle, int pitch);
+void SpuUpdateVoices(void);
 
 #ifdef __cplusplus
 }
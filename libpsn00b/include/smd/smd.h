@@ -59,6 +59,84 @@ typedef struct {
 	uint16_t tpage,clut;
 } SMD_PRIM;
 
+// Primitive class bits (type, lighting, coloring and texture) and group
+// marker flag. A group marker is a dummy primitive with type 0, written by
+// smxlink -g before each run of primitives of the same class, with the number
+// of primitives in the run stored in place of the fourth vertex index. Markers
+// are not included in n_prims and are skipped by ReadSMD(). Most renderers
+// discard them like any other type 0 primitive, but only after running RTPT
+// (or NCLIP for smdSortModelCached()) on their vertex indices, so models
+// converted with -g should be drawn using smdSortModelGrouped().
+#define SMD_CLASS_MASK		0x3f
+#define SMD_GROUP_MARKER	(1 << 23)
+
+#define SMD_MAX_LODS	4
+
+typedef struct {
+	uint16_t min_size;			// Minimum projected radius in pixels
+	uint16_t reserved;
+	SMD      *smd;
+} SMD_LOD;
+
+typedef struct {
+	SVECTOR  bound;				// Bounding sphere center, radius in pad
+	uint16_t n_lods;
+	uint16_t reserved;
+	SMD_LOD  lods[SMD_MAX_LODS];
+} SMD_MESH;
+
+// Extended model file written by smxlink, holding meshes with bounds and LODs.
+typedef struct {
+	char     id[3];
+	uint8_t  version;
+	uint16_t flags;
+	uint16_t n_meshes;
+	SMD_MESH meshes[];
+} SML;
+
+// Set in the flags of SMD files written by smxlink from SMX files with bones.
+// The SMD header of such files is followed by an SMD_SKIN structure.
+#define SMD_FLAG_SKINNED	(1 << 2)
+
+#define SMD_ANIM_LOOP		(1 << 0)
+
+typedef struct {
+	int16_t  parent;			// Index of parent bone, -1 for root bones
+	uint16_t first_vert;		// Vertices bound to this bone, relative to its
+	uint16_t n_verts;			// origin
+	uint16_t first_norm;		// Normals bound to this bone
+	uint16_t n_norms;
+	uint16_t reserved;
+	SVECTOR  origin;			// Origin relative to the parent's origin
+} SMD_BONE;
+
+typedef struct {
+	SVECTOR rot;				// Rotation angles (ONE = 360 degrees)
+	SVECTOR pos;				// Offset added to the bone origin
+} SMD_POSE;
+
+typedef struct {
+	uint16_t n_keys;
+	uint16_t flags;
+	uint16_t *p_frames;			// Frame number of each keyframe
+	SMD_POSE *p_poses;			// n_bones poses for each keyframe
+} SMD_ANIM;
+
+typedef struct {
+	uint16_t n_bones;
+	uint16_t n_anims;
+	SMD_BONE *p_bones;			// Parent bones always come before children
+	SMD_ANIM *p_anims;
+	SVECTOR  *p_norms;			// Unrotated normals, set by smdInitSkinData()
+} SMD_SKIN;
+
+// Projected vertex, as written by smdTransformVerts(). Bit 31 of sz is set if
+// the GTE flagged the vertex as overflowing when projecting it.
+typedef struct {
+	uint32_t sxy;
+	uint32_t sz;
+} SMD_VCACHE;
+
 /* API */
 
 #ifdef __cplusplus
@@ -76,6 +154,22 @@ void smdSetBaseTPage(uint16_t tpage);
 uint8_t *smdSortModel(SC_OT *ot, uint8_t *pribuff, SMD *smd);
 uint8_t *smdSortModelFlat(uint32_t *ot, uint8_t *pribuff, SMD *smd);
 
+SMD_VCACHE *smdTransformVerts(SMD_VCACHE *cache, const SVECTOR *verts, int count);
+uint8_t *smdSortModelCached(SC_OT *ot, uint8_t *pribuff, SMD *smd, const SMD_VCACHE *cache);
+
+void smdSetClipParam(int near_z, int max_size, int max_depth);
+uint8_t *smdSortModelClip(SC_OT *ot, uint8_t *pribuff, SMD *smd);
+
+void smdSetDepthCue(int enable);
+uint8_t *smdSortModelGrouped(SC_OT *ot, uint8_t *pribuff, SMD *smd);
+
+SMD_SKIN *smdInitSkinData(SMD *smd);
+void smdGetPose(SMD_POSE *pose, const SMD_SKIN *skin, const SMD_ANIM *anim, int time);
+SMD_VCACHE *smdTransformSkin(SMD_VCACHE *cache, SVECTOR *norms, SMD *smd, const SMD_SKIN *skin, const SMD_POSE *pose, MATRIX *mtx, MATRIX *bone_mtx);
+
+SML *smdInitLodData(const void *data);
+SMD *smdSelectLod(const SMD_MESH *mesh);
+
 void smdSetCelTex(uint16_t tpage, uint16_t clut);
 void smdSetCelParam(int udiv, int vdiv, unsigned int col);
 uint8_t *smdSortModelCel(SC_OT *ot, uint8_t *pribuff, SMD *smd);
@@ -0,0 +1,119 @@
+// Chunked (.LZC) archive handling
+//
+// Files in chunked archives are split into fixed-size blocks which are
+// compressed independently, so that any block can be decompressed without
+// decompressing the ones preceding it. Each file's data begins with an
+// LZP_BLOCKS index holding the offset of each compressed block.
+
+#include <stddef.h>
+#include <string.h>
+
+#include "lzp.h"
+
+
+const LZP_BLOCKS* lzpBlockIndex(const LZP_HEAD* lzpack, int fileNum) {
+
+	const LZP_FILE* fileEntry;
+
+	if (strncmp("LZC", lzpack->id, 3) != 0)
+		return(NULL);
+
+	fileEntry = lzpFileEntry(lzpack, fileNum);
+
+	if (fileEntry == NULL)
+		return(NULL);
+
+	return((const LZP_BLOCKS*)(((const char*)lzpack)+fileEntry->offset));
+
+}
+
+int lzpUnpackBlock(void* buff, const LZP_HEAD* lzpack, int fileNum, int blockNum) {
+
+	const LZP_BLOCKS* index = lzpBlockIndex(lzpack, fileNum);
+
+	if (index == NULL)
+		return(LZP_ERR_INVALID_PACK);
+
+	if ((blockNum < 0) || (blockNum >= (int)index->numBlocks))
+		return(LZP_ERR_RANGE);
+
+	return(lzDecompress(
+		buff,
+		((const char*)index)+index->offset[blockNum],
+		index->offset[blockNum+1]-index->offset[blockNum]
+	));
+
+}
+
+int lzpUnpackRange(void* buff, void* scratch, const LZP_HEAD* lzpack, int fileNum, int offset, int size) {
+
+	const LZP_BLOCKS*	index = lzpBlockIndex(lzpack, fileNum);
+	const char*			data;
+
+	char*	outPtr = (char*)buff;
+	int		blockNum;
+	int		blockPos;
+	int		blockLen;
+	int		packedLen;
+	int		total = 0;
+	int		len;
+
+	if (index == NULL)
+		return(LZP_ERR_INVALID_PACK);
+
+	if ((offset < 0) || (size < 0) || ((offset+size) > lzpFileSize(lzpack, fileNum)))
+		return(LZP_ERR_RANGE);
+
+	blockNum = offset/index->blockSize;
+	blockPos = offset%index->blockSize;
+
+	while(size > 0) {
+
+		data		= ((const char*)index)+index->offset[blockNum];
+		packedLen	= index->offset[blockNum+1]-index->offset[blockNum];
+		blockLen	= index->blockSize-blockPos;
+
+		if (blockPos) {
+
+			// The range starts in the middle of this block; decompress it
+			// into the scratch buffer up to the end of the range and copy the
+			// requested part
+			if (scratch == NULL)
+				return(LZP_ERR_RANGE);
+
+			len = lzDecompressLen(scratch, blockPos+size, data, packedLen);
+
+			if (len < 0)
+				return(len);
+
+			len -= blockPos;
+			memcpy(outPtr, ((const char*)scratch)+blockPos, len);
+
+		} else if (size < blockLen) {
+
+			// The range ends in the middle of this block, which can be
+			// decompressed in place as decompression stops once enough
+			// data has been written
+			len = lzDecompressLen(outPtr, size, data, packedLen);
+
+		} else {
+
+			len = lzDecompress(outPtr, data, packedLen);
+
+		}
+
+		if (len <= 0)
+			return((len < 0) ? len : LZP_ERR_DECOMPRESS);
+
+		outPtr	+= len;
+		total	+= len;
+		size	-= len;
+
+		blockNum++;
+		blockPos = 0;
+
+	}
+
+	return(total);
+
+}
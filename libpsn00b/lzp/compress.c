@@ -3,12 +3,11 @@
 #include "lzconfig.h"
 
 #include <string.h>
-#ifdef LZP_USE_MALLOC
 #include <stdlib.h>
-#endif
 
 #include "bit.h"
 #include "lzp.h"
+#include "lzformat.h"
 
 
 // Internal structure for hash table allocation sizes
@@ -28,29 +27,12 @@ struct {
 
 
 // Defines and macros for lz77 compression/decompression (don't touch)
-#define W_BITS		lzHashParam.WindowSize
-#define HASH1_BITS	lzHashParam.Hash1Size
-#define HASH2_BITS	lzHashParam.Hash2Size
+#define W_BITS		ctx->windowSize
+#define HASH1_BITS	ctx->hash1Size
+#define HASH2_BITS	ctx->hash2Size
 
 #define W_SIZE		(1<<W_BITS)
 #define W_MASK		(W_SIZE-1)
-#define SLOT_BITS	4
-#define NUM_SLOTS	(1<<SLOT_BITS)
-
-#define A_BITS		2 // 1 xx
-#define B_BITS		2 // 01 xx
-#define C_BITS		2 // 001 xx
-#define D_BITS		3 // 0001 xxx
-#define E_BITS		5 // 00001 xxxxx
-#define F_BITS		9 // 00000 xxxxxxxxx
-#define A			(1<<A_BITS)
-#define B			((1<<B_BITS)+A)
-#define C			((1<<C_BITS)+B)
-#define D			((1<<D_BITS)+C)
-#define E			((1<<E_BITS)+D)
-#define F			((1<<F_BITS)+E)
-#define MIN_MATCH	3
-#define MAX_MATCH	((F-1)+MIN_MATCH)
 
 #define BUF_SIZE	(1<<26)
 #define TOO_FAR		(1<<16)
@@ -70,13 +52,40 @@ struct {
 
 #ifndef LZP_NO_COMPRESS
 
-int update_hash1(int h, int c) {
+// Bit writer, kept in the compressor context rather than in the globals used
+// by put_bits() so that multiple contexts can be used concurrently
+static void ctx_put_bits(LZP_CONTEXT* ctx, int n, int x) {
+
+	ctx->bitBuf |= x<<ctx->bitCount;
+	ctx->bitCount += n;
+
+	while(ctx->bitCount >= 8) {
+
+		*ctx->outPtr = ctx->bitBuf;
+		ctx->outPtr++;
+		ctx->outBytes++;
+
+		ctx->bitBuf >>= 8;
+		ctx->bitCount -= 8;
+
+	}
+
+}
+
+static void ctx_flush_bits(LZP_CONTEXT* ctx) {
+
+	ctx_put_bits(ctx, 7, 0);
+	ctx->bitCount = ctx->bitBuf = 0;
+
+}
+
+static int update_hash1(const LZP_CONTEXT* ctx, int h, int c) {
 
 	return(((h<<HASH1_SHIFT)+c)&HASH1_MASK);
 
 }
 
-int update_hash2(int h, int c) {
+static int update_hash2(const LZP_CONTEXT* ctx, int h, int c) {
 
 	return(((h<<HASH2_SHIFT)+c)&HASH2_MASK);
 
@@ -107,7 +116,238 @@ int get_penalty(int a, int b) {
 
 }
 
-int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
+// Returns the slot (log) used to encode a match offset
+static int get_offset_log(const LZP_CONTEXT* ctx, int offset) {
+
+	int log = W_BITS-NUM_SLOTS;
+
+	while(offset >= (2<<log))
+		++log;
+
+	return(log);
+
+}
+
+static void put_match(LZP_CONTEXT* ctx, int len, int offset) {
+
+	int i;
+	int log;
+
+	ctx_put_bits(ctx, 1, 1);
+
+	i = len-MIN_MATCH;
+
+	if (i < A) {
+		ctx_put_bits(ctx, 1, 1); // 1
+		ctx_put_bits(ctx, A_BITS, i);
+	} else if (i < B) {
+		ctx_put_bits(ctx, 2, 1<<1); // 01
+		ctx_put_bits(ctx, B_BITS, i-A);
+	} else if (i < C) {
+		ctx_put_bits(ctx, 3, 1<<2); // 001
+		ctx_put_bits(ctx, C_BITS, i-B);
+	} else if (i < D) {
+		ctx_put_bits(ctx, 4, 1<<3); // 0001
+		ctx_put_bits(ctx, D_BITS, i-C);
+	} else if (i < E) {
+		ctx_put_bits(ctx, 5, 1<<4); // 00001
+		ctx_put_bits(ctx, E_BITS, i-D);
+	} else {
+		ctx_put_bits(ctx, 5, 0); // 00000
+		ctx_put_bits(ctx, F_BITS, i-E);
+	}
+
+	--offset;
+	log = get_offset_log(ctx, offset);
+
+	ctx_put_bits(ctx, SLOT_BITS, log-(W_BITS-NUM_SLOTS));
+
+	if (log>(W_BITS-NUM_SLOTS))
+		ctx_put_bits(ctx, log, offset-(1<<log));
+	else
+		ctx_put_bits(ctx, W_BITS-(NUM_SLOTS-1), offset);
+
+}
+
+#ifdef LZP_USE_MALLOC
+
+static int get_match_len(const unsigned char* a, const unsigned char* b, int max_match) {
+
+	int i = 0;
+
+	while((i < max_match) && (a[i] == b[i]))
+		++i;
+
+	return(i);
+
+}
+
+// Returns the number of bits taken by a match's length field (including the
+// flag bit) or its offset field
+static int get_length_cost(int len) {
+
+	int i = len-MIN_MATCH;
+
+	if (i < A)
+		return(1+1+A_BITS);
+	else if (i < B)
+		return(1+2+B_BITS);
+	else if (i < C)
+		return(1+3+C_BITS);
+	else if (i < D)
+		return(1+4+D_BITS);
+	else if (i < E)
+		return(1+5+E_BITS);
+
+	return(1+5+F_BITS);
+
+}
+
+static int get_offset_cost(const LZP_CONTEXT* ctx, int offset) {
+
+	int log = get_offset_log(ctx, offset-1);
+
+	if (log>(W_BITS-NUM_SLOTS))
+		return(SLOT_BITS+log);
+
+	return(SLOT_BITS+W_BITS-(NUM_SLOTS-1));
+
+}
+
+// Optimal parser used by LZP_COMPRESS_OPTIMAL. Rather than picking matches
+// greedily, the cheapest encoding (in bits) of every prefix of the input is
+// computed in a single forward pass, by trying a literal and every match
+// length found through the hash chains at each position. As the chains are
+// walked from the closest match onwards, only the closest (i.e. cheapest)
+// match is considered for each length. The cheapest path is then traced back
+// from the end of the input and encoded. Data before the start position (i.e.
+// the dictionary) is only referenced by matches and never encoded.
+static int compress_optimal(LZP_CONTEXT* ctx, const unsigned char* inData, int start, int inSize, int* head, int* prev, int h1, int h2, int max_chain) {
+
+	unsigned int* cost = malloc(4*(inSize-start+1));
+	int* dist = malloc(4*(inSize-start+1));
+	unsigned short* from = malloc(2*(inSize-start+1));
+
+	int i,s,p;
+	int len,best;
+	int max_match;
+	int limit;
+	int chain_len;
+	unsigned int c;
+
+	if ((cost == NULL) || (dist == NULL) || (from == NULL)) {
+
+		free(cost);
+		free(dist);
+		free(from);
+
+		return(0);
+
+	}
+
+	// All arrays are indexed relative to the start position
+	cost[0] = 0;
+
+	for(i=1; i<=(inSize-start); ++i)
+		cost[i] = 0xffffffff;
+
+	for(p=start; p<inSize; ++p) {
+
+		// Literal (0 xxxxxxxx)
+		if (cost[p-start]+9 < cost[p-start+1]) {
+			cost[p-start+1] = cost[p-start]+9;
+			from[p-start+1] = 1;
+		}
+
+		max_match = get_min(MAX_MATCH, inSize-p);
+		limit = get_max(p-W_SIZE, 0);
+		best = MIN_MATCH-1;
+
+		// Try the most recent 3-byte match first, then walk the 4-byte hash
+		// chain. Only matches longer than the best one found so far (which is
+		// closer) are worth considering.
+		s = head[h1];
+		chain_len = max_chain+1;
+
+		while((max_match >= MIN_MATCH) && (chain_len-- != 0)) {
+
+			if (s < limit) {
+
+				// Skip to the hash chain if there is no 3-byte match,
+				// otherwise the end of the chain has been reached
+				if (chain_len != max_chain)
+					break;
+
+			} else if (inData[s+best] == inData[p+best]) {
+
+				len = get_match_len(inData+s, inData+p, max_match);
+
+				if (len > best) {
+
+					c = cost[p-start]+get_offset_cost(ctx, p-s);
+
+					for(i=best+1; i<=len; ++i) {
+						if (c+get_length_cost(i) < cost[p-start+i]) {
+							cost[p-start+i] = c+get_length_cost(i);
+							from[p-start+i] = i;
+							dist[p-start+i] = p-s;
+						}
+					}
+
+					best = len;
+
+					if (len == max_match)
+						break;
+
+				}
+
+			}
+
+			if (chain_len == max_chain)
+				s = head[h2+HASH1_SIZE];
+			else
+				s = prev[s&W_MASK];
+
+		}
+
+		// Insert new string
+		head[h1] = p;
+		prev[p&W_MASK] = head[h2+HASH1_SIZE];
+		head[h2+HASH1_SIZE] = p;
+
+		h1 = update_hash1(ctx, h1, inData[p+HASH1_LEN]);
+		h2 = update_hash2(ctx, h2, inData[p+HASH2_LEN]);
+
+	}
+
+	// Trace the cheapest path back, storing the end position of each token
+	// at its start position (reusing the cost array) so it can be encoded
+	// in order
+	for(p=inSize-start; p>0; p-=from[p])
+		cost[p-from[p]] = p;
+
+	for(p=0; p<(inSize-start); p=cost[p]) {
+
+		len = cost[p]-p;
+
+		if (len >= MIN_MATCH)
+			put_match(ctx, len, dist[cost[p]]);
+		else
+			ctx_put_bits(ctx, 9, inData[start+p]<<1); // 0 xxxxxxxx
+
+	}
+
+	free(cost);
+	free(dist);
+	free(from);
+
+	return(1);
+
+}
+
+#endif
+
+int lzCompressCtx(LZP_CONTEXT* ctx, void* outBuff, const void* inBuff, int inSize, int level) {
 
 #ifndef LZP_USE_MALLOC
 	int head[HASH1_SIZE+HASH2_SIZE];
@@ -118,7 +358,7 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 #endif
 
 
-	int max_chain[] = {4, 256, 1<<12};
+	int max_chain[] = {4, 256, 1<<12, 1<<12};
 
 	int i,s;
 	int h1=0;
@@ -134,27 +374,76 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 	int chain_len;
 	int next_p;
 	int max_lazy;
-	int log;
 
+	int start=0;
+	unsigned char* dictBuff=NULL;
+
+
+	const unsigned char* inData = (const unsigned char*)inBuff;
+
+	// If a dictionary is set, compress a copy of the input with the
+	// dictionary in front of it, so that matches can reference it. Only the
+	// last W_SIZE bytes of the dictionary can be reached by a match.
+	if ((ctx->dict != NULL) && (ctx->dictSize > 0)) {
+
+		start = get_min(ctx->dictSize, W_SIZE);
+		dictBuff = malloc(start+inSize+HASH2_LEN);
 
-	inPtr = (unsigned char*)inBuff;
-	outPtr = (unsigned char*)outBuff;
-	outBytes = 0;
+		if (dictBuff != NULL) {
+
+			memcpy(dictBuff, ctx->dict+(ctx->dictSize-start), start);
+			memcpy(dictBuff+start, inData, inSize);
+			memset(dictBuff+start+inSize, 0, HASH2_LEN);
+
+			inData = dictBuff;
+			inSize += start;
+
+		} else {
+
+			start = 0;
+
+		}
+
+	}
+
+	ctx->outPtr = (unsigned char*)outBuff;
+	ctx->outBytes = 0;
+	ctx->bitBuf = 0;
+	ctx->bitCount = 0;
 
 
 	for (i=0; i<HASH1_SIZE+HASH2_SIZE; ++i)
 		head[i] = -1;
 
 	for (i=0; i<HASH1_LEN; ++i)
-		h1=update_hash1(h1, inPtr[i]);
+		h1=update_hash1(ctx, h1, inData[i]);
 
 	for (i=0; i<HASH2_LEN; ++i)
-		h2=update_hash2(h2, inPtr[i]);
-
-	init_bits();
+		h2=update_hash2(ctx, h2, inData[i]);
 
 	// Put window size value so that the compressed data will be independent of the compression settings
-	put_bits(5, lzHashParam.WindowSize);
+	ctx_put_bits(ctx, 5, ctx->windowSize);
+
+	// Insert the strings of the dictionary without encoding them
+	for(p=0; p<start; ++p) {
+
+		head[h1] = p;
+		prev[p&W_MASK] = head[h2+HASH1_SIZE];
+		head[h2+HASH1_SIZE] = p;
+
+		h1 = update_hash1(ctx, h1, inData[p+HASH1_LEN]);
+		h2 = update_hash2(ctx, h2, inData[p+HASH2_LEN]);
+
+	}
+
+	if (level > LZP_COMPRESS_OPTIMAL)
+		level = LZP_COMPRESS_OPTIMAL;
+
+#ifdef LZP_USE_MALLOC
+	// Fall back to greedy parsing if there is not enough memory
+	if ((level == LZP_COMPRESS_OPTIMAL) && compress_optimal(ctx, inData, start, inSize, head, prev, h1, h2, max_chain[level]))
+		p = inSize;
+#endif
 
 	while(p < inSize) {
 
@@ -168,12 +457,12 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 
 			s = head[h1];
 
-			if (inPtr[s] == inPtr[p]) {
+			if (inData[s] == inData[p]) {
 
 				i = 0;
 
 				while(++i < max_match) {
-					if (inPtr[s+i] != inPtr[p+i])
+					if (inData[s+i] != inData[p+i])
 						break;
 				}
 
@@ -193,12 +482,12 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 
 			while((chain_len-- != 0) && (s >= limit)) {
 
-				if ((inPtr[s+len] == inPtr[p+len]) && (inPtr[s] == inPtr[p])) {
+				if ((inData[s+len] == inData[p+len]) && (inData[s] == inData[p])) {
 
 					i = 0;
 
 					while(++i < max_match) {
-						if (inPtr[s+i] != inPtr[p+i])
+						if (inData[s+i] != inData[p+i])
 							break;
 					}
 
@@ -227,16 +516,16 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 			max_lazy = get_min(len+4, max_match);
 
 			chain_len = max_chain[level];
-			s = head[update_hash2(h2, inPtr[next_p+(HASH2_LEN-1)])+HASH1_SIZE];
+			s = head[update_hash2(ctx, h2, inData[next_p+(HASH2_LEN-1)])+HASH1_SIZE];
 
 			while((chain_len-- != 0) && (s >= limit)) {
 
-				if ((inPtr[s+len] == inPtr[next_p+len]) && (inPtr[s] == inPtr[next_p])) {
+				if ((inData[s+len] == inData[next_p+len]) && (inData[s] == inData[next_p])) {
 
 					i = 0;
 
 					while(++i < max_lazy) {
-						if (inPtr[s+i] != inPtr[next_p+i])
+						if (inData[s+i] != inData[next_p+i])
 							break;
 					}
 
@@ -259,47 +548,12 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 
 		if (len >= MIN_MATCH) { // Match
 
-			put_bits(1, 1);
-
-			i = len-MIN_MATCH;
-
-			if (i < A) {
-				put_bits(1, 1); // 1
-				put_bits(A_BITS, i);
-			} else if (i < B) {
-				put_bits(2, 1<<1); // 01
-				put_bits(B_BITS, i-A);
-			} else if (i < C) {
-				put_bits(3, 1<<2); // 001
-				put_bits(C_BITS, i-B);
-			} else if (i < D) {
-				put_bits(4, 1<<3); // 0001
-				put_bits(D_BITS, i-C);
-			} else if (i < E) {
-				put_bits(5, 1<<4); // 00001
-				put_bits(E_BITS, i-D);
-			} else {
-				put_bits(5, 0); // 00000
-				put_bits(F_BITS, i-E);
-			}
-
-			--offset;
-			log = W_BITS-NUM_SLOTS;
-
-			while(offset >= (2<<log))
-				++log;
-
-			put_bits(SLOT_BITS, log-(W_BITS-NUM_SLOTS));
-
-			if (log>(W_BITS-NUM_SLOTS))
-				put_bits(log, offset-(1<<log));
-			else
-				put_bits(W_BITS-(NUM_SLOTS-1), offset);
+			put_match(ctx, len, offset);
 
 		} else { // Literal
 
 			len = 1;
-			put_bits(9, inPtr[p]<<1); // 0 xxxxxxxx
+			ctx_put_bits(ctx, 9, inData[p]<<1); // 0 xxxxxxxx
 
 		}
 
@@ -311,21 +565,56 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
 
 			++p;
 
-			h1 = update_hash1(h1, inPtr[p+(HASH1_LEN-1)]);
-			h2 = update_hash2(h2, inPtr[p+(HASH2_LEN-1)]);
+			h1 = update_hash1(ctx, h1, inData[p+(HASH1_LEN-1)]);
+			h2 = update_hash2(ctx, h2, inData[p+(HASH2_LEN-1)]);
 
 		}
 
 	}
 
-	flush_bits();
+	ctx_flush_bits(ctx);
 
 #ifdef LZP_USE_MALLOC
 	free(head);
 	free(prev);
 #endif
 
-	return(outBytes);
+	free(dictBuff);
+
+	return(ctx->outBytes);
+
+}
+
+int lzCompress(void* outBuff, const void* inBuff, int inSize, int level) {
+
+	LZP_CONTEXT ctx;
+
+	lzInitContext(&ctx);
+
+	return(lzCompressCtx(&ctx, outBuff, inBuff, inSize, level));
+
+}
+
+void lzInitContext(LZP_CONTEXT* ctx) {
+
+	ctx->windowSize = lzHashParam.WindowSize;
+	ctx->hash1Size = lzHashParam.Hash1Size;
+	ctx->hash2Size = lzHashParam.Hash2Size;
+
+	ctx->dict = 0;
+	ctx->dictSize = 0;
+
+	ctx->outPtr = 0;
+	ctx->outBytes = 0;
+	ctx->bitBuf = 0;
+	ctx->bitCount = 0;
+
+}
+
+void lzSetDictionary(LZP_CONTEXT* ctx, const void* dict, int dictSize) {
+
+	ctx->dict = (const uint8_t*)dict;
+	ctx->dictSize = dictSize;
 
 }
 
@@ -347,7 +636,9 @@ void lzResetHashSizes() {
 
 #endif // LZP_NO_COMPRESS
 
-int lzDecompress(void* outBuff, const void* inBuff, int inSize) {
+int lzDecompressDict(void* outBuff, const void* inBuff, int inSize, const void* dict, int dictSize) {
+
+	const unsigned char* dictData = (const unsigned char*)dict;
 
 	int p=0;
 	int len;
@@ -386,12 +677,15 @@ int lzDecompress(void* outBuff, const void* inBuff, int inSize) {
 
 			s =~ (log>(windowSize-NUM_SLOTS) ? get_bits(log)+(1<<log) : get_bits(windowSize-(NUM_SLOTS-1)))+p;
 
-			if (s < 0)
+			if (s < -dictSize)
 				return(LZP_ERR_DECOMPRESS);
 
-			outPtr[p++] = outPtr[s++];
-			outPtr[p++] = outPtr[s++];
-			outPtr[p++] = outPtr[s++];
+			len += MIN_MATCH;
+
+			// Copy the part of the match that lies in the dictionary (if any)
+			// straight from it
+			for(; (s < 0) && (len != 0); len--)
+				outPtr[p++] = dictData[dictSize+(s++)];
 
 			while(len-- != 0)
 				outPtr[p++] = outPtr[s++];
@@ -408,6 +702,29 @@ int lzDecompress(void* outBuff, const void* inBuff, int inSize) {
 
 }
 
+#ifdef LZP_ASM_DECOMPRESS
+
+// Defined in decompress.s. The assembly implementation has a different name
+// so that it only gets linked in if this option is enabled; otherwise it is
+// simply left unreferenced.
+int _lz_decompress_asm(void* outBuff, const void* inBuff, int inSize);
+
+int lzDecompress(void* outBuff, const void* inBuff, int inSize) {
+
+	return(_lz_decompress_asm(outBuff, inBuff, inSize));
+
+}
+
+#else
+
+int lzDecompress(void* outBuff, const void* inBuff, int inSize) {
+
+	return(lzDecompressDict(outBuff, inBuff, inSize, NULL, 0));
+
+}
+
+#endif // LZP_ASM_DECOMPRESS
+
 int lzDecompressLen(void* outBuff, int outSize, const void* inBuff, int inSize) {
 
 	int p=0;
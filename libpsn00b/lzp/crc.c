@@ -1,6 +1,11 @@
 #include <stdint.h>
+#include "lzconfig.h"
 #include "lzp.h"
 
+#ifdef LZP_CRC_SLICES
+#include "crctable.h"
+#endif
+
 void initTable16(uint16_t *table) {
 
 	int i, j;
@@ -26,6 +31,8 @@ void initTable16(uint16_t *table) {
 
 }
 
+#ifndef LZP_CRC_SLICES
+
 void initTable32(uint32_t *table) {
 
 	int i,j;
@@ -50,6 +57,8 @@ void initTable32(uint32_t *table) {
 
 }
 
+#endif
+
 uint16_t lzCRC16(const void* buff, int bytes, uint16_t crc) {
 
 	int i;
@@ -71,6 +80,80 @@ uint16_t lzCRC16(const void* buff, int bytes, uint16_t crc) {
 
 }
 
+#ifdef LZP_CRC_SLICES
+
+// Slice-by-4/8 implementation, which processes a whole word (or two) per
+// iteration using the precomputed tables in crctable.h. Words are read from
+// aligned addresses only and assumed to be little endian.
+uint32_t lzCRC32(const void* buff, int bytes, uint32_t crc) {
+
+	const uint8_t	*byteBuff = (const uint8_t *)buff;
+	const uint32_t	*wordBuff;
+	uint32_t		a;
+#if LZP_CRC_SLICES == 8
+	uint32_t		b;
+#endif
+
+	// Process leading bytes until the pointer is word aligned
+	while((bytes > 0) && (((uintptr_t)byteBuff)&3)) {
+
+		crc = (crc>>8)^crc32Table[0][(crc^*byteBuff)&0xff];
+		byteBuff++;
+		bytes--;
+
+	}
+
+	wordBuff = (const uint32_t *)byteBuff;
+
+#if LZP_CRC_SLICES == 8
+	for(; bytes>=8; bytes-=8) {
+
+		a = wordBuff[0]^crc;
+		b = wordBuff[1];
+		wordBuff += 2;
+
+		crc =
+			crc32Table[7][a&0xff]^
+			crc32Table[6][(a>>8)&0xff]^
+			crc32Table[5][(a>>16)&0xff]^
+			crc32Table[4][a>>24]^
+			crc32Table[3][b&0xff]^
+			crc32Table[2][(b>>8)&0xff]^
+			crc32Table[1][(b>>16)&0xff]^
+			crc32Table[0][b>>24];
+
+	}
+#endif
+
+	for(; bytes>=4; bytes-=4) {
+
+		a = *wordBuff^crc;
+		wordBuff++;
+
+		crc =
+			crc32Table[3][a&0xff]^
+			crc32Table[2][(a>>8)&0xff]^
+			crc32Table[1][(a>>16)&0xff]^
+			crc32Table[0][a>>24];
+
+	}
+
+	// Process any remaining bytes
+	byteBuff = (const uint8_t *)wordBuff;
+
+	for(; bytes>0; bytes--) {
+
+		crc = (crc>>8)^crc32Table[0][(crc^*byteBuff)&0xff];
+		byteBuff++;
+
+	}
+
+	return(crc^0xFFFFFFFF);
+
+}
+
+#else
+
 uint32_t lzCRC32(const void* buff, int bytes, uint32_t crc) {
 
 	int	i;
@@ -90,3 +173,5 @@ uint32_t lzCRC32(const void* buff, int bytes, uint32_t crc) {
 	return(crc^0xFFFFFFFF);
 
 }
+
+#endif
@@ -0,0 +1,239 @@
+# liblzp data compression library (assembly LZ77 decompressor)
+# (C) 2023 spicyjpeg - MPL licensed
+#
+# This is a drop-in replacement for the C implementation of lzDecompress() in
+# compress.c, which calls it when LZP_ASM_DECOMPRESS is defined in lzconfig.h
+# (the default on the PlayStation). The bitstream is read through a 32-bit buffer kept in a register
+# and refilled one unaligned word at a time using lwl/lwr, so each refill
+# leaves between 25 and 32 valid bits in the buffer. Length prefixes are decoded
+# without looping and matches whose source is at least 4 bytes behind the
+# output pointer are copied one (unaligned) word at a time.
+#
+# Note that the refill may read up to 7 bytes past the end of the compressed
+# data (4 bytes loaded from a pointer that can be up to 3 bytes past the end). The end of the stream is however detected exactly like the C version
+# does (i.e. once all bytes of the input have been used up), based on the
+# number of bits actually consumed.
+
+.set noreorder
+
+.set value,			$v0
+.set length,		$v1
+.set output,		$a0
+.set input,			$a1
+.set input_end,		$a2
+.set out_ptr,		$t0
+.set bit_buf,		$t1
+.set bit_count,		$t2
+.set window_bits,	$t3
+.set slot_base,		$t4
+.set temp,			$t5
+.set temp2,			$t6
+.set temp3,			$t7
+.set offset,		$t8
+.set source,		$t9
+
+# Refills the bit buffer. bit_count must be lower than 32. Any partial byte
+# shifted in at the top of the buffer is the beginning of the byte that will be
+# loaded by the next refill, so it is safe to OR the same bits in again.
+.macro REFILL
+	lwl   temp, 3(input)
+	lwr   temp, 0(input)
+	li    temp2, 32
+	subu  temp2, bit_count
+	sllv  temp, temp, bit_count
+	or    bit_buf, temp
+	srl   temp2, 3 # bytes = (32 - bit_count) / 8
+	addu  input, temp2
+	sll   temp2, 3
+	addu  bit_count, temp2
+.endm
+
+.section .text._lz_decompress_asm, "ax", @progbits
+.global _lz_decompress_asm
+.type _lz_decompress_asm, @function
+
+_lz_decompress_asm:
+	# input_end = (last byte of input), used to check if all bytes have been
+	# consumed
+	addu  input_end, input, input_end
+	addiu input_end, -1
+	move  out_ptr, output
+	li    bit_buf, 0
+	li    bit_count, 0
+
+	REFILL
+
+	# Read the 5-bit window size and calculate the base value for offset slots.
+	andi  window_bits, bit_buf, 31
+	srl   bit_buf, 5
+	addiu bit_count, -5
+	addiu slot_base, window_bits, -16
+
+.Ltoken_loop:
+	# The original decoder keeps going as long as it has not pulled all input
+	# bytes into its bit buffer. As bytes are pulled in lazily, this is
+	# equivalent to checking whether (consumed_bits <= (in_size - 1) * 8), or
+	# (((input - input_end) * 8 - bit_count) <= 0) here.
+	subu  temp, input, input_end
+	sll   temp, 3
+	subu  temp, bit_count
+	bgtz  temp, .Ldone
+	nop
+
+	REFILL
+
+	# Check the token type and skip the flag bit. bit_count is updated later.
+	andi  temp, bit_buf, 1
+	beqz  temp, .Lliteral
+	srl   bit_buf, 1
+
+	# Decode the unary length prefix and the length field in one go. The
+	# number of bits consumed includes the flag bit.
+	andi  temp, bit_buf, 1
+	bnez  temp, .Llength_a
+	andi  temp, bit_buf, 2
+	bnez  temp, .Llength_b
+	andi  temp, bit_buf, 4
+	bnez  temp, .Llength_c
+	andi  temp, bit_buf, 8
+	bnez  temp, .Llength_d
+	andi  temp, bit_buf, 16
+	bnez  temp, .Llength_e
+	srl   length, bit_buf, 5
+
+	andi  length, 511 # 00000 xxxxxxxxx
+	addiu length, 52
+	srl   bit_buf, 14
+	b     .Lread_offset
+	addiu bit_count, -15
+
+.Llength_a:
+	srl   length, bit_buf, 1 # 1 xx
+	andi  length, 3
+	srl   bit_buf, 3
+	b     .Lread_offset
+	addiu bit_count, -4
+
+.Llength_b:
+	srl   length, bit_buf, 2 # 01 xx
+	andi  length, 3
+	addiu length, 4
+	srl   bit_buf, 4
+	b     .Lread_offset
+	addiu bit_count, -5
+
+.Llength_c:
+	srl   length, bit_buf, 3 # 001 xx
+	andi  length, 3
+	addiu length, 8
+	srl   bit_buf, 5
+	b     .Lread_offset
+	addiu bit_count, -6
+
+.Llength_d:
+	srl   length, bit_buf, 4 # 0001 xxx
+	andi  length, 7
+	addiu length, 12
+	srl   bit_buf, 7
+	b     .Lread_offset
+	addiu bit_count, -8
+
+.Llength_e:
+	andi  length, 31 # 00001 xxxxx
+	addiu length, 20
+	srl   bit_buf, 10
+	addiu bit_count, -11
+
+.Lread_offset:
+	# Read the 4-bit offset slot (log = slot + window_bits - 16), then refill
+	# the buffer as the offset itself may be up to 22 bits long.
+	andi  temp3, bit_buf, 15
+	srl   bit_buf, 4
+	addiu bit_count, -4
+	addu  temp3, slot_base
+
+	REFILL
+
+	# If log > slot_base, offset = get_bits(log) + (1 << log), otherwise
+	# offset = get_bits(window_bits - 15).
+	bne   temp3, slot_base, .Llong_offset
+	li    temp, 1
+
+	addiu temp3, slot_base, 1
+	sllv  temp, temp, temp3
+	addiu temp, -1
+	and   offset, bit_buf, temp
+	srlv  bit_buf, bit_buf, temp3
+	b     .Lcopy_match
+	subu  bit_count, temp3
+
+.Llong_offset:
+	sllv  temp, temp, temp3
+	addiu temp2, temp, -1
+	and   offset, bit_buf, temp2
+	addu  offset, temp
+	srlv  bit_buf, bit_buf, temp3
+	subu  bit_count, temp3
+
+.Lcopy_match:
+	# source = out_ptr - offset - 1, which must not be before the beginning of
+	# the output buffer. The match is (length + 3) bytes long.
+	subu  source, out_ptr, offset
+	addiu source, -1
+	sltu  temp, source, output
+	bnez  temp, .Lerror
+	addiu length, 3
+
+	# Words can only be copied if the source is at least 4 bytes behind the
+	# destination, otherwise bytes written by the previous iteration would be
+	# read before being written.
+	sltiu temp, offset, 3
+	bnez  temp, .Lcopy_bytes
+	sltiu temp, length, 4
+
+.Lcopy_words:
+	bnez  temp, .Lcopy_bytes
+	nop
+
+	lwl   temp2, 3(source)
+	lwr   temp2, 0(source)
+	addiu source, 4
+	addiu length, -4
+	swl   temp2, 3(out_ptr)
+	swr   temp2, 0(out_ptr)
+	addiu out_ptr, 4
+	b     .Lcopy_words
+	sltiu temp, length, 4
+
+.Lcopy_bytes:
+	# Copy any remaining bytes.
+	beqz  length, .Ltoken_loop
+	nop
+
+.Lcopy_bytes_loop:
+	lbu   temp2, 0(source)
+	addiu source, 1
+	addiu length, -1
+	sb    temp2, 0(out_ptr)
+	bnez  length, .Lcopy_bytes_loop
+	addiu out_ptr, 1
+
+	b     .Ltoken_loop
+	nop
+
+.Lliteral:
+	# Store the 8-bit literal (the flag bit has already been shifted out).
+	andi  temp, bit_buf, 0xff
+	srl   bit_buf, 8
+	addiu bit_count, -9
+	sb    temp, 0(out_ptr)
+	b     .Ltoken_loop
+	addiu out_ptr, 1
+
+.Ldone:
+	jr    $ra
+	subu  value, out_ptr, output
+
+.Lerror:
+	jr    $ra
+	li    value, -1
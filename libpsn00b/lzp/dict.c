@@ -0,0 +1,48 @@
+// Preset dictionary lookup for LZP archives (see lzdict.h)
+
+#include <stddef.h>
+#include <string.h>
+
+#include "lzp.h"
+#include "lzhash.h"
+#include "lzdict.h"
+
+
+const void* lzpGetDictionary(const LZP_HEAD* lzpack, int* dictSize) {
+
+	const LZP_FILE*	fileEntry = (const LZP_FILE*)(((const char*)lzpack)+sizeof(LZP_HEAD));
+	const char*		section = (const char*)(fileEntry+lzpack->numFiles);
+	const char*		dataStart;
+
+	const LZP_HASH*	hash;
+	const LZP_DICT*	dict;
+
+	if (lzpack->numFiles == 0)
+		return(NULL);
+
+	dataStart = ((const char*)lzpack)+fileEntry[0].offset;
+
+	// Skip the name hash table if present
+	hash = (const LZP_HASH*)section;
+
+	if (
+		((section+sizeof(LZP_HASH)) <= dataStart) &&
+		(memcmp(hash->id, LZP_HASH_ID, 4) == 0)
+	)
+		section += (sizeof(LZP_HASH)+hash->numSlots+3)&~3;
+
+	dict = (const LZP_DICT*)section;
+
+	if ((section+sizeof(LZP_DICT)) > dataStart)
+		return(NULL);
+	if (memcmp(dict->id, LZP_DICT_ID, 4) != 0)
+		return(NULL);
+	if ((section+sizeof(LZP_DICT)+dict->size) > dataStart)
+		return(NULL);
+
+	if (dictSize != NULL)
+		*dictSize = dict->size;
+
+	return(dict+1);
+
+}
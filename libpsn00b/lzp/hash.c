@@ -0,0 +1,85 @@
+// Hashed file name lookup for LZP, LZC and QLP archives (see lzhash.h)
+
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "lzp.h"
+#include "lzhash.h"
+
+
+// Compares two file names ignoring case, without copying either of them
+static int nameMatch(const char* a, const char* b) {
+
+	int i;
+
+	for(i=0; i<16; i++) {
+
+		if (tolower(a[i]) != tolower(b[i]))
+			return(0);
+
+		if (a[i] == 0x00)
+			return(1);
+
+	}
+
+	return(a[16] == 0x00);
+
+}
+
+// Searches for a file by name in an archive's file table. entries points to
+// the first entry of the table, whose entries are stride bytes long and begin
+// with a 16-byte file name, and dataStart to the data of the first file.
+// Returns the index of the file or LZP_ERR_NOTFOUND.
+int lzHashSearch(const char* name, const void* entries, int stride, int numFiles, const void* dataStart) {
+
+	const LZP_HASH*	table = (const LZP_HASH*)(((const char*)entries)+(stride*numFiles));
+	const uint8_t*	slots = (const uint8_t*)(table+1);
+	const char*		entryName;
+
+	uint32_t	mask;
+	uint32_t	i;
+	int			probes;
+
+	if (
+		(numFiles > 0) &&
+		((const char*)(table+1) <= (const char*)dataStart) &&
+		(memcmp(table->id, LZP_HASH_ID, 4) == 0) &&
+		((const char*)(slots+table->numSlots) <= (const char*)dataStart)
+	) {
+
+		// Hashed lookup, stops at the first empty slot
+		mask = table->numSlots-1;
+		i = lzHashName(name)&mask;
+
+		for(probes=table->numSlots; probes>0; probes--) {
+
+			if (slots[i] == 0)
+				break;
+
+			entryName = ((const char*)entries)+(stride*(slots[i]-1));
+
+			if (nameMatch(name, entryName))
+				return(slots[i]-1);
+
+			i = (i+1)&mask;
+
+		}
+
+		return(LZP_ERR_NOTFOUND);
+
+	}
+
+	// Fall back to a linear search for archives without a hash table
+	for(i=0; i<(uint32_t)numFiles; i++) {
+
+		entryName = ((const char*)entries)+(stride*i);
+
+		if (nameMatch(name, entryName))
+			return(i);
+
+	}
+
+	return(LZP_ERR_NOTFOUND);
+
+}
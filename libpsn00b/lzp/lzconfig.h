@@ -22,6 +22,21 @@
  */
 //#define LZP_USE_MALLOC
 
+/* Use the hand-optimized assembly implementation of lzDecompress() found in
+ * decompress.s instead of the C one when building for the PlayStation. If you
+ * comment this out, decompress.s is still built but never linked in.
+ */
+#ifdef PSN00BSDK
+#define LZP_ASM_DECOMPRESS
+#endif
+
+/* Uncomment to use a slice-by-4 or slice-by-8 implementation of lzCRC32(),
+ * which processes 4 or 8 bytes per iteration using precomputed tables instead
+ * of building a table on the stack on every call. The tables take up 4 KB or
+ * 8 KB respectively, so this is disabled by default on the PlayStation.
+ */
+//#define LZP_CRC_SLICES	4
+
 
 #if defined(PSN00BSDK) && !defined(LZP_MAX_COMPRESS)
 
@@ -34,6 +49,10 @@
 
 #define LZP_USE_MALLOC
 
+#ifndef LZP_CRC_SLICES
+#define LZP_CRC_SLICES	8
+#endif
+
 // Maximum defaults
 #define LZP_WINDOW_SIZE	17
 #define LZP_HASH1_SIZE	22
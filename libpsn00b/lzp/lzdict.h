@@ -0,0 +1,23 @@
+/*	Preset dictionary section of LZP archives
+ *
+ *	When an archive is created with a dictionary, lzpack stores it
+ *	uncompressed after the name hash table (see lzhash.h) and before the data
+ *	of the first file, so that it can be referenced in place by the
+ *	decompressor. Every file in the archive is then compressed with the
+ *	dictionary.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define LZP_DICT_ID		"LZD1"
+
+//! Dictionary section header, followed by size bytes of dictionary data and
+//! padded to a multiple of 4 bytes
+typedef struct {
+
+	char		id[4];
+	uint32_t	size;
+
+} LZP_DICT;
@@ -0,0 +1,24 @@
+/*	Bitstream format definitions shared by the LZ77 compressor and the
+ *	decompressors (don't touch, changing any of these breaks compatibility
+ *	with existing compressed data)
+ */
+
+#pragma once
+
+#define SLOT_BITS	4
+#define NUM_SLOTS	(1<<SLOT_BITS)
+
+#define A_BITS		2 // 1 xx
+#define B_BITS		2 // 01 xx
+#define C_BITS		2 // 001 xx
+#define D_BITS		3 // 0001 xxx
+#define E_BITS		5 // 00001 xxxxx
+#define F_BITS		9 // 00000 xxxxxxxxx
+#define A			(1<<A_BITS)
+#define B			((1<<B_BITS)+A)
+#define C			((1<<C_BITS)+B)
+#define D			((1<<D_BITS)+C)
+#define E			((1<<E_BITS)+D)
+#define F			((1<<F_BITS)+E)
+#define MIN_MATCH	3
+#define MAX_MATCH	((F-1)+MIN_MATCH)
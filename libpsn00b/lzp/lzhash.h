@@ -0,0 +1,56 @@
+/*	Name hash table shared by LZP, LZC and QLP archives
+ *
+ *	lzpack stores a hash table section right after the file table of an
+ *	archive, before the data of the first file. Readers that are not aware of
+ *	it simply skip it, as file data is always located through the offsets in
+ *	the file table. The table is only used if it fits between the end of the
+ *	file table and the data of the first file, so older archives (whose data
+ *	immediately follows the file table) are searched linearly instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define LZP_HASH_ID		"LZH1"
+
+//! Hash table section header, followed by numSlots one-byte slots each
+//! holding either 0 (empty) or a file index plus one. Collisions are resolved
+//! by linear probing.
+typedef struct {
+
+	char		id[4];
+	uint16_t	numSlots;	// Always a power of two
+	uint16_t	reserved;
+
+} LZP_HASH;
+
+// FNV-1a hash of a lowercase file name (also used by lzpack)
+static inline uint32_t lzHashName(const char* name) {
+
+	uint32_t hash = 2166136261u;
+
+	for(; *name; name++) {
+
+		char c = *name;
+
+		if ((c >= 'A') && (c <= 'Z'))
+			c += 'a'-'A';
+
+		hash = (hash^(uint8_t)c)*16777619u;
+
+	}
+
+	return(hash);
+
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int lzHashSearch(const char* name, const void* entries, int stride, int numFiles, const void* dataStart);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,48 +4,39 @@
 #include <ctype.h>
 
 #include "lzp.h"
+#include "lzhash.h"
 
 
-static char* lcase(char* text) {
+// Regular and chunked archives share the same header and file table
+static int isValidPack(const LZP_HEAD* lzpack) {
 
-    int i;
-
-    for(i=0; text[i]!=0x00; i++)
-        text[i] = tolower(text[i]);
-
-	return(text);
+	return((strncmp("LZP", lzpack->id, 3) == 0) || (strncmp("LZC", lzpack->id, 3) == 0));
 
 }
 
 
 int lzpSearchFile(const char* fileName, const LZP_HEAD* lzpack) {
 
-	int			i;
-    char		searchName[16];
-	char		compareName[16];
-	LZP_FILE*	fileEntry;
-
-	strcpy(searchName, fileName);
-	lcase(searchName);
-
-	fileEntry = (LZP_FILE*)(((const char*)lzpack)+sizeof(LZP_HEAD));
-	for(i=0; i<(lzpack->numFiles); i++) {
+	const LZP_FILE*	fileEntry = (const LZP_FILE*)(((const char*)lzpack)+sizeof(LZP_HEAD));
 
-        strcpy(compareName, fileEntry[i].fileName);
-        lcase(compareName);
+	if (lzpack->numFiles == 0)
+		return(LZP_ERR_NOTFOUND);
 
-        if (strcmp(searchName, compareName) == 0)
-			return(i);
-
-	}
-
-    return(LZP_ERR_NOTFOUND);
+	// Use the hash table if the archive has one, otherwise compare the name
+	// of each entry
+	return(lzHashSearch(
+		fileName,
+		fileEntry,
+		sizeof(LZP_FILE),
+		lzpack->numFiles,
+		((const char*)lzpack)+fileEntry[0].offset
+	));
 
 }
 
 const LZP_FILE* lzpFileEntry(const LZP_HEAD* lzpack, int fileNum) {
 
-	if (strncmp("LZP", lzpack->id, 3) != 0)
+	if (!isValidPack(lzpack))
         return(NULL);
 
 	if ((fileNum < 0) || (fileNum > (lzpack->numFiles-1)))
@@ -57,7 +48,7 @@ const LZP_FILE* lzpFileEntry(const LZP_HEAD* lzpack, int fileNum) {
 
 int lzpFileSize(const LZP_HEAD* lzpack, int fileNum) {
 	
-	if (strncmp("LZP", lzpack->id, 3) != 0)
+	if (!isValidPack(lzpack))
         return 0;
 	
 	if ((fileNum < 0) || (fileNum > (lzpack->numFiles-1)))
@@ -70,17 +61,30 @@ int lzpUnpackFile(void* buff, const LZP_HEAD* lzpack, int fileNum) {
 
 	LZP_FILE*	fileEntry = &((LZP_FILE*)(((const char*)lzpack)+sizeof(LZP_HEAD)))[fileNum];
 	int			unpackedSize;
+	const void*	dict;
+	int			dictSize;
 
 	// Check ID header
-    if (strncmp("LZP", lzpack->id, 3) != 0)
+    if (!isValidPack(lzpack))
         return(LZP_ERR_INVALID_PACK);
 
 	// Do a CRC16 check of the compressed data's integrity
 	if (lzCRC32(((const char*)lzpack)+fileEntry->offset, fileEntry->packedSize, LZP_CRC32_REMAINDER) != fileEntry->crc)
 		return(LZP_ERR_CRC_MISMATCH);
 
-	// Decompress data to the specified address
-	unpackedSize = lzDecompress(buff, ((const char*)lzpack)+fileEntry->offset, fileEntry->packedSize);
+	// Chunked archives store a block index followed by independently
+	// compressed blocks, which must be decompressed one by one
+	if (lzpack->id[2] == 'C')
+		return(lzpUnpackRange(buff, NULL, lzpack, fileNum, 0, fileEntry->fileSize));
+
+	// Decompress data to the specified address, referencing the archive's
+	// preset dictionary if it has one
+	dict = lzpGetDictionary(lzpack, &dictSize);
+
+	if (dict != NULL)
+		unpackedSize = lzDecompressDict(buff, ((const char*)lzpack)+fileEntry->offset, fileEntry->packedSize, dict, dictSize);
+	else
+		unpackedSize = lzDecompress(buff, ((const char*)lzpack)+fileEntry->offset, fileEntry->packedSize);
 	if (unpackedSize < 0)
 		return(unpackedSize);
 
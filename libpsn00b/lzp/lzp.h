@@ -11,7 +11,9 @@
  * can be used to package and compress assets for faster loading, as well as a
  * generic LZ77 compressor and matching decompressor. Two archive formats are
  * supported, one uncompressed (.QLP) and one with individually compressed
- * entries (.LZP).
+ * entries (.LZP). A variant of the latter (.LZC) splits each entry into
+ * independently compressed blocks, allowing any byte range of a file to be
+ * unpacked without decompressing the whole file.
  *
  * This header provides the LZ77 compression API and functions to parse and
  * decompress .LZP archives after they have been loaded into memory.
@@ -50,6 +52,12 @@
 #define LZP_COMPRESS_NORMAL	1
 //! Maximum compression level
 #define LZP_COMPRESS_MAX	2
+//! Optimal parsing (slowest, requires the library to be built with
+//! LZP_USE_MALLOC, otherwise same as LZP_COMPRESS_MAX)
+#define LZP_COMPRESS_OPTIMAL	3
+//! Worst case size of the data produced by lzCompress() from size bytes of
+//! input. Each literal takes 9 bits, so incompressible data grows by 1/8.
+#define LZP_COMPRESS_BOUND(size)	((size)+((size)/8)+256)
 /*!	@}	*/
 
 
@@ -66,13 +74,17 @@
 #define LZP_ERR_NOTFOUND		-3
 //! CRC check mismatch (data corruption)
 #define LZP_ERR_CRC_MISMATCH	-4
+//! Block number or byte range out of bounds
+#define LZP_ERR_RANGE			-5
+//! More input data is required by lzStreamDecompress() (not an error)
+#define LZP_STREAM_MORE			1
 /*! @} */
 
 
 //! Header structure of an LZP format archive file
 typedef struct {
 
-	//! File ID (must always be 'LZP')
+	//! File ID (must always be 'LZP', or 'LZC' for chunked archives)
 	char	    id[3];
 	//! File count
 	uint8_t 	numFiles;
@@ -95,6 +107,84 @@ typedef struct {
 
 } LZP_FILE;
 
+//! Block index of a file in a chunked (.LZC) archive, stored at the
+//! beginning of the file's data
+typedef struct {
+
+	//! Size of each uncompressed block in bytes (the last one may be smaller)
+	uint32_t	blockSize;
+	//! Number of blocks
+	uint32_t	numBlocks;
+	//! Offsets of each block's compressed data relative to the index,
+	//! followed by the offset of the end of the last block
+	uint32_t	offset[];
+
+} LZP_BLOCKS;
+
+//! Context structure for the compressor (see lzInitContext())
+typedef struct {
+
+	//! Sliding window size (17 - 23)
+	short		windowSize;
+	//! Hash table 1 size (10 - 21)
+	short		hash1Size;
+	//! Hash table 2 size (12 - 24)
+	short		hash2Size;
+
+	//! Preset dictionary (see lzSetDictionary())
+	const uint8_t*	dict;
+	//! Size of preset dictionary in bytes
+	int			dictSize;
+
+	// Internal bit writer state
+	uint8_t*	outPtr;
+	int			outBytes;
+	int			bitBuf;
+	int			bitCount;
+
+} LZP_CONTEXT;
+
+//! Context structure for the streaming decompressor (see lzStreamInit())
+typedef struct {
+
+	//! Current position in input chunk
+	const uint8_t*	inPtr;
+	//! Bytes left in input chunk
+	int			inLeft;
+	//! Compressed bytes consumed so far
+	int			inBytes;
+	//! Total size of compressed data
+	int			inSize;
+
+	//! Output buffer
+	uint8_t*	outBuff;
+	//! Bytes decompressed so far
+	int			outBytes;
+	//! Size of output buffer
+	int			outSize;
+
+	//! CRC32 of compressed data consumed so far (see lzStreamVerifyCRC())
+	uint32_t	crc;
+	//! Expected CRC32 of the compressed data
+	uint32_t	expectedCrc;
+	//! Non-zero if the CRC is being verified
+	int			verifyCrc;
+
+	//! Preset dictionary (see lzStreamSetDictionary())
+	const uint8_t*	dict;
+	//! Size of preset dictionary in bytes
+	int			dictSize;
+
+	// Internal decoder state
+	uint32_t	bitBuf;
+	int			bitCount;
+	int			state;
+	int			windowSize;
+	int			len;
+	int			log;
+
+} LZP_STREAM;
+
 
 // Function prototypes
 #ifdef __cplusplus
@@ -113,7 +203,8 @@ extern "C" {
  *	Depending on the size of the input data and speed of the computer, compression
  *	may take a while to complete.
  *
- *	\param[out]	*outBuff	Pointer to buffer to store compressed data.
+ *	\param[out]	*outBuff	Pointer to buffer to store compressed data, at least
+ *							LZP_COMPRESS_BOUND(inSize) bytes large.
  *	\param[in]	*inBuff		Pointer to data to compress.
  *	\param[in]	inSize		Size of data to compress in bytes.
  *	\param[in]	level		Compression level (see \ref compLevels).
@@ -122,6 +213,54 @@ extern "C" {
  */
 int lzCompress(void* outBuff, const void* inBuff, int inSize, int level);
 
+/*! Initializes a compressor context.
+ *
+ *	\details Sets the hash table sizes of a compressor context to the ones
+ *	currently set by lzSetHashSizes(). They can be changed afterwards by
+ *	modifying the windowSize, hash1Size and hash2Size fields of the context.
+ *
+ *	\param[out]	*ctx		Pointer to context to initialize.
+ */
+void lzInitContext(LZP_CONTEXT* ctx);
+
+/*! Compress a block of data using a compressor context.
+ *
+ *	\details Same as lzCompress(), but all compressor state is kept in the
+ *	specified context rather than in global variables. As long as each thread
+ *	uses its own context, this function can be called from multiple threads at
+ *	the same time. The output is identical to the one of lzCompress() with the
+ *	same hash table sizes.
+ *
+ *	\param[in,out]	*ctx	Pointer to context initialized by lzInitContext().
+ *	\param[out]	*outBuff	Pointer to buffer to store compressed data.
+ *	\param[in]	*inBuff		Pointer to data to compress.
+ *	\param[in]	inSize		Size of data to compress in bytes.
+ *	\param[in]	level		Compression level (see \ref compLevels).
+ *
+ *	\returns The size of the compressed data in bytes.
+ */
+int lzCompressCtx(LZP_CONTEXT* ctx, void* outBuff, const void* inBuff, int inSize, int level);
+
+/*! Sets the preset dictionary of a compressor context.
+ *
+ *	\details The window of the compressor is seeded with the contents of the
+ *	dictionary before compressing any data with lzCompressCtx(), so that data
+ *	similar to the dictionary can be compressed as matches from the very
+ *	beginning. This greatly improves the compression ratio of small files that
+ *	share a lot of data with each other (e.g. models or scripts), if the
+ *	dictionary is made out of such data. Only the last (1<<windowSize) bytes
+ *	of the dictionary are used.
+ *
+ *	Data compressed with a dictionary can only be decompressed using
+ *	lzDecompressDict() or lzStreamSetDictionary() with the same dictionary.
+ *	The dictionary must remain valid until compression is done.
+ *
+ *	\param[in,out]	*ctx	Pointer to context initialized by lzInitContext().
+ *	\param[in]	*dict		Pointer to dictionary or NULL to disable it.
+ *	\param[in]	dictSize	Size of dictionary in bytes.
+ */
+void lzSetDictionary(LZP_CONTEXT* ctx, const void* dict, int dictSize);
+
 /*! Decompress a compressed block of data.
  *
  *  \details Decompressed a compressed block of data produced by lzCompress(). It cannot
@@ -141,6 +280,25 @@ int lzCompress(void* outBuff, const void* inBuff, int inSize, int level);
  */
 int lzDecompress(void* outBuff, const void* inBuff, int inSize);
 
+/*! Decompress a compressed block of data using a preset dictionary.
+ *
+ *	\details Same as lzDecompress(), but for data compressed with a dictionary
+ *	set through lzSetDictionary(). Matches that refer to the dictionary are
+ *	copied directly from it, so the dictionary does not have to be copied in
+ *	front of the output buffer. Data compressed without a dictionary can be
+ *	decompressed with this function as well.
+ *
+ *	\param[out]	*outBuff	Pointer to buffer to store decompressed data.
+ *	\param[in]	*inBuff		Pointer to compressed data to decompress.
+ *	\param[in]	inSize		Compressed data size in bytes.
+ *	\param[in]	*dict		Pointer to dictionary used to compress the data.
+ *	\param[in]	dictSize	Size of dictionary in bytes.
+ *
+ *	\returns Size of decompressed data in bytes or LZP_ERR_DECOMPRESS if a
+ *	decompression error occurred.
+ */
+int lzDecompressDict(void* outBuff, const void* inBuff, int inSize, const void* dict, int dictSize);
+
 int lzDecompressLen(void* outBuff, int outSize, const void* inBuff, int inSize);
 
 /*! Sets the sizes of hash tables for data compression.
@@ -158,6 +316,74 @@ void lzResetHashSizes();
 /*!	@}	*/
 
 
+/*! Initializes a streaming decompression context.
+ *
+ *	\details Prepares a context for decompressing data produced by lzCompress()
+ *	in chunks using lzStreamDecompress(). Unlike lzDecompress(), the compressed
+ *	data does not have to be fully loaded in memory before decompression
+ *	begins, allowing decompression to overlap with reading data from CD and
+ *	removing the need to keep both the compressed and decompressed copies of
+ *	the data in RAM. The total size of the compressed data must be known in
+ *	advance.
+ *
+ *	The output buffer must be large enough to hold the entire decompressed
+ *	data, as the decompressor reads back previously decompressed data.
+ *
+ *	\param[out]	*ctx		Pointer to context to initialize.
+ *	\param[out]	*outBuff	Pointer to buffer to store decompressed data.
+ *	\param[in]	outSize		Size of output buffer in bytes.
+ *	\param[in]	inSize		Total size of compressed data in bytes.
+ */
+void lzStreamInit(LZP_STREAM* ctx, void* outBuff, int outSize, int inSize);
+
+/*! Feeds a chunk of compressed data to a streaming decompression context.
+ *
+ *	\details Decompresses as much data as possible from the given chunk, which
+ *	is always fully consumed and may be discarded or reused once this function
+ *	returns. Chunks can be of any size; data past the end of the compressed
+ *	stream (e.g. sector padding) is ignored. The number of bytes decompressed
+ *	so far can be read from the outBytes field of the context, allowing
+ *	decompressed data to be processed incrementally.
+ *
+ *	\param[in,out]	*ctx	Pointer to an initialized context.
+ *	\param[in]	*inBuff		Pointer to chunk of compressed data.
+ *	\param[in]	inSize		Size of chunk in bytes.
+ *
+ *	\returns LZP_STREAM_MORE if more data is required, LZP_ERR_NONE once all
+ *	data has been decompressed, LZP_ERR_DECOMPRESS if a decompression error
+ *	occurred or LZP_ERR_CRC_MISMATCH if CRC verification was enabled and
+ *	failed.
+ */
+int lzStreamDecompress(LZP_STREAM* ctx, const void* inBuff, int inSize);
+
+/*! Enables CRC verification of the compressed data fed to a streaming
+ *	decompression context.
+ *
+ *	\details Must be called after lzStreamInit() and before feeding any data.
+ *	The CRC32 of each chunk is then calculated as it is passed to
+ *	lzStreamDecompress(), which returns LZP_ERR_CRC_MISMATCH instead of
+ *	LZP_ERR_NONE at the end of the stream if it does not match. This avoids
+ *	having to keep the whole compressed file in memory to check it.
+ *
+ *	\param[in,out]	*ctx	Pointer to an initialized context.
+ *	\param[in]	crc			Expected CRC32 of the compressed data (e.g. the crc
+ *							field of an LZP_FILE entry).
+ */
+void lzStreamVerifyCRC(LZP_STREAM* ctx, uint32_t crc);
+
+/*! Sets the preset dictionary of a streaming decompression context.
+ *
+ *	\details Must be called after lzStreamInit() and before feeding any data,
+ *	if the data was compressed with a dictionary (see lzSetDictionary()). The
+ *	dictionary is referenced rather than copied and must remain valid until
+ *	decompression is done.
+ *
+ *	\param[in,out]	*ctx	Pointer to an initialized context.
+ *	\param[in]	*dict		Pointer to dictionary used to compress the data.
+ *	\param[in]	dictSize	Size of dictionary in bytes.
+ */
+void lzStreamSetDictionary(LZP_STREAM* ctx, const void* dict, int dictSize);
+
 /*!	\addtogroup crcFuncs CRC Hashing Functions
  *	\brief Functions to calculate CRC hashes of data.
  *	@{
@@ -177,7 +403,12 @@ uint16_t lzCRC16(const void* buff, int bytes, uint16_t crc);
  *
  *	\param[in]	*buff	Pointer to buffer to calculate a hash of.
  *	\param[in]	bytes	Size of buffer in bytes.
- *	\param[in]	crc		CRC remainder (use LZP_CRC16_REMAINDER).
+ *	\param[in]	crc		CRC remainder (use LZP_CRC32_REMAINDER).
+ *
+ *	\details The hash of data split across multiple buffers can be calculated
+ *	by passing the previous return value XORed with 0xFFFFFFFF as the
+ *	remainder for the next buffer. If LZP_CRC_SLICES is defined in lzconfig.h,
+ *	a faster slice-by-4/8 implementation is used.
  *
  *	\returns CRC32 hash of specified buffer.
  */
@@ -197,6 +428,10 @@ uint32_t lzCRC32(const void* buff, int bytes, uint32_t crc);
  *	\param[in]	*lzpack		Pointer to LZP archive file.
  *
  *	\returns File index of found file or one of \ref libraryErrorCodes if an error occurred.
+ *
+ *	\details The search is case insensitive. Archives created by recent versions
+ *	of lzpack include a name hash table, which allows files to be found without
+ *	comparing every name; archives without one are searched linearly.
  */
 int lzpSearchFile(const char* fileName, const LZP_HEAD* lzpack);
 
@@ -212,6 +447,9 @@ int lzpFileSize(const LZP_HEAD* lzpack, int fileNum);
 const LZP_FILE* lzpFileEntry(const LZP_HEAD* lzpack, int fileNum);
 
 /*! Unpacks a file from an LZP archive to the specified memory buffer.
+ *
+ *	\details Files in chunked (.LZC) archives are unpacked by decompressing
+ *	all of their blocks in order.
  *
  *	\param[in]	*buff	Pointer to buffer to store unpacked file.
  *	\param[in]	*lzpack	Pointer to LZP archive file.
@@ -221,6 +459,91 @@ const LZP_FILE* lzpFileEntry(const LZP_HEAD* lzpack, int fileNum);
  */
 int lzpUnpackFile(void* buff, const LZP_HEAD* lzpack, int fileNum);
 
+/*! Prepares a streaming decompression context to unpack a file from an LZP
+ *	archive.
+ *
+ *	\details Initializes a context with the sizes stored in the given file
+ *	entry. Only the archive's header and file table need to be in memory; the
+ *	file's compressed data (starting at the offset stored in the entry) can
+ *	then be read in chunks and passed to lzStreamDecompress(). The CRC of the
+ *	compressed data is not checked unless lzStreamVerifyCRC() is called with
+ *	the entry's crc field afterwards.
+ *
+ *	\param[out]	*ctx		Pointer to context to initialize.
+ *	\param[out]	*buff		Pointer to buffer to store unpacked file.
+ *	\param[in]	*fileEntry	Pointer to file entry (you may use lzpFileEntry()).
+ *
+ *	\returns LZP_ERR_NONE or LZP_ERR_NOTFOUND if fileEntry is NULL.
+ */
+int lzpStreamFile(LZP_STREAM* ctx, void* buff, const LZP_FILE* fileEntry);
+
+/*! Gets the preset dictionary of an LZP archive.
+ *
+ *	\details Archives created by lzpack with a dictionary store it
+ *	uncompressed between the file table and the data of the first file. All
+ *	files in such archives are compressed with the dictionary, which is used
+ *	automatically by lzpUnpackFile() but must be passed to
+ *	lzStreamSetDictionary() when using lzpStreamFile(). In the latter case,
+ *	the archive must be loaded up to the beginning of the first file's data.
+ *
+ *	\param[in]	*lzpack		Pointer to LZP archive file.
+ *	\param[out]	*dictSize	Pointer to variable to store the size of the
+ *							dictionary in (may be NULL).
+ *
+ *	\returns A pointer to the dictionary within the archive or NULL if the
+ *	archive has no dictionary.
+ */
+const void* lzpGetDictionary(const LZP_HEAD* lzpack, int* dictSize);
+
+/*! Gets the block index of a file in a chunked (.LZC) archive.
+ *
+ *	\details The index can be used to locate and decompress individual blocks
+ *	(e.g. using lzStreamDecompress() while reading the archive from CD), as
+ *	each block is compressed independently. Block n's compressed data starts
+ *	offset[n] bytes after the beginning of the index and is
+ *	(offset[n+1]-offset[n]) bytes long.
+ *
+ *	\param[in]	*lzpack		Pointer to LZC archive file.
+ *	\param[in]	fileNum		File entry number (you may use lzpSearchFile()).
+ *
+ *	\returns A pointer to the file's LZP_BLOCKS index or NULL if the archive
+ *	is not a chunked archive or fileNum is invalid.
+ */
+const LZP_BLOCKS* lzpBlockIndex(const LZP_HEAD* lzpack, int fileNum);
+
+/*! Unpacks a single block of a file from a chunked (.LZC) archive.
+ *
+ *	\param[out]	*buff	Pointer to buffer to store unpacked block (must be
+ *						at least blockSize bytes long).
+ *	\param[in]	*lzpack	Pointer to LZC archive file.
+ *	\param[in]	fileNum	File entry number (you may use lzpSearchFile()).
+ *	\param[in]	blockNum	Block number.
+ *
+ *	\returns Size of decompressed block in bytes or one of \ref libraryErrorCodes if an error occurred.
+ */
+int lzpUnpackBlock(void* buff, const LZP_HEAD* lzpack, int fileNum, int blockNum);
+
+/*! Unpacks a byte range of a file from a chunked (.LZC) archive.
+ *
+ *	\details Only the blocks overlapping the specified range are decompressed.
+ *	Blocks fully within the range are decompressed directly into the output
+ *	buffer, while the first block is decompressed into the scratch buffer if
+ *	the range does not start at a block boundary. The CRC of the file is not
+ *	checked.
+ *
+ *	\param[out]	*buff		Pointer to buffer to store unpacked data.
+ *	\param[out]	*scratch	Pointer to a temporary buffer at least blockSize
+ *							bytes long (only used if offset is not a multiple
+ *							of the block size, may be NULL otherwise).
+ *	\param[in]	*lzpack		Pointer to LZC archive file.
+ *	\param[in]	fileNum		File entry number (you may use lzpSearchFile()).
+ *	\param[in]	offset		Offset of the first byte to unpack.
+ *	\param[in]	size		Number of bytes to unpack.
+ *
+ *	\returns Number of bytes unpacked or one of \ref libraryErrorCodes if an error occurred.
+ */
+int lzpUnpackRange(void* buff, void* scratch, const LZP_HEAD* lzpack, int fileNum, int offset, int size);
+
 /*!	@}	*/
 
 
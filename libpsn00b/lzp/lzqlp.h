@@ -50,7 +50,7 @@ extern "C" {
 int qlpFileCount(const QLP_HEAD* qlpfile);
 const QLP_FILE* qlpFileEntry(int index, const QLP_HEAD* qlpfile);
 const void* qlpFileAddr(int index, const QLP_HEAD* qlpfile);
-int qlpFindFile(char* fileName, const QLP_HEAD* qlpfile);
+int qlpFindFile(const char* fileName, const QLP_HEAD* qlpfile);
 
 #ifdef __cplusplus
 }
@@ -3,17 +3,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "lzqlp.h"
-
-static char* lcase(char* str) {
-
-    while(*str != 0x00) {
-		*str = tolower(*str);
-		str++;
-    }
-
-    return(str);
-
-}
+#include "lzhash.h"
 
 int qlpFileCount(const QLP_HEAD* qlpfile) {
 
@@ -42,24 +32,27 @@ const void* qlpFileAddr(int index, const QLP_HEAD* qlpfile) {
 
 }
 
-int qlpFindFile(char* fileName, const QLP_HEAD* qlpfile) {
-
-	int i;
-	char nameBuff[2][16];
+int qlpFindFile(const char* fileName, const QLP_HEAD* qlpfile) {
 
-    strcpy(nameBuff[0], fileName);
-    lcase(nameBuff[0]);
+	const QLP_FILE*	fileEntry = (const QLP_FILE*)(((const char*)qlpfile)+sizeof(QLP_HEAD));
+	int				index;
 
-	for(i=0; i<(qlpfile->numfiles); i++) {
+	if (qlpfile->numfiles == 0)
+		return(PACK_ERR_NOTFOUND);
 
-		strcpy(nameBuff[1], ((QLP_FILE*)(((const char*)qlpfile)+sizeof(QLP_HEAD)))[i].name);
-        lcase(nameBuff[1]);
+	// Use the hash table if the archive has one, otherwise compare the name
+	// of each entry
+	index = lzHashSearch(
+		fileName,
+		fileEntry,
+		sizeof(QLP_FILE),
+		qlpfile->numfiles,
+		((const char*)qlpfile)+fileEntry[0].offs
+	);
 
-        if (strcmp(nameBuff[0], nameBuff[1]) == 0)
-			return(i);
+	if (index < 0)
+		return(PACK_ERR_NOTFOUND);
 
-	}
+	return(index);
 
-	return(PACK_ERR_NOTFOUND);
-
-}
\ No newline at end of file
+}
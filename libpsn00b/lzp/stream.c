@@ -0,0 +1,282 @@
+// Streaming (resumable) LZ77 decompressor
+//
+// Unlike lzDecompress(), this decoder keeps all of its state in an LZP_STREAM
+// context and can be fed compressed data in arbitrarily sized chunks (e.g. one
+// CD sector at a time), suspending itself whenever it runs out of input bits
+// in the middle of a token.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lzp.h"
+#include "lzformat.h"
+
+
+// Decoder states
+enum {
+	STATE_WINDOW = 0,	// Reading window size
+	STATE_FLAG,			// Reading literal/match flag
+	STATE_PREFIX,		// Reading unary length prefix
+	STATE_LENGTH,		// Reading match length
+	STATE_SLOT,			// Reading offset slot
+	STATE_OFFSET,		// Reading offset
+	STATE_LITERAL,		// Reading literal byte
+	STATE_DONE
+};
+
+static const uint8_t lenBits[] = { A_BITS, B_BITS, C_BITS, D_BITS, E_BITS, F_BITS };
+static const uint16_t lenBase[] = { 0, A, B, C, D, E };
+
+
+// Makes sure at least n bits are available in the bit buffer, pulling bytes
+// from the current input chunk. Bytes are only consumed when needed, exactly
+// like get_bits() does, so that the end of the stream is detected at the same
+// point as in lzDecompress().
+static int needBits(LZP_STREAM* ctx, int n) {
+
+	while(ctx->bitCount < n) {
+
+		if (ctx->inLeft <= 0)
+			return(0);
+
+		ctx->bitBuf |= ((uint32_t)*ctx->inPtr)<<ctx->bitCount;
+		ctx->inPtr++;
+		ctx->inLeft--;
+		ctx->inBytes++;
+
+		ctx->bitCount += 8;
+
+	}
+
+	return(1);
+
+}
+
+static int takeBits(LZP_STREAM* ctx, int n) {
+
+	int x;
+
+	x = ctx->bitBuf&((1<<n)-1);
+	ctx->bitBuf >>= n;
+	ctx->bitCount -= n;
+
+	return(x);
+
+}
+
+
+void lzStreamInit(LZP_STREAM* ctx, void* outBuff, int outSize, int inSize) {
+
+	ctx->inPtr		= NULL;
+	ctx->inLeft		= 0;
+	ctx->inBytes	= 0;
+	ctx->inSize		= inSize;
+
+	ctx->outBuff	= (uint8_t*)outBuff;
+	ctx->outBytes	= 0;
+	ctx->outSize	= outSize;
+
+	ctx->crc			= LZP_CRC32_REMAINDER;
+	ctx->expectedCrc	= 0;
+	ctx->verifyCrc		= 0;
+
+	ctx->dict		= NULL;
+	ctx->dictSize	= 0;
+
+	ctx->bitBuf		= 0;
+	ctx->bitCount	= 0;
+
+	ctx->state		= STATE_WINDOW;
+	ctx->windowSize	= 0;
+	ctx->len		= 0;
+	ctx->log		= 0;
+
+}
+
+int lzStreamDecompress(LZP_STREAM* ctx, const void* inBuff, int inSize) {
+
+	uint8_t*	outPtr = ctx->outBuff;
+	int			p = ctx->outBytes;
+	int			bits;
+	int			s;
+
+	if (ctx->state == STATE_DONE)
+		goto suspend;
+
+	// Never read past the end of the compressed stream, as the last chunk
+	// may be padded (e.g. to a sector boundary)
+	if (inSize > (ctx->inSize-ctx->inBytes))
+		inSize = ctx->inSize-ctx->inBytes;
+
+	ctx->inPtr	= (const uint8_t*)inBuff;
+	ctx->inLeft	= inSize;
+
+	// The chunk is always fully consumed, so its CRC can be calculated upfront
+	if (ctx->verifyCrc && (inSize > 0))
+		ctx->crc = lzCRC32(inBuff, inSize, ctx->crc)^0xFFFFFFFF;
+
+	for(;;) {
+
+		switch(ctx->state) {
+
+			case STATE_WINDOW:
+
+				if (!needBits(ctx, 5))
+					goto suspend;
+
+				ctx->windowSize = takeBits(ctx, 5);
+				ctx->state = STATE_FLAG;
+				break;
+
+			case STATE_FLAG:
+
+				// The stream ends once all compressed bytes have been pulled
+				// into the bit buffer and the current token is complete.
+				if (ctx->inBytes >= ctx->inSize) {
+					ctx->state = STATE_DONE;
+					goto suspend;
+				}
+
+				if (!needBits(ctx, 1))
+					goto suspend;
+
+				if (takeBits(ctx, 1)) {
+					ctx->len = 0;
+					ctx->state = STATE_PREFIX;
+				} else {
+					ctx->state = STATE_LITERAL;
+				}
+				break;
+
+			case STATE_PREFIX:
+
+				// ctx->len holds the number of prefix bits read so far, which
+				// is also the length class index
+				if (ctx->len < 5) {
+
+					if (!needBits(ctx, 1))
+						goto suspend;
+
+					if (!takeBits(ctx, 1)) {
+						ctx->len++;
+						break;
+					}
+
+				}
+
+				ctx->state = STATE_LENGTH;
+				break;
+
+			case STATE_LENGTH:
+
+				bits = lenBits[ctx->len];
+
+				if (!needBits(ctx, bits))
+					goto suspend;
+
+				ctx->len = takeBits(ctx, bits)+lenBase[ctx->len];
+				ctx->state = STATE_SLOT;
+				break;
+
+			case STATE_SLOT:
+
+				if (!needBits(ctx, SLOT_BITS))
+					goto suspend;
+
+				ctx->log = takeBits(ctx, SLOT_BITS)+(ctx->windowSize-NUM_SLOTS);
+				ctx->state = STATE_OFFSET;
+				break;
+
+			case STATE_OFFSET:
+
+				if (ctx->log > (ctx->windowSize-NUM_SLOTS))
+					bits = ctx->log;
+				else
+					bits = ctx->windowSize-(NUM_SLOTS-1);
+
+				if (!needBits(ctx, bits))
+					goto suspend;
+
+				if (ctx->log > (ctx->windowSize-NUM_SLOTS))
+					s = p-(takeBits(ctx, bits)+(1<<ctx->log))-1;
+				else
+					s = p-takeBits(ctx, bits)-1;
+
+				if ((s < -ctx->dictSize) || ((p+ctx->len+MIN_MATCH) > ctx->outSize))
+					return(LZP_ERR_DECOMPRESS);
+
+				ctx->len += MIN_MATCH;
+
+				// Copy the part of the match that lies in the dictionary (if
+				// any) straight from it
+				for(; (s < 0) && (ctx->len != 0); ctx->len--)
+					outPtr[p++] = ctx->dict[ctx->dictSize+(s++)];
+
+				while(ctx->len-- != 0)
+					outPtr[p++] = outPtr[s++];
+
+				ctx->state = STATE_FLAG;
+				break;
+
+			case STATE_LITERAL:
+
+				if (!needBits(ctx, 8))
+					goto suspend;
+
+				if (p >= ctx->outSize)
+					return(LZP_ERR_DECOMPRESS);
+
+				outPtr[p++] = takeBits(ctx, 8);
+				ctx->state = STATE_FLAG;
+				break;
+
+			default:
+
+				goto suspend;
+
+		}
+
+	}
+
+suspend:
+
+	ctx->outBytes = p;
+
+	if (ctx->state == STATE_DONE) {
+
+		if (ctx->verifyCrc && ((ctx->crc^0xFFFFFFFF) != ctx->expectedCrc))
+			return(LZP_ERR_CRC_MISMATCH);
+
+		return(LZP_ERR_NONE);
+
+	}
+
+	return(LZP_STREAM_MORE);
+
+}
+
+void lzStreamSetDictionary(LZP_STREAM* ctx, const void* dict, int dictSize) {
+
+	ctx->dict		= (const uint8_t*)dict;
+	ctx->dictSize	= dictSize;
+
+}
+
+void lzStreamVerifyCRC(LZP_STREAM* ctx, uint32_t crc) {
+
+	ctx->crc			= LZP_CRC32_REMAINDER;
+	ctx->expectedCrc	= crc;
+	ctx->verifyCrc		= 1;
+
+}
+
+int lzpStreamFile(LZP_STREAM* ctx, void* buff, const LZP_FILE* fileEntry) {
+
+	if (fileEntry == NULL)
+		return(LZP_ERR_NOTFOUND);
+
+	lzStreamInit(ctx, buff, fileEntry->fileSize, fileEntry->packedSize);
+
+	return(LZP_ERR_NONE);
+
+}
@@ -0,0 +1,317 @@
+/*
+ * PSn00bSDK CD-ROM library (PCK v2 archive reader)
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * PCK v2 archives, created by lzpack, consist of a table of contents (header,
+ * entries sorted by name hash and a name table) followed by the data of each
+ * entry, all aligned to sector boundaries. The TOC is loaded into main RAM
+ * once by CdOpenPack(); entries are then read directly from the disc and, if
+ * compressed, decompressed on the fly using the LZP streaming decompressor.
+ *
+ * Compressed entries are read with a single CdlReadN command. The sector
+ * callback stores each sector into a small ring buffer as soon as it arrives,
+ * while the main loop feeds the sectors in the ring buffer to the decompressor.
+ * Reading is only paused (and later resumed from the first missing sector) if
+ * the ring buffer fills up or if the drive stops delivering sectors.
+ */
+
+#undef  SDK_LIBRARY_NAME
+#define SDK_LIBRARY_NAME "psxcd/pack"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <psxgpu.h>
+#include <psxapi.h>
+#include <psxcd.h>
+#include <lzp/lzp.h>
+
+#define SECTOR_SIZE		2048
+#define RING_SECTORS	4
+#define READ_ATTEMPTS	3
+
+#define CD_READ_TIMEOUT		180
+#define CD_READ_COOLDOWN	60
+
+/* Internal globals */
+
+// Used as a ring buffer for compressed data, and to read the TOC header and
+// partial sectors.
+static uint32_t _ring_buffer[RING_SECTORS][SECTOR_SIZE / 4];
+
+static volatile int _total_sectors, _sectors_read, _sectors_used;
+static volatile int _reading, _read_timeout;
+
+extern CdlCB _cd_override_callback;
+
+/* Private utilities */
+
+static int _read_sectors(int lba, int sectors, uint32_t *buffer) {
+	CdlLOC pos;
+
+	CdIntToPos(lba, &pos);
+	if (!CdControl(CdlSetloc, &pos, 0))
+		return -1;
+	if (!CdReadRetry(sectors, buffer, CdlModeSpeed, READ_ATTEMPTS))
+		return -1;
+
+	return CdReadSync(0, 0) ? -1 : 0;
+}
+
+static void _set_override_callback(CdlCB func) {
+	FastEnterCriticalSection();
+	_cd_override_callback = func;
+	FastExitCriticalSection();
+}
+
+static void _ring_callback(CdlIntrResult irq, uint8_t *result) {
+	if (irq == CdlDataReady) {
+		if ((_sectors_read - _sectors_used) < RING_SECTORS) {
+			CdGetSector(_ring_buffer[_sectors_read % RING_SECTORS], SECTOR_SIZE / 4);
+
+			if (++_sectors_read < _total_sectors) {
+				_read_timeout = VSync(-1) + CD_READ_TIMEOUT;
+				return;
+			}
+		}
+	}
+
+	// Stop reading if all sectors have been read or if the ring buffer is full
+	// (in which case the sector just received is discarded and read again
+	// once reading is resumed).
+	CdCommandF(CdlPause, 0, 0);
+
+	_reading      = 0;
+	_read_timeout = VSync(-1) + CD_READ_COOLDOWN;
+}
+
+static int _start_ring_read(int lba) {
+	CdlLOC pos;
+
+	CdIntToPos(lba, &pos);
+
+	_reading      = 1;
+	_read_timeout = VSync(-1) + CD_READ_TIMEOUT;
+
+	if (!CdControl(CdlReadN, &pos, 0)) {
+		_reading = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int _read_compressed(
+	const PCK_Archive *pack, const PCK_Entry *entry, void *buffer
+) {
+	LZP_STREAM ctx;
+	int        lba      = pack->lba + entry->offset;
+	int        sectors  = (entry->packed_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	int        attempts = READ_ATTEMPTS;
+	int        error    = LZP_STREAM_MORE;
+	uint8_t    mode     = CdlModeSpeed;
+
+	if (CdReadSync(1, 0) > 0) {
+		_sdk_log("another read in progress\n");
+		return -1;
+	}
+	if (!CdControl(CdlSetmode, &mode, 0))
+		return -1;
+
+	lzStreamInit(&ctx, buffer, entry->size, entry->packed_size);
+
+	_total_sectors = sectors;
+	_sectors_read  = 0;
+	_sectors_used  = 0;
+
+	_set_override_callback(&_ring_callback);
+
+	if (_start_ring_read(lba))
+		error = -1;
+
+	while ((error == LZP_STREAM_MORE) && (_sectors_used < sectors)) {
+		// Decompress the next sector as soon as it is in the ring buffer.
+		if (_sectors_read > _sectors_used) {
+			error = lzStreamDecompress(
+				&ctx, _ring_buffer[_sectors_used % RING_SECTORS], SECTOR_SIZE
+			);
+
+			_sectors_used++;
+			continue;
+		}
+
+		if (_reading) {
+			if (VSync(-1) < _read_timeout)
+				continue;
+
+			// The drive stopped delivering sectors, most likely due to a read
+			// error. Pause it and try again from the first missing sector.
+			_sdk_log("read timeout, retrying (%d sectors pending)\n", sectors - _sectors_read);
+			CdCommandF(CdlPause, 0, 0);
+
+			_reading      = 0;
+			_read_timeout = VSync(-1) + CD_READ_COOLDOWN;
+
+			if (!(attempts--)) {
+				error = -1;
+				break;
+			}
+		}
+
+		// Reading was paused, either by the code above or because the ring
+		// buffer filled up. The drive does not process commands properly for
+		// some time after CdlPause (see cdread.c), so wait before resuming.
+		if (VSync(-1) < _read_timeout)
+			continue;
+		if (_start_ring_read(lba + _sectors_read))
+			error = -1;
+	}
+
+	// Reading may still be in progress if the end of the compressed data was
+	// reached before the end of the last sector, or if an error occurred.
+	_set_override_callback((CdlCB) 0);
+
+	if (_reading)
+		CdControlB(CdlPause, 0, 0);
+
+	_reading = 0;
+
+	if (error < 0)
+		return -1;
+
+	return (ctx.outBytes == entry->size) ? ctx.outBytes : -1;
+}
+
+static int _read_uncompressed(
+	const PCK_Archive *pack, const PCK_Entry *entry, void *buffer
+) {
+	int lba     = pack->lba + entry->offset;
+	int sectors = entry->size / SECTOR_SIZE;
+	int partial = entry->size % SECTOR_SIZE;
+
+	// Read all full sectors straight into the buffer, then copy the last
+	// partial sector (if any) through the ring buffer so that the output
+	// buffer does not have to be rounded up to a multiple of the sector size.
+	if (sectors && _read_sectors(lba, sectors, (uint32_t *) buffer))
+		return -1;
+
+	if (partial) {
+		if (_read_sectors(lba + sectors, 1, _ring_buffer[0]))
+			return -1;
+
+		memcpy(
+			(uint8_t *) buffer + sectors * SECTOR_SIZE,
+			_ring_buffer[0],
+			partial
+		);
+	}
+
+	return entry->size;
+}
+
+/* Public API */
+
+uint32_t CdHashPackName(const char *name) {
+	uint32_t hash = 2166136261;
+
+	// FNV-1a of the lowercase name
+	for (; *name; name++)
+		hash = (hash ^ (uint8_t) tolower(*name)) * 16777619;
+
+	return hash;
+}
+
+int CdOpenPack(PCK_Archive *pack, const CdlLOC *loc) {
+	_sdk_validate_args(pack && loc, -1);
+
+	pack->lba     = CdPosToInt(loc);
+	pack->toc     = 0;
+	pack->entries = 0;
+
+	if (_read_sectors(pack->lba, 1, _ring_buffer[0]))
+		return -1;
+
+	const PCK_Header *header = (const PCK_Header *) _ring_buffer[0];
+
+	if (memcmp(header->magic, "PCK2", 4)) {
+		_sdk_log("not a PCK v2 archive\n");
+		return -1;
+	}
+
+	// Load the whole TOC, which may span more than one sector.
+	int sectors = (header->toc_length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+	pack->toc = malloc(sectors * SECTOR_SIZE);
+	if (!pack->toc) {
+		_sdk_log("unable to allocate %d bytes for TOC\n", sectors * SECTOR_SIZE);
+		return -1;
+	}
+
+	if (_read_sectors(pack->lba, sectors, (uint32_t *) pack->toc)) {
+		CdClosePack(pack);
+		return -1;
+	}
+
+	pack->entries = (const PCK_Entry *) &pack->toc[1];
+	return 0;
+}
+
+void CdClosePack(PCK_Archive *pack) {
+	if (pack->toc)
+		free(pack->toc);
+
+	pack->toc     = 0;
+	pack->entries = 0;
+}
+
+int CdFindPackEntry(const PCK_Archive *pack, const char *name) {
+	_sdk_validate_args(pack && pack->toc && name, -1);
+
+	uint32_t hash = CdHashPackName(name);
+	int      low  = 0, high = (int) pack->toc->num_entries;
+
+	// Entries are sorted by hash, so a binary search can be used to find the
+	// first entry with a matching hash. Names are then compared to rule out
+	// collisions.
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (pack->entries[mid].hash < hash)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (; low < (int) pack->toc->num_entries; low++) {
+		const PCK_Entry *entry = &pack->entries[low];
+
+		if (entry->hash != hash)
+			break;
+
+		const char *entry_name = (const char *) pack->toc + entry->name_offset;
+		const char *ptr        = name;
+
+		while (*ptr && (tolower(*ptr) == tolower(*entry_name))) {
+			ptr++;
+			entry_name++;
+		}
+		if (!*ptr && !*entry_name)
+			return low;
+	}
+
+	return -1;
+}
+
+int CdReadPackEntry(const PCK_Archive *pack, int index, void *buffer) {
+	_sdk_validate_args(pack && pack->toc && buffer, -1);
+	_sdk_validate_args((index >= 0) && (index < (int) pack->toc->num_entries), -1);
+
+	const PCK_Entry *entry = &pack->entries[index];
+
+	if (entry->packed_size)
+		return _read_compressed(pack, entry, buffer);
+	else
+		return _read_uncompressed(pack, entry, buffer);
+}
@@ -0,0 +1,187 @@
+# Batched GTE transformation functions
+#
+# These functions process whole arrays of vectors with a single call using the
+# matrices and light settings currently loaded in the GTE, which are left
+# untouched, instead of reloading them for every vector. Vectors are processed
+# three at a time using the triple GTE commands whenever possible. MVMVA has no
+# triple variant, so ApplyMatrixN() instead fetches the next vector while the
+# GTE is busy with the current one.
+
+.set noreorder
+
+.include "gtereg.inc"
+.include "inline_s.inc"
+
+.section .text.RotTransPersN
+.global RotTransPersN
+.type RotTransPersN, @function
+RotTransPersN:
+	# a0 - Pointer to input vectors (SVECTOR)
+	# a1 - Pointer to output screen coordinates (DVECTOR)
+	# a2 - Pointer to output depth values (uint16_t)
+	# a3 - Number of vectors
+	# v0 - GTE flags of all vectors ORed together (return)
+
+	addiu	$a3, -3
+	bltz	$a3, .Lrtpn_tail
+	move	$v0, $0
+
+.Lrtpn_loop:
+	lwc2	C2_VXY0, 0($a0)			# Project 3 vectors at a time
+	lwc2	C2_VZ0 , 4($a0)
+	lwc2	C2_VXY1, 8($a0)
+	lwc2	C2_VZ1 , 12($a0)
+	lwc2	C2_VXY2, 16($a0)
+	lwc2	C2_VZ2 , 20($a0)
+	addiu	$a0, 24
+	addiu	$a3, -3
+
+	RTPT
+
+	swc2	C2_SXY0, 0($a1)
+	swc2	C2_SXY1, 4($a1)
+	swc2	C2_SXY2, 8($a1)
+	mfc2	$t0, C2_SZ1
+	mfc2	$t1, C2_SZ2
+	mfc2	$t2, C2_SZ3
+	cfc2	$t3, C2_FLAG
+	sh		$t0, 0($a2)
+	sh		$t1, 2($a2)
+	sh		$t2, 4($a2)
+	or		$v0, $t3
+
+	addiu	$a1, 12
+	bgez	$a3, .Lrtpn_loop
+	addiu	$a2, 6
+
+.Lrtpn_tail:
+	addiu	$a3, 3					# Project the remaining 1-2 vectors
+	blez	$a3, .Lrtpn_exit
+	nop
+
+.Lrtpn_tail_loop:
+	lwc2	C2_VXY0, 0($a0)
+	lwc2	C2_VZ0 , 4($a0)
+	addiu	$a0, 8
+	addiu	$a3, -1
+
+	RTPS
+
+	swc2	C2_SXY2, 0($a1)
+	mfc2	$t0, C2_SZ3
+	cfc2	$t3, C2_FLAG
+	sh		$t0, 0($a2)
+	or		$v0, $t3
+
+	addiu	$a1, 4
+	bgtz	$a3, .Lrtpn_tail_loop
+	addiu	$a2, 2
+
+.Lrtpn_exit:
+	jr		$ra
+	nop
+
+.section .text.ApplyMatrixN
+.global ApplyMatrixN
+.type ApplyMatrixN, @function
+ApplyMatrixN:
+	# a0 - Pointer to matrix (only the rotation part is used)
+	# a1 - Pointer to input vectors (SVECTOR)
+	# a2 - Pointer to output vectors (SVECTOR)
+	# a3 - Number of vectors
+
+	lw		$t0, 0($a0)				# Load matrix to GTE
+	lw		$t1, 4($a0)
+	ctc2	$t0, C2_R11R12
+	ctc2	$t1, C2_R13R21
+	lw		$t0, 8($a0)
+	lw		$t1, 12($a0)
+	lhu		$t2, 16($a0)
+	ctc2	$t0, C2_R22R23
+	ctc2	$t1, C2_R31R32
+	blez	$a3, .Lamn_exit
+	ctc2	$t2, C2_R33
+
+	lw		$t3, 0($a1)				# Fetch the first vector
+	lw		$t4, 4($a1)
+
+.Lamn_loop:
+	mtc2	$t3, C2_VXY0
+	mtc2	$t4, C2_VZ0
+	addiu	$a1, 8
+	addiu	$a3, -1
+
+	MVMVA(1, 0, 0, 3, 0)
+
+	blez	$a3, .Lamn_store		# Fetch the next vector (if any) while
+	nop								# MVMVA is running
+	lw		$t3, 0($a1)
+	lw		$t4, 4($a1)
+
+.Lamn_store:
+	mfc2	$t0, C2_IR1
+	mfc2	$t1, C2_IR2
+	mfc2	$t2, C2_IR3
+	sh		$t0, 0($a2)
+	sh		$t1, 2($a2)
+	sh		$t2, 4($a2)
+
+	bgtz	$a3, .Lamn_loop
+	addiu	$a2, 8
+
+.Lamn_exit:
+	jr		$ra
+	nop
+
+.section .text.NormalColorN
+.global NormalColorN
+.type NormalColorN, @function
+NormalColorN:
+	# a0 - Pointer to input normals (SVECTOR)
+	# a1 - Pointer to output colors (CVECTOR)
+	# a2 - Number of normals
+
+	addiu	$a2, -3
+	bltz	$a2, .Lncn_tail
+	nop
+
+.Lncn_loop:
+	lwc2	C2_VXY0, 0($a0)			# Light 3 normals at a time
+	lwc2	C2_VZ0 , 4($a0)
+	lwc2	C2_VXY1, 8($a0)
+	lwc2	C2_VZ1 , 12($a0)
+	lwc2	C2_VXY2, 16($a0)
+	lwc2	C2_VZ2 , 20($a0)
+	addiu	$a0, 24
+	addiu	$a2, -3
+
+	NCT
+
+	swc2	C2_RGB0, 0($a1)
+	swc2	C2_RGB1, 4($a1)
+	swc2	C2_RGB2, 8($a1)
+
+	bgez	$a2, .Lncn_loop
+	addiu	$a1, 12
+
+.Lncn_tail:
+	addiu	$a2, 3					# Light the remaining 1-2 normals
+	blez	$a2, .Lncn_exit
+	nop
+
+.Lncn_tail_loop:
+	lwc2	C2_VXY0, 0($a0)
+	lwc2	C2_VZ0 , 4($a0)
+	addiu	$a0, 8
+	addiu	$a2, -1
+
+	NCS
+
+	swc2	C2_RGB2, 0($a1)
+
+	bgtz	$a2, .Lncn_tail_loop
+	addiu	$a1, 4
+
+.Lncn_exit:
+	jr		$ra
+	nop
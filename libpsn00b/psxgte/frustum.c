@@ -0,0 +1,215 @@
+/*
+ * PSn00bSDK view frustum culling library
+ * (C) 2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * InitFrustum() takes the view matrix and projection parameters currently set
+ * in the GTE and calculates the six planes of the view frustum in world space,
+ * as two matrices each holding three plane normals in their rows and the
+ * respective plane distances in their translation vectors. With one of those
+ * matrices loaded into the GTE, a single MVMVA command returns the signed
+ * distances of a point from three planes at once.
+ *
+ * Objects are culled in two passes, one for each group of planes, so that
+ * each plane matrix only has to be loaded once. The second pass only goes
+ * through the objects that survived the first one. Boxes additionally use
+ * matrices holding the absolute values of the plane normals, which turn the
+ * box's half-size into its extent along each plane normal.
+ */
+
+#include <stdint.h>
+#include <psxgte.h>
+#include <inline_c.h>
+
+// Each component of a plane normal stored in a matrix is off by at most one
+// unit after rounding, so the distance of a point with coordinates in the
+// SVECTOR range (-32768 to 32767) can be off by up to 3 * 32767 / 4096 = 24.
+// Objects further away from the world origin may be culled even though they
+// are barely inside the frustum.
+#define PLANE_MARGIN	24
+
+/* Private utilities */
+
+// Returns (n * v) >> 12, rounded to nearest, without overflowing for large v.
+static int _scale(int n, int v) {
+	return (n * (v >> 12)) + ((n * (v & 0xfff) + 2048) >> 12);
+}
+
+// Normalizes a vector to a length of ONE, rounding each component to nearest.
+// The vector is first scaled so that its largest component is in 0x2000-0x3fff
+// range, which keeps the squared length within 32 bits while allowing
+// SquareRoot0() to calculate the length precisely enough.
+static void _normalize(const int *vector, int *normal) {
+	int v[3], max = 0;
+
+	for (int i = 0; i < 3; i++) {
+		v[i] = vector[i];
+
+		if (((v[i] < 0) ? -v[i] : v[i]) > max)
+			max = (v[i] < 0) ? -v[i] : v[i];
+	}
+
+	if (!max) {
+		normal[0] = 0;
+		normal[1] = 0;
+		normal[2] = 0;
+		return;
+	}
+
+	for (; max < 0x2000; max *= 2) {
+		v[0] *= 2;
+		v[1] *= 2;
+		v[2] *= 2;
+	}
+	for (; max >= 0x4000; max /= 2) {
+		v[0] /= 2;
+		v[1] /= 2;
+		v[2] /= 2;
+	}
+
+	int len = SquareRoot0(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+	for (int i = 0; i < 3; i++)
+		normal[i] = (v[i] * ONE + ((v[i] < 0) ? -len : len) / 2) / len;
+}
+
+// Rotates a view space plane normal into world space (by multiplying it by the
+// transposed view matrix) and stores it into the given row of the plane and
+// extent matrices.
+static void _set_plane(
+	FRUSTUM *f, int index, const MATRIX *view, const int *normal, int dist
+) {
+	MATRIX *planes  = &f->planes[index / 3];
+	MATRIX *extents = &f->extents[index / 3];
+	int    row      = index % 3;
+
+	for (int i = 0; i < 3; i++) {
+		int value = (
+			normal[0] * view->m[0][i] +
+			normal[1] * view->m[1][i] +
+			normal[2] * view->m[2][i] + 2048
+		) >> 12;
+
+		planes->m[row][i]  = value;
+		extents->m[row][i] = (value < 0) ? -value : value;
+	}
+
+	// The distance is increased to make up for rounding errors, so objects
+	// that are barely inside the frustum don't get culled.
+	planes->t[row] = dist + PLANE_MARGIN +
+		_scale(normal[0], view->t[0]) +
+		_scale(normal[1], view->t[1]) +
+		_scale(normal[2], view->t[2]);
+}
+
+/* Public API */
+
+void InitFrustum(FRUSTUM *f, int w, int h, int znear, int zfar) {
+	MATRIX view;
+	int    proj, ofx, ofy;
+
+	gte_ReadRotMatrix(&view);
+	gte_ReadGeomScreen(&proj);
+	gte_ReadGeomOffset(&ofx, &ofy);
+
+	// A point is on the inner side of e.g. the left plane if
+	// (ofx + proj * x / z) >= 0, i.e. (proj * x + ofx * z) >= 0. The side
+	// planes all go through the camera, so their distances only come from
+	// the view matrix's translation.
+	const int edges[4][3] = {
+		{  proj,     0, ofx     },
+		{ -proj,     0, w - ofx },
+		{     0,  proj, ofy     },
+		{     0, -proj, h - ofy }
+	};
+
+	for (int i = 0; i < 4; i++) {
+		int normal[3];
+
+		_normalize(edges[i], normal);
+		_set_plane(f, i, &view, normal, 0);
+	}
+
+	const int near_normal[3] = { 0, 0,  ONE };
+	const int far_normal[3]  = { 0, 0, -ONE };
+	const int no_normal[3]   = { 0, 0,    0 };
+
+	_set_plane(f, 4, &view, near_normal, -znear);
+
+	// A far plane with a null normal and a positive distance never rejects
+	// anything.
+	if (zfar > 0)
+		_set_plane(f, 5, &view, far_normal, zfar);
+	else
+		_set_plane(f, 5, &view, no_normal, 0x7fff0000);
+}
+
+int FrustumCullSpheres(FRUSTUM *f, SVECTOR *spheres, uint16_t *visible, int n) {
+	VECTOR dist;
+	int    count = n;
+
+	for (int pass = 0; pass < 2; pass++) {
+		int num = count;
+
+		count = 0;
+		gte_SetRotMatrix(&f->planes[pass]);
+		gte_SetTransMatrix(&f->planes[pass]);
+
+		for (int i = 0; i < num; i++) {
+			int           index  = pass ? visible[i] : i;
+			const SVECTOR *sphere = &spheres[index];
+			int           radius = -sphere->pad;
+
+			// The radius is kept in the upper half of the VZ0 word and ignored
+			// by the GTE.
+			gte_ldv0(sphere);
+			gte_mvmva(1, 0, 0, 0, 0);
+			gte_stlvnl(&dist);
+
+			if ((dist.vx < radius) || (dist.vy < radius) || (dist.vz < radius))
+				continue;
+
+			visible[count++] = index;
+		}
+	}
+
+	return count;
+}
+
+int FrustumCullBoxes(FRUSTUM *f, AABB *boxes, uint16_t *visible, int n) {
+	VECTOR dist, extent;
+	int    count = n;
+
+	for (int pass = 0; pass < 2; pass++) {
+		int num = count;
+
+		count = 0;
+		gte_SetRotMatrix(&f->planes[pass]);
+		gte_SetTransMatrix(&f->planes[pass]);
+		gte_SetLightMatrix(&f->extents[pass]);
+
+		for (int i = 0; i < num; i++) {
+			int        index = pass ? visible[i] : i;
+			const AABB *box  = &boxes[index];
+
+			// A box is outside a plane if its center is further away from it
+			// than the box's extent along the plane's normal.
+			gte_ldv0(&box->size);
+			gte_mvmva(1, 1, 0, 3, 0);
+			gte_stlvnl(&extent);
+			gte_ldv0(&box->center);
+			gte_mvmva(1, 0, 0, 0, 0);
+			gte_stlvnl(&dist);
+
+			if (
+				((dist.vx + extent.vx) < 0) ||
+				((dist.vy + extent.vy) < 0) ||
+				((dist.vz + extent.vz) < 0)
+			)
+				continue;
+
+			visible[count++] = index;
+		}
+	}
+
+	return count;
+}
@@ -1,61 +1,88 @@
 #include <psxgte.h>
 
+// The rotation matrix builders below compute each element of the product of
+// the three axis rotation matrices directly, rather than building them and
+// multiplying them together with MulMatrix0(). Products of sines and cosines
+// are shifted the same way the GTE does, so the results are identical to
+// those of the matrix multiplications.
+
+static void _rot_matrix_xyz(const int *s, const int *c, MATRIX *m) {
+	int sxsy = (s[0] * s[1]) >> 12;
+	int ncxsy = (-c[0] * s[1]) >> 12;
+
+	m->m[0][0] = (c[1] * c[2]) >> 12;
+	m->m[0][1] = (-c[1] * s[2]) >> 12;
+	m->m[0][2] = s[1];
+	m->m[1][0] = (sxsy * c[2] + c[0] * s[2]) >> 12;
+	m->m[1][1] = (-sxsy * s[2] + c[0] * c[2]) >> 12;
+	m->m[1][2] = (-s[0] * c[1]) >> 12;
+	m->m[2][0] = (ncxsy * c[2] + s[0] * s[2]) >> 12;
+	m->m[2][1] = (-ncxsy * s[2] + s[0] * c[2]) >> 12;
+	m->m[2][2] = (c[0] * c[1]) >> 12;
+}
+
 MATRIX *RotMatrix(SVECTOR *r, MATRIX *m) {
-	short s[3],c[3];
-	MATRIX tm[3];
+	int s[3],c[3];
 
 	s[0] = isin(r->vx);		s[1] = isin(r->vy);		s[2] = isin(r->vz);
 	c[0] = icos(r->vx);		c[1] = icos(r->vy);		c[2] = icos(r->vz);
 
-	// mX
-	m->m[0][0] = ONE;		m->m[0][1] = 0;			m->m[0][2] = 0;
-	m->m[1][0] = 0;			m->m[1][1] = c[0];		m->m[1][2] = -s[0];
-	m->m[2][0] = 0;			m->m[2][1] = s[0];		m->m[2][2] = c[0];
-
-	// mY
-	tm[0].m[0][0] = c[1];	tm[0].m[0][1] = 0;		tm[0].m[0][2] = s[1];
-	tm[0].m[1][0] = 0;		tm[0].m[1][1] = ONE;	tm[0].m[1][2] = 0;
-	tm[0].m[2][0] = -s[1];	tm[0].m[2][1] = 0;		tm[0].m[2][2] = c[1];
-
-	// mZ
-	tm[1].m[0][0] = c[2];	tm[1].m[0][1] = -s[2];	tm[1].m[0][2] = 0;
-	tm[1].m[1][0] = s[2];	tm[1].m[1][1] = c[2];	tm[1].m[1][2] = 0;
-	tm[1].m[2][0] = 0;		tm[1].m[2][1] = 0;		tm[1].m[2][2] = ONE;
-
-	PushMatrix();
-	MulMatrix0( m, &tm[0], &tm[2] );
-	MulMatrix0( &tm[2], &tm[1], m );
-	PopMatrix();
+	_rot_matrix_xyz(s, c, m);
 
 	return m;
 }
 
 MATRIX *HiRotMatrix(VECTOR *r, MATRIX *m) {
-	short s[3],c[3];
-	MATRIX tm[3];
+	int s[3],c[3];
 
 	s[0] = hisin(r->vx);	s[1] = hisin(r->vy);	s[2] = hisin(r->vz);
 	c[0] = hicos(r->vx);	c[1] = hicos(r->vy);	c[2] = hicos(r->vz);
 
-	// mX
-	m->m[0][0] = ONE;		m->m[0][1] = 0;			m->m[0][2] = 0;
-	m->m[1][0] = 0;			m->m[1][1] = c[0];		m->m[1][2] = -s[0];
-	m->m[2][0] = 0;			m->m[2][1] = s[0];		m->m[2][2] = c[0];
-
-	// mY
-	tm[0].m[0][0] = c[1];	tm[0].m[0][1] = 0;		tm[0].m[0][2] = s[1];
-	tm[0].m[1][0] = 0;		tm[0].m[1][1] = ONE;	tm[0].m[1][2] = 0;
-	tm[0].m[2][0] = -s[1];	tm[0].m[2][1] = 0;		tm[0].m[2][2] = c[1];
-
-	// mZ
-	tm[1].m[0][0] = c[2];	tm[1].m[0][1] = -s[2];	tm[1].m[0][2] = 0;
-	tm[1].m[1][0] = s[2];	tm[1].m[1][1] = c[2];	tm[1].m[1][2] = 0;
-	tm[1].m[2][0] = 0;		tm[1].m[2][1] = 0;		tm[1].m[2][2] = ONE;
-
-	PushMatrix();
-	MulMatrix0( m, &tm[0], &tm[2] );
-	MulMatrix0( &tm[2], &tm[1], m );
-	PopMatrix();
+	_rot_matrix_xyz(s, c, m);
+
+	return m;
+}
+
+MATRIX *RotMatrixYXZ(SVECTOR *r, MATRIX *m) {
+	int s[3],c[3];
+
+	s[0] = isin(r->vx);		s[1] = isin(r->vy);		s[2] = isin(r->vz);
+	c[0] = icos(r->vx);		c[1] = icos(r->vy);		c[2] = icos(r->vz);
+
+	int sysx = (s[1] * s[0]) >> 12;
+	int cysx = (c[1] * s[0]) >> 12;
+
+	m->m[0][0] = (c[1] * c[2] + sysx * s[2]) >> 12;
+	m->m[0][1] = (-c[1] * s[2] + sysx * c[2]) >> 12;
+	m->m[0][2] = (s[1] * c[0]) >> 12;
+	m->m[1][0] = (c[0] * s[2]) >> 12;
+	m->m[1][1] = (c[0] * c[2]) >> 12;
+	m->m[1][2] = -s[0];
+	m->m[2][0] = (-s[1] * c[2] + cysx * s[2]) >> 12;
+	m->m[2][1] = (s[1] * s[2] + cysx * c[2]) >> 12;
+	m->m[2][2] = (c[1] * c[0]) >> 12;
+
+	return m;
+}
+
+MATRIX *RotMatrixZYX(SVECTOR *r, MATRIX *m) {
+	int s[3],c[3];
+
+	s[0] = isin(r->vx);		s[1] = isin(r->vy);		s[2] = isin(r->vz);
+	c[0] = icos(r->vx);		c[1] = icos(r->vy);		c[2] = icos(r->vz);
+
+	int czsy = (c[2] * s[1]) >> 12;
+	int szsy = (s[2] * s[1]) >> 12;
+
+	m->m[0][0] = (c[2] * c[1]) >> 12;
+	m->m[0][1] = (-s[2] * c[0] + czsy * s[0]) >> 12;
+	m->m[0][2] = (s[2] * s[0] + czsy * c[0]) >> 12;
+	m->m[1][0] = (s[2] * c[1]) >> 12;
+	m->m[1][1] = (c[2] * c[0] + szsy * s[0]) >> 12;
+	m->m[1][2] = (-c[2] * s[0] + szsy * c[0]) >> 12;
+	m->m[2][0] = -s[1];
+	m->m[2][1] = (c[1] * s[0]) >> 12;
+	m->m[2][2] = (c[1] * c[0]) >> 12;
 
 	return m;
 }
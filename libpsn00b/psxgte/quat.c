@@ -0,0 +1,192 @@
+/*
+ * PSn00bSDK fixed-point quaternion library
+ * (C) 2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * Quaternions are stored in 4.12 fixed-point format (4096 = 1.0) with the
+ * vector part first, so it can be loaded into the GTE like an SVECTOR. All
+ * functions expect unit quaternions unless otherwise noted; use QuatNormal()
+ * every now and then to get rid of accumulated rounding errors.
+ */
+
+#include <stdint.h>
+#include <psxgte.h>
+
+// Minimum angle between two quaternions (in hisin() units) for QuatSlerp() to
+// actually interpolate spherically. Below this hisin(angle) is too small to
+// divide by accurately, and linear interpolation is just as good.
+#define SLERP_MIN_ANGLE	1024
+
+// asin(i / 128) for i = 0 to 96, in hisin() units (131072 = 360 degrees).
+// QuatSlerp() gets the angle between quaternions from half the length of the
+// chord between them, which is at most sin(45 degrees) as the shortest path
+// is always taken.
+static const uint16_t _asin_table[97] = {
+	    0,   163,   326,   489,   652,   815,   978,  1141,
+	 1305,  1468,  1631,  1795,  1959,  2122,  2286,  2450,
+	 2614,  2779,  2943,  3108,  3273,  3438,  3603,  3769,
+	 3935,  4101,  4267,  4434,  4600,  4768,  4935,  5103,
+	 5271,  5440,  5608,  5778,  5947,  6117,  6288,  6459,
+	 6630,  6802,  6974,  7147,  7320,  7494,  7668,  7843,
+	 8019,  8195,  8372,  8549,  8727,  8906,  9085,  9265,
+	 9446,  9628,  9810,  9993, 10177, 10362, 10548, 10735,
+	10923, 11111, 11301, 11492, 11684, 11877, 12071, 12266,
+	12462, 12660, 12859, 13060, 13261, 13465, 13669, 13876,
+	14084, 14293, 14505, 14718, 14933, 15150, 15369, 15590,
+	15813, 16039, 16267, 16497, 16730, 16966, 17205, 17446,
+	17691
+};
+
+/* Private utilities */
+
+static int _asin(int x) {
+	int i    = x >> 5;
+	int frac = x & 31;
+
+	if (i >= 96)
+		return _asin_table[96];
+
+	return _asin_table[i] +
+		(((_asin_table[i + 1] - _asin_table[i]) * frac) >> 5);
+}
+
+static int _dot(const QUATERNION *q0, const QUATERNION *q1) {
+	return (
+		q0->vx * q1->vx + q0->vy * q1->vy + q0->vz * q1->vz + q0->vw * q1->vw
+	) >> 12;
+}
+
+/* Public API */
+
+QUATERNION *QuatAxisAngle(SVECTOR *axis, int angle, QUATERNION *q) {
+	// Half angles are computed with hisin()/hicos() (32 times the resolution of
+	// isin()) so odd angles don't get rounded.
+	int s = hisin(angle << 4);
+
+	q->vx = (axis->vx * s) >> 12;
+	q->vy = (axis->vy * s) >> 12;
+	q->vz = (axis->vz * s) >> 12;
+	q->vw = hicos(angle << 4);
+
+	// hisin() and hicos() are approximations whose squares may add up to
+	// slightly more than one, which QuatToMatrix() would amplify.
+	return QuatNormal(q, q);
+}
+
+QUATERNION *QuatFromEuler(SVECTOR *r, QUATERNION *q) {
+	int sx = hisin(r->vx << 4), cx = hicos(r->vx << 4);
+	int sy = hisin(r->vy << 4), cy = hicos(r->vy << 4);
+	int sz = hisin(r->vz << 4), cz = hicos(r->vz << 4);
+
+	// Same as QuatMul() on the three axis rotations, in the same order as
+	// RotMatrix() (X * Y * Z).
+	int sxcy = (sx * cy) >> 12, cxsy = (cx * sy) >> 12;
+	int cxcy = (cx * cy) >> 12, sxsy = (sx * sy) >> 12;
+
+	q->vx = (sxcy * cz + cxsy * sz) >> 12;
+	q->vy = (cxsy * cz - sxcy * sz) >> 12;
+	q->vz = (cxcy * sz + sxsy * cz) >> 12;
+	q->vw = (cxcy * cz - sxsy * sz) >> 12;
+
+	return QuatNormal(q, q);
+}
+
+QUATERNION *QuatMul(QUATERNION *q0, QUATERNION *q1, QUATERNION *q2) {
+	int x = q0->vw * q1->vx + q0->vx * q1->vw + q0->vy * q1->vz - q0->vz * q1->vy;
+	int y = q0->vw * q1->vy - q0->vx * q1->vz + q0->vy * q1->vw + q0->vz * q1->vx;
+	int z = q0->vw * q1->vz + q0->vx * q1->vy - q0->vy * q1->vx + q0->vz * q1->vw;
+	int w = q0->vw * q1->vw - q0->vx * q1->vx - q0->vy * q1->vy - q0->vz * q1->vz;
+
+	q2->vx = x >> 12;
+	q2->vy = y >> 12;
+	q2->vz = z >> 12;
+	q2->vw = w >> 12;
+
+	return q2;
+}
+
+QUATERNION *QuatNormal(QUATERNION *q0, QUATERNION *q1) {
+	int len = SquareRoot0(
+		q0->vx * q0->vx + q0->vy * q0->vy + q0->vz * q0->vz + q0->vw * q0->vw
+	);
+
+	if (!len) {
+		q1->vx = 0;
+		q1->vy = 0;
+		q1->vz = 0;
+		q1->vw = ONE;
+		return q1;
+	}
+
+	q1->vx = (q0->vx * ONE) / len;
+	q1->vy = (q0->vy * ONE) / len;
+	q1->vz = (q0->vz * ONE) / len;
+	q1->vw = (q0->vw * ONE) / len;
+
+	return q1;
+}
+
+QUATERNION *QuatNlerp(QUATERNION *q0, QUATERNION *q1, int t, QUATERNION *q2) {
+	// q and -q represent the same rotation, pick whichever is closer to q0 to
+	// interpolate through the shortest path.
+	int sign = (_dot(q0, q1) < 0) ? -1 : 1;
+
+	q2->vx = q0->vx + (((q1->vx * sign - q0->vx) * t) >> 12);
+	q2->vy = q0->vy + (((q1->vy * sign - q0->vy) * t) >> 12);
+	q2->vz = q0->vz + (((q1->vz * sign - q0->vz) * t) >> 12);
+	q2->vw = q0->vw + (((q1->vw * sign - q0->vw) * t) >> 12);
+
+	return QuatNormal(q2, q2);
+}
+
+QUATERNION *QuatSlerp(QUATERNION *q0, QUATERNION *q1, int t, QUATERNION *q2) {
+	int sign = (_dot(q0, q1) < 0) ? -1 : 1;
+	int dx   = q1->vx * sign - q0->vx;
+	int dy   = q1->vy * sign - q0->vy;
+	int dz   = q1->vz * sign - q0->vz;
+	int dw   = q1->vw * sign - q0->vw;
+
+	// The chord between two unit quaternions is 2 * sin(angle / 2) long.
+	int chord = SquareRoot0(dx * dx + dy * dy + dz * dz + dw * dw);
+	int angle = _asin(chord >> 1) * 2;
+
+	if (angle < SLERP_MIN_ANGLE)
+		return QuatNlerp(q0, q1, t, q2);
+
+	int s  = hisin(angle);
+	int w0 = (hisin(((ONE - t) * angle) >> 12) * ONE) / s;
+	int w1 = (hisin((t * angle) >> 12) * ONE) / s * sign;
+
+	q2->vx = (q0->vx * w0 + q1->vx * w1) >> 12;
+	q2->vy = (q0->vy * w0 + q1->vy * w1) >> 12;
+	q2->vz = (q0->vz * w0 + q1->vz * w1) >> 12;
+	q2->vw = (q0->vw * w0 + q1->vw * w1) >> 12;
+
+	return q2;
+}
+
+MATRIX *QuatToMatrix(QUATERNION *q, MATRIX *m) {
+	int x = q->vx, y = q->vy, z = q->vz, w = q->vw;
+
+	int xx = x * x, yy = y * y, zz = z * z;
+	int xy = x * y, xz = x * z, yz = y * z;
+	int wx = w * x, wy = w * y, wz = w * z;
+
+	// Products are shifted right by 11 rather than 12 to multiply them by 2.
+	m->m[0][0] = ONE - ((yy + zz) >> 11);
+	m->m[0][1] = (xy - wz) >> 11;
+	m->m[0][2] = (xz + wy) >> 11;
+	m->m[1][0] = (xy + wz) >> 11;
+	m->m[1][1] = ONE - ((xx + zz) >> 11);
+	m->m[1][2] = (yz - wx) >> 11;
+	m->m[2][0] = (xz - wy) >> 11;
+	m->m[2][1] = (yz + wx) >> 11;
+	m->m[2][2] = ONE - ((xx + yy) >> 11);
+
+	return m;
+}
+
+void QuatRotateN(QUATERNION *q, SVECTOR *v0, SVECTOR *v1, int n) {
+	MATRIX m;
+
+	ApplyMatrixN(QuatToMatrix(q, &m), v0, v1, n);
+}
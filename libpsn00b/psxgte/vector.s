@@ -94,6 +94,92 @@ VectorNormalS:
 	jr		$ra
 	sh		$t2, 4($a1)
 
+.section .text.NormalizeN
+.global NormalizeN
+.type NormalizeN, @function
+NormalizeN:
+	# a0 - Pointer to input vectors (VECTOR)
+	# a1 - Pointer to output vectors (SVECTOR)
+	# a2 - Number of vectors
+
+	# Same as VectorNormalS(), looped over an array
+	la		$t7, _norm_table
+	blez	$a2, .Lnormn_exit
+	nop
+
+.Lnormn_loop:
+	lw		$t0, 0($a0)
+	lw		$t1, 4($a0)
+	lw		$t2, 8($a0)
+	
+	mtc2	$t0, C2_IR1
+	mtc2	$t1, C2_IR2
+	mtc2	$t2, C2_IR3
+	
+	nSQR(0)
+	
+	mfc2	$t3, C2_MAC1
+	mfc2	$t4, C2_MAC2
+	mfc2	$t5, C2_MAC3
+	
+	add		$t3, $t4
+	add		$v0, $t3, $t5
+	mtc2	$v0, C2_LZCS
+	nop
+	nop
+	mfc2	$v1, C2_LZCR
+	
+	addiu	$at, $0 , -2
+	and		$v1, $at
+	
+	addiu	$t6, $0 , 0x1f
+	sub		$t6, $v1
+	sra		$t6, 1
+	addiu	$t3, $v1, -24
+	
+	bltz	$t3, .Lnormn_neg
+	nop
+	b		.Lnormn_pos
+	sllv	$t4, $v0, $t3
+.Lnormn_neg:
+	addiu	$t3, $0 , 24
+	sub		$t3, $v1
+	srav	$t4, $v0, $t3
+.Lnormn_pos:
+	addi	$t4, -64
+	sll		$t4, 1
+	
+	addu	$t4, $t7
+	lh		$t5, 0($t4)
+	
+	mtc2	$t0, C2_IR1
+	mtc2	$t1, C2_IR2
+	mtc2	$t2, C2_IR3
+	mtc2	$t5, C2_IR0
+	
+	nGPF(0)
+	
+	mfc2	$t0, C2_MAC1
+	mfc2	$t1, C2_MAC2
+	mfc2	$t2, C2_MAC3
+	
+	sra		$t0, $t6
+	sra		$t1, $t6
+	sra		$t2, $t6
+	
+	sh		$t0, 0($a1)
+	sh		$t1, 2($a1)
+	sh		$t2, 4($a1)
+	
+	addiu	$a0, 12
+	addiu	$a2, -1
+	bgtz	$a2, .Lnormn_loop
+	addiu	$a1, 8
+
+.Lnormn_exit:
+	jr		$ra
+	nop
+
 .section .data._norm_table
 .type _norm_table, @object
 _norm_table:
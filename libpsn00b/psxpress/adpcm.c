@@ -0,0 +1,313 @@
+/*
+ * PSn00bSDK MDEC library (SPU ADPCM encoder)
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * This file only depends on the standard C headers and psxpress.h, so it can
+ * also be compiled on the host (e.g. to check its output against .VAG files
+ * generated by other encoders).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <psxpress.h>
+
+#define BLOCK_SAMPLES	28
+#define BLOCK_SIZE		16
+#define NUM_FILTERS		5
+#define MAX_SHIFT		12
+
+#define _min(x, y) (((x) < (y)) ? (x) : (y))
+
+/* Filter coefficient tables */
+
+// These are the same coefficients used by the SPU (and XA-ADPCM decoder) and
+// are in 2.6 fixed-point format.
+static const int8_t _filter_pos[NUM_FILTERS] = { 0, 60, 115,  98, 122 };
+static const int8_t _filter_neg[NUM_FILTERS] = { 0,  0, -52, -55, -60 };
+
+/* Internal globals */
+
+static ENCSPU_Context _default_context;
+static uint32_t       _default_block_index;
+
+/* Private utilities */
+
+static inline int _clamp_s16(int value) {
+	if (value < -0x8000)
+		return -0x8000;
+	if (value > 0x7fff)
+		return 0x7fff;
+
+	return value;
+}
+
+// Returns the smallest scale exponent (i.e. 12 minus the "shift" value stored
+// in the block header) that allows the given peak residual to be represented
+// by a 4-bit signed nibble.
+static inline int _get_exponent(int peak_pos, int peak_neg) {
+	int exponent = 0;
+
+	while (
+		(exponent < MAX_SHIFT) &&
+		((peak_pos > (7 << exponent)) || (peak_neg < (-8 * (1 << exponent))))
+	)
+		exponent++;
+
+	return exponent;
+}
+
+// Finds the smallest exponent usable with the given filter by computing the
+// prediction residuals of the *original* samples. This is only an estimate, as
+// the actual decoder will use previously decoded (lossy) samples for
+// prediction.
+static int _estimate_exponent(
+	const int16_t *input, int s1, int s2, int filter
+) {
+	int f0 = _filter_pos[filter], f1 = _filter_neg[filter];
+	int peak_pos = 0, peak_neg = 0;
+
+	for (int i = 0; i < BLOCK_SAMPLES; i++) {
+		int sample   = input[i];
+		int residual = sample - ((s1 * f0 + s2 * f1 + 32) >> 6);
+
+		if (residual > peak_pos)
+			peak_pos = residual;
+		if (residual < peak_neg)
+			peak_neg = residual;
+
+		s2 = s1;
+		s1 = sample;
+	}
+
+	return _get_exponent(peak_pos, peak_neg);
+}
+
+// Quantizes a block using the given filter and exponent while tracking the
+// decoder's state, so that quantization errors do not accumulate over time.
+// The squared error (saturated to UINT32_MAX) is returned and nibbles are
+// written to the output buffer only if it is not null. When no output buffer
+// is given, the function bails out early if the error exceeds max_error.
+static uint32_t __attribute__((optimize(3))) _encode_block(
+	uint8_t *output, const int16_t *input, int16_t *state, int filter,
+	int exponent, uint32_t max_error
+) {
+	int f0 = _filter_pos[filter], f1 = _filter_neg[filter];
+	int s1 = state[0], s2 = state[1];
+
+	int      rounding = exponent ? (1 << (exponent - 1)) : 0;
+	uint32_t error    = 0;
+
+	for (int i = 0; i < BLOCK_SAMPLES; i++) {
+		int predicted = (s1 * f0 + s2 * f1 + 32) >> 6;
+		int nibble    = (input[i] - predicted + rounding) >> exponent;
+
+		if (nibble < -8)
+			nibble = -8;
+		if (nibble > 7)
+			nibble = 7;
+
+		int      decoded = _clamp_s16(nibble * (1 << exponent) + predicted);
+		uint32_t delta   = (uint32_t) (input[i] - decoded);
+		uint32_t square  = delta * delta; // Always fits as |delta| < 65536
+
+		// Errors must not be scaled down before squaring them, as that would
+		// make the trial encoding unable to tell apart small errors from an
+		// exact match.
+		if (square > (max_error - error)) {
+			if (!output)
+				return UINT32_MAX;
+
+			error = UINT32_MAX;
+		} else {
+			error += square;
+		}
+
+		if (output) {
+			if (i % 2)
+				output[i / 2] |= (nibble & 15) << 4;
+			else
+				output[i / 2]  = nibble & 15;
+		}
+
+		s2 = s1;
+		s1 = decoded;
+	}
+
+	if (output) {
+		state[0] = s1;
+		state[1] = s2;
+	}
+
+	return error;
+}
+
+static void _encode_adpcm_block(
+	ENCSPU_Context *ctx, uint8_t *output, const int16_t *input, uint8_t flags
+) {
+	int filter, exponent;
+
+	if (ctx->quality == ENCSPU_QUALITY_FAST) {
+		// In fast mode the filter yielding the smallest residual peak on the
+		// original samples is picked and the block is only encoded once.
+		int min_exponent = MAX_SHIFT + 1;
+
+		filter   = 0;
+		exponent = MAX_SHIFT;
+
+		for (int i = 0; i < ctx->num_filters; i++) {
+			int value = _estimate_exponent(
+				input, ctx->state[0], ctx->state[1], i
+			);
+
+			if (value < min_exponent) {
+				min_exponent = value;
+				filter       = i;
+				exponent     = value;
+			}
+		}
+	} else {
+		// In normal mode each filter is trial-encoded with every exponent,
+		// then the combination with the smallest error is used. The estimated
+		// exponent is tried first, as it is usually close to the best one and
+		// lets most of the other trials bail out early.
+		uint32_t min_error = UINT32_MAX;
+
+		filter   = 0;
+		exponent = MAX_SHIFT;
+
+		for (int i = 0; i < ctx->num_filters; i++) {
+			int value = _estimate_exponent(
+				input, ctx->state[0], ctx->state[1], i
+			);
+
+			for (int k = -1; k <= MAX_SHIFT; k++) {
+				if (k == value)
+					continue;
+
+				int      j     = (k < 0) ? value : k;
+				uint32_t error = _encode_block(
+					0, input, ctx->state, i, j, min_error
+				);
+
+				if (error < min_error) {
+					min_error = error;
+					filter    = i;
+					exponent  = j;
+				}
+			}
+		}
+	}
+
+	output[0] = (MAX_SHIFT - exponent) | (filter << 4);
+	output[1] = flags;
+	_encode_block(&output[2], input, ctx->state, filter, exponent, UINT32_MAX);
+}
+
+/* Public API */
+
+void EncSPUInit(ENCSPU_Context *ctx, ENCSPU_Quality quality) {
+	ctx->state[0]    = 0;
+	ctx->state[1]    = 0;
+	ctx->quality     = quality;
+	ctx->num_filters = NUM_FILTERS;
+}
+
+size_t EncSPUEncode(
+	ENCSPU_Context *ctx, uint8_t *output, const int16_t *input, size_t length,
+	int flags
+) {
+	uint8_t *ptr = output;
+
+	// The SPU always starts decoding a sample with an empty history, so the
+	// encoder's state must be reset accordingly.
+	if (flags & ENCSPU_FLAG_START) {
+		ctx->state[0] = 0;
+		ctx->state[1] = 0;
+	}
+
+	while (length) {
+		const int16_t *block = input;
+		int16_t       padded[BLOCK_SAMPLES];
+
+		size_t  chunk       = _min(length, BLOCK_SAMPLES);
+		uint8_t block_flags = 0;
+
+		// Pad the last block with silence if it is not complete.
+		if (chunk < BLOCK_SAMPLES) {
+			memcpy(padded, input, chunk * sizeof(int16_t));
+			memset(&padded[chunk], 0, (BLOCK_SAMPLES - chunk) * sizeof(int16_t));
+
+			block = padded;
+		}
+
+		if ((ptr == output) && (flags & (ENCSPU_FLAG_START | ENCSPU_FLAG_LOOP_START)))
+			block_flags |= 1 << 2; // Loop start
+		if ((chunk == length) && (flags & ENCSPU_FLAG_END))
+			block_flags |= (flags & ENCSPU_FLAG_LOOP) ? 3 : 1; // Loop end
+
+		_encode_adpcm_block(ctx, ptr, block, block_flags);
+
+		ptr    += BLOCK_SIZE;
+		input  += chunk;
+		length -= chunk;
+	}
+
+	return ptr - output;
+}
+
+/* Sony SDK compatibility wrapper */
+
+long EncSPU(ENCSPUENV *env) {
+	const int16_t *input  = env->src;
+	uint8_t       *output = (uint8_t *) env->dest;
+	size_t        length  = env->size / 2;
+
+	int proceed = env->proceed, flags = 0;
+
+	if ((proceed == ENCSPU_ENCODE_WHOLE) || (proceed & ENCSPU_ENCODE_START)) {
+		EncSPUInit(
+			&_default_context,
+			env->quality ? ENCSPU_QUALITY_NORMAL : ENCSPU_QUALITY_FAST
+		);
+		_default_block_index = 0;
+	}
+	if ((proceed == ENCSPU_ENCODE_WHOLE) || (proceed & ENCSPU_ENCODE_END)) {
+		flags |= ENCSPU_FLAG_END;
+		if (env->loop)
+			flags |= ENCSPU_FLAG_LOOP;
+	}
+
+	// Byte-swap the input into the work buffer if it is big endian. If no work
+	// buffer was provided, the source buffer is swapped in place.
+	if (env->byte_swap) {
+		uint16_t *work = (uint16_t *) (env->work ? env->work : env->src);
+
+		for (size_t i = 0; i < length; i++) {
+			uint16_t value = ((const uint16_t *) env->src)[i];
+			work[i]        = (value >> 8) | (value << 8);
+		}
+
+		input = (const int16_t *) work;
+	}
+
+	// Encode the data one block at a time, setting the loop start flag on the
+	// block that contains the loop point (or on the first block if the sample
+	// is not looping).
+	uint32_t loop_block = env->loop ? (env->loop_start / (BLOCK_SAMPLES * 2)) : 0;
+	uint8_t  *ptr       = output;
+
+	while (length) {
+		size_t chunk       = _min(length, BLOCK_SAMPLES);
+		int    block_flags = (chunk == length) ? flags : 0;
+
+		if (_default_block_index++ == loop_block)
+			block_flags |= ENCSPU_FLAG_LOOP_START;
+
+		ptr    += EncSPUEncode(&_default_context, ptr, input, chunk, block_flags);
+		input  += chunk;
+		length -= chunk;
+	}
+
+	return ptr - output;
+}
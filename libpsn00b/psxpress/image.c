@@ -0,0 +1,161 @@
+/*
+ * PSn00bSDK MDEC library (VRAM image decoding API)
+ * (C) 2023 spicyjpeg - MPL licensed
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include <psxetc.h>
+#include <psxgpu.h>
+#include <psxpress.h>
+#include <hwregs_c.h>
+
+#define MACROBLOCK_SIZE 16
+
+/* Internal globals */
+
+// As there is only one MDEC, the state of the current decoding operation is
+// kept in a single static structure rather than in a user-provided context.
+static struct {
+	uint32_t	*slices[2];
+	RECT		slice_rect;
+	int16_t		end_x;
+	uint16_t	slice_length;
+	int8_t		cur_slice;
+	volatile int8_t	busy, waiting;
+
+	void		(*old_callback)(void);
+	void		(*old_drawsync_callback)(void);
+} _image_ctx;
+
+/* Private utilities */
+
+// This handler is fired by the MDEC output DMA whenever a slice has been
+// decoded. The slice is queued for upload to VRAM and decoding of the next
+// slice into the other buffer is started, so that the GPU DMA transfer and
+// MDEC decoding overlap.
+static void _mdec_dma_handler(void) {
+	if (!_image_ctx.busy)
+		return;
+
+	int last_slice = _image_ctx.cur_slice;
+	RECT *rect     = &_image_ctx.slice_rect;
+
+	_image_ctx.cur_slice ^= 1;
+
+	// The other buffer holds the previous slice, whose upload may still be in
+	// the GPU's queue (behind any drawing commands issued in the meantime).
+	// The queue can't be polled from an IRQ handler, so if it's not empty the
+	// next slice is decoded from the DrawSync() callback instead once it
+	// drains. This check must be done before the current slice is queued.
+	if ((rect->x + rect->w) >= _image_ctx.end_x)
+		_image_ctx.busy = 0;
+	else if (DrawSync(1))
+		_image_ctx.waiting = 1;
+	else
+		DecDCTout(
+			_image_ctx.slices[_image_ctx.cur_slice],
+			_image_ctx.slice_length
+		);
+
+	LoadImage(rect, _image_ctx.slices[last_slice]);
+	rect->x += rect->w;
+}
+
+static void _drawsync_handler(void) {
+	if (_image_ctx.waiting) {
+		_image_ctx.waiting = 0;
+
+		DecDCTout(
+			_image_ctx.slices[_image_ctx.cur_slice],
+			_image_ctx.slice_length
+		);
+	}
+
+	if (_image_ctx.old_drawsync_callback)
+		_image_ctx.old_drawsync_callback();
+}
+
+/* Public API */
+
+int DecDCTImageStart(
+	const uint32_t *data, const RECT *rect, DECDCTMODE mode, uint32_t *buffer
+) {
+	_sdk_validate_args(data && rect && buffer && (mode != DECDCT_MODE_RAW), -1);
+
+	int slice_width = (mode & DECDCT_MODE_24BPP)
+		? (MACROBLOCK_SIZE * 3 / 2)
+		: MACROBLOCK_SIZE;
+
+	if ((rect->w % slice_width) || (rect->h % MACROBLOCK_SIZE)) {
+		_sdk_log("image size (%dx%d) is not a multiple of the slice size\n", rect->w, rect->h);
+		return -1;
+	}
+	if (DecDCTImageSync(0))
+		return -1;
+
+	_image_ctx.slices[0]    = buffer;
+	_image_ctx.slices[1]    = &buffer[slice_width * rect->h / 2];
+	_image_ctx.slice_rect.x = rect->x;
+	_image_ctx.slice_rect.y = rect->y;
+	_image_ctx.slice_rect.w = slice_width;
+	_image_ctx.slice_rect.h = rect->h;
+	_image_ctx.end_x        = rect->x + rect->w;
+	_image_ctx.slice_length = slice_width * rect->h / 2;
+	_image_ctx.cur_slice    = 0;
+	_image_ctx.busy         = 1;
+	_image_ctx.waiting      = 0;
+
+	_image_ctx.old_callback          = DMACallback(DMA_MDEC_OUT, &_mdec_dma_handler);
+	_image_ctx.old_drawsync_callback = DrawSyncCallback(&_drawsync_handler);
+
+	// Feed the MDEC with the input stream and start decoding the first slice.
+	// Subsequent slices will be handled by the DMA callback.
+	DecDCTin(data, mode);
+	DecDCTout(_image_ctx.slices[0], _image_ctx.slice_length);
+
+	return 0;
+}
+
+int DecDCTImageSync(int mode) {
+	int error = 0;
+
+	if (_image_ctx.busy) {
+		if (mode)
+			return 1;
+
+		// Wait for the last slice to be decoded. DecDCToutSync() is used to
+		// get the same timeout behavior as the other MDEC functions, while
+		// DrawSync() is used when waiting for the GPU to release a buffer.
+		while (_image_ctx.busy) {
+			if (_image_ctx.waiting ? DrawSync(0) : DecDCToutSync(0)) {
+				_image_ctx.busy    = 0;
+				_image_ctx.waiting = 0;
+				error              = -1;
+			}
+		}
+	}
+
+	// Restore the previously registered callbacks once decoding is done. This
+	// is done here rather than in the callback to avoid reconfiguring DMA IRQs
+	// from within the DMA IRQ handler itself.
+	if (_image_ctx.slices[0]) {
+		_image_ctx.slices[0] = 0;
+		DMACallback(DMA_MDEC_OUT, _image_ctx.old_callback);
+		DrawSyncCallback(_image_ctx.old_drawsync_callback);
+	}
+
+	return error;
+}
+
+int DecDCTImage(
+	const uint32_t *data, const RECT *rect, DECDCTMODE mode, uint32_t *buffer
+) {
+	if (DecDCTImageStart(data, rect, mode, buffer))
+		return -1;
+	if (DecDCTImageSync(0))
+		return -1;
+
+	DrawSync(0);
+	return 0;
+}
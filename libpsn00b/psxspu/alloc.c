@@ -0,0 +1,237 @@
+/*
+ * PSn00bSDK SPU library (SPU RAM allocator)
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * Unlike the Sony SDK, which stores its allocation table in SPU RAM, this
+ * allocator keeps all metadata in a user-provided table in main RAM. Blocks
+ * are identified by handles (indices into the table) rather than addresses, so
+ * that they can be moved around by SpuCompactHeap().
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include <psxetc.h>
+#include <psxspu.h>
+#include <hwregs_c.h>
+
+#define _min(x, y) (((x) < (y)) ? (x) : (y))
+
+// The first 0x1000 bytes of SPU RAM are reserved for capture buffers, while
+// the next 16 bytes hold the dummy block uploaded by SpuInit().
+#define HEAP_START_ADDR	0x1010
+#define HEAP_END_ADDR	0x80000
+#define DMA_CHUNK_SIZE	64
+
+typedef enum {
+	BLOCK_USED	= 1 << 0
+} BlockFlags;
+
+/* Internal globals */
+
+static SPU_HeapBlock	*_blocks     = 0;
+static int				_num_blocks  = 0;
+static int				_first_block = -1;
+static uint32_t			_heap_end    = HEAP_END_ADDR;
+
+/* Private utilities */
+
+static inline SPU_HeapBlock *_get_block(int handle) {
+	if ((handle < 0) || (handle >= _num_blocks))
+		return 0;
+	if (!(_blocks[handle].flags & BLOCK_USED))
+		return 0;
+
+	return &_blocks[handle];
+}
+
+// Copies data within SPU RAM using the given buffer in main RAM. Transfers are
+// split so that no DMA transfer is rounded up to a multiple of the DMA chunk
+// size, which would otherwise overwrite data past the end of the destination.
+static void _move_data(
+	uint32_t dest, uint32_t src, size_t size, uint32_t *buffer,
+	size_t buffer_size
+) {
+	while (size) {
+		size_t chunk = _min(size, buffer_size);
+		if (chunk >= DMA_CHUNK_SIZE)
+			chunk &= ~(DMA_CHUNK_SIZE - 1);
+
+		SpuSetTransferStartAddr(src);
+		SpuRead(buffer, chunk);
+		SpuQueueSync(SPU_TRANSFER_WAIT);
+
+		SpuSetTransferStartAddr(dest);
+		SpuWrite(buffer, chunk);
+		SpuQueueSync(SPU_TRANSFER_WAIT);
+
+		dest += chunk;
+		src  += chunk;
+		size -= chunk;
+	}
+}
+
+/* Public API */
+
+void SpuInitHeap(SPU_HeapBlock *table, int num_blocks, uint32_t end_addr) {
+	_sdk_validate_args_void(table && (num_blocks > 0));
+
+	_blocks      = table;
+	_num_blocks  = num_blocks;
+	_first_block = -1;
+	_heap_end    = end_addr ? (end_addr & ~7) : HEAP_END_ADDR;
+
+	for (int i = 0; i < num_blocks; i++)
+		table[i].flags = 0;
+}
+
+int SpuAllocBlock(size_t size) {
+	_sdk_validate_args(_blocks && size, -1);
+
+	size = (size + 7) & ~7;
+
+	// Find an unused entry in the table.
+	int handle = -1;
+
+	for (int i = 0; i < _num_blocks; i++) {
+		if (!(_blocks[i].flags & BLOCK_USED)) {
+			handle = i;
+			break;
+		}
+	}
+
+	if (handle < 0) {
+		_sdk_log("no free entries in allocation table\n");
+		return -1;
+	}
+
+	// Walk the list of allocated blocks (sorted by address) and pick the
+	// smallest gap that can fit the new block in order to reduce
+	// fragmentation.
+	int      prev      = -1, best_prev = -2;
+	uint32_t gap_start = HEAP_START_ADDR, best_addr = 0;
+	size_t   best_size = HEAP_END_ADDR;
+
+	for (int i = _first_block;; i = _blocks[i].next) {
+		uint32_t gap_end = (i >= 0) ? _blocks[i].addr : _heap_end;
+		size_t   gap     = gap_end - gap_start;
+
+		if ((gap >= size) && (gap < best_size)) {
+			best_prev = prev;
+			best_addr = gap_start;
+			best_size = gap;
+		}
+		if (i < 0)
+			break;
+
+		prev      = i;
+		gap_start = _blocks[i].addr + _blocks[i].size;
+	}
+
+	if (best_prev == -2) {
+		_sdk_log("unable to allocate %d bytes of SPU RAM\n", size);
+		return -1;
+	}
+
+	SPU_HeapBlock *block = &_blocks[handle];
+	block->addr  = best_addr;
+	block->size  = size;
+	block->flags = BLOCK_USED;
+
+	if (best_prev < 0) {
+		block->next  = _first_block;
+		_first_block = handle;
+	} else {
+		block->next             = _blocks[best_prev].next;
+		_blocks[best_prev].next = handle;
+	}
+
+	return handle;
+}
+
+void SpuFreeBlock(int handle) {
+	SPU_HeapBlock *block = _get_block(handle);
+	if (!block)
+		return;
+
+	if (_first_block == handle) {
+		_first_block = block->next;
+	} else {
+		for (int i = _first_block; i >= 0; i = _blocks[i].next) {
+			if (_blocks[i].next == handle) {
+				_blocks[i].next = block->next;
+				break;
+			}
+		}
+	}
+
+	block->flags = 0;
+}
+
+uint32_t SpuGetBlockAddr(int handle) {
+	SPU_HeapBlock *block = _get_block(handle);
+
+	return block ? block->addr : 0;
+}
+
+size_t SpuGetHeapFree(size_t *largest) {
+	size_t   total     = 0, max_gap = 0;
+	uint32_t gap_start = HEAP_START_ADDR;
+
+	for (int i = _first_block;; i = _blocks[i].next) {
+		uint32_t gap_end = (i >= 0) ? _blocks[i].addr : _heap_end;
+		size_t   gap     = gap_end - gap_start;
+
+		total  += gap;
+		max_gap = (gap > max_gap) ? gap : max_gap;
+
+		if (i < 0)
+			break;
+
+		gap_start = _blocks[i].addr + _blocks[i].size;
+	}
+
+	if (largest)
+		*largest = max_gap;
+
+	return total;
+}
+
+int SpuUploadBlock(int handle, const uint32_t *data, size_t size) {
+	SPU_HeapBlock *block = _get_block(handle);
+	_sdk_validate_args(block && data && size, -1);
+
+	if (size > block->size) {
+		_sdk_log("data (%d bytes) does not fit in block (%d bytes)\n", size, block->size);
+		return -1;
+	}
+
+	return SpuQueueWrite(block->addr, data, size);
+}
+
+int SpuCompactHeap(uint32_t *buffer, size_t buffer_size) {
+	_sdk_validate_args(buffer && (buffer_size >= 8), -1);
+
+	int      moved = 0;
+	uint32_t addr  = HEAP_START_ADDR;
+
+	// Make sure no uploads are in progress before moving blocks around.
+	SpuQueueSync(SPU_TRANSFER_WAIT);
+	buffer_size &= ~7;
+
+	// As blocks are always moved towards the beginning of the heap and in
+	// ascending address order, no block can be overwritten before it is moved.
+	for (int i = _first_block; i >= 0; i = _blocks[i].next) {
+		SPU_HeapBlock *block = &_blocks[i];
+
+		if (block->addr != addr) {
+			_move_data(addr, block->addr, block->size, buffer, buffer_size);
+
+			block->addr = addr;
+			moved++;
+		}
+
+		addr += block->size;
+	}
+
+	return moved;
+}
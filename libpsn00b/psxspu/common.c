@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <assert.h>
 #include <psxetc.h>
+#include <psxapi.h>
 #include <psxspu.h>
 #include <hwregs_c.h>
 
@@ -14,28 +15,55 @@
 #define WRITABLE_AREA_ADDR	0x200
 #define DMA_CHUNK_LENGTH	16
 #define STATUS_TIMEOUT		0x100000
+#define IRQ_STATUS_TIMEOUT	0x100
+#define QUEUE_LENGTH		16
 
 static const uint32_t _dummy_block[4] = {
 	0x00000500, 0x00000000, 0x00000000, 0x00000000
 };
 
+/* Private types */
+
+typedef struct {
+	uint32_t	*data;
+	size_t		length;
+	uint16_t	addr;
+	uint8_t		write, notify;
+} TransferOp;
+
 /* Internal globals */
 
 static SPU_TransferMode	_transfer_mode = SPU_TRANSFER_BY_DMA;
 static uint16_t			_transfer_addr = WRITABLE_AREA_ADDR;
 
+static void (*_transfer_callback)(void) = (void *) 0;
+
+static volatile TransferOp	_transfer_queue[QUEUE_LENGTH];
+static volatile uint8_t		_queue_head, _queue_tail, _queue_length;
+static volatile uint8_t		_transfer_busy, _transfer_notify;
+
 /* Private utilities */
 
-static void _wait_status(uint16_t mask, uint16_t value) {
-	for (int i = STATUS_TIMEOUT; i; i--) {
+static int _poll_status(uint16_t mask, uint16_t value, int timeout) {
+	for (; timeout; timeout--) {
 		if ((SPU_STAT & mask) == value)
-			return;
+			return 1;
 	}
 
-	_sdk_log("timeout, status=0x%04x\n", SPU_STAT);
+	return 0;
+}
+
+static void _wait_status(uint16_t mask, uint16_t value) {
+	if (!_poll_status(mask, value, STATUS_TIMEOUT))
+		_sdk_log("timeout, status=0x%04x\n", SPU_STAT);
 }
 
-static size_t _dma_transfer(uint32_t *data, size_t length, int write) {
+// Switches the SPU to DMA mode and starts a transfer. Returns 0 without
+// starting it if the SPU does not acknowledge the mode change within the
+// given number of status polls.
+static int _dma_transfer(
+	uint16_t addr, uint32_t *data, size_t length, int write, int timeout
+) {
 	if (length % 4)
 		_sdk_log("can't transfer a number of bytes that isn't multiple of 4\n");
 
@@ -52,14 +80,16 @@ static size_t _dma_transfer(uint32_t *data, size_t length, int write) {
 		BUS_SPU_CFG = (BUS_SPU_CFG & ~(0xf << 24)) | (2 << 24);
 
 	SPU_CTRL &= 0xffcf; // Disable DMA request
-	_wait_status(0x0030, 0x0000);
+	if (!_poll_status(0x0030, 0x0000, timeout))
+		return 0;
 
 	// Enable DMA request for writing (2) or reading (3)
 	uint16_t ctrl = write ? 0x0020 : 0x0030;
 
-	SPU_ADDR  = _transfer_addr;
+	SPU_ADDR  = addr;
 	SPU_CTRL |= ctrl;
-	_wait_status(0x0030, ctrl);
+	if (!_poll_status(0x0030, ctrl, timeout))
+		return 0;
 
 	DMA_MADR(DMA_SPU) = (uint32_t) data;
 	if (length < DMA_CHUNK_LENGTH)
@@ -69,7 +99,7 @@ static size_t _dma_transfer(uint32_t *data, size_t length, int write) {
 			((length / DMA_CHUNK_LENGTH) << 16);
 
 	DMA_CHCR(DMA_SPU) = 0x01000200 | write;
-	return length;
+	return 1;
 }
 
 static size_t _manual_write(const uint16_t *data, size_t length) {
@@ -107,6 +137,80 @@ static size_t _manual_write(const uint16_t *data, size_t length) {
 	return length;
 }
 
+// Starts the next queued transfer if no transfer is in progress. This must be
+// called with interrupts disabled, or from the DMA IRQ handler. The DMA IRQ
+// handler only waits briefly for the SPU to switch modes; if it takes longer,
+// the transfer is left at the head of the queue and started by the next call
+// to this function from outside the handler (see SpuQueueSync()).
+static void _process_queue(int timeout) {
+	if (_transfer_busy || !_queue_length)
+		return;
+
+	int head = _queue_head;
+	volatile TransferOp *op = &_transfer_queue[head];
+
+	if (!_dma_transfer(op->addr, op->data, op->length, op->write, timeout)) {
+		if (timeout == STATUS_TIMEOUT)
+			_sdk_log("timeout, status=0x%04x\n", SPU_STAT);
+
+		return;
+	}
+
+	_queue_head = (head + 1) % QUEUE_LENGTH;
+	_queue_length--;
+	_transfer_busy   = 1;
+	_transfer_notify = op->notify;
+}
+
+static int _enqueue_transfer(
+	uint16_t addr, uint32_t *data, size_t length, int write, int notify
+) {
+	// If the queue is full, wait for the DMA IRQ handler to process at least
+	// one entry.
+	for (int i = STATUS_TIMEOUT; _queue_length >= QUEUE_LENGTH; i--) {
+		if (!i) {
+			_sdk_log("transfer queue timeout, %d transfers pending\n", _queue_length);
+			return -1;
+		}
+
+		FastEnterCriticalSection();
+		_process_queue(IRQ_STATUS_TIMEOUT);
+		FastExitCriticalSection();
+	}
+
+	FastEnterCriticalSection();
+
+	int tail    = _queue_tail;
+	_queue_tail = (tail + 1) % QUEUE_LENGTH;
+	_queue_length++;
+
+	volatile TransferOp *op = &_transfer_queue[tail];
+	op->data   = data;
+	op->length = length;
+	op->addr   = addr;
+	op->write  = write;
+	op->notify = notify;
+
+	_process_queue(STATUS_TIMEOUT);
+
+	int queued = _queue_length;
+	FastExitCriticalSection();
+
+	return queued;
+}
+
+/* Private interrupt handlers */
+
+static void _spu_dma_handler(void) {
+	int notify = _transfer_notify;
+
+	_transfer_busy = 0;
+	_process_queue(IRQ_STATUS_TIMEOUT);
+
+	if (notify && _transfer_callback)
+		_transfer_callback();
+}
+
 /* Public API */
 
 void SpuInit(void) {
@@ -136,6 +240,17 @@ void SpuInit(void) {
 	SetDMAPriority(DMA_SPU, 3);
 	DMA_CHCR(DMA_SPU) = 0x00000201; // Stop DMA
 
+	_queue_head    = 0;
+	_queue_tail    = 0;
+	_queue_length    = 0;
+	_transfer_busy   = 0;
+	_transfer_notify = 0;
+
+	int _exit = EnterCriticalSection();
+	DMACallback(DMA_SPU, &_spu_dma_handler);
+	if (_exit)
+		ExitCriticalSection();
+
 	SPU_DMA_CTRL = 0x0004; // Reset transfer mode
 	SPU_CTRL     = 0xc001; // Enable SPU, DAC, CD audio, disable DMA request
 	_wait_status(0x003f, 0x0001);
@@ -167,7 +282,10 @@ void SpuInit(void) {
 size_t SpuRead(uint32_t *data, size_t size) {
 	_sdk_validate_args(data && size, 0);
 
-	return _dma_transfer(data, size, 0) * 4;
+	if (_enqueue_transfer(_transfer_addr, data, size, 0, 1) < 0)
+		return 0;
+
+	return size;
 }
 
 size_t SpuWrite(const uint32_t *data, size_t size) {
@@ -178,11 +296,17 @@ size_t SpuWrite(const uint32_t *data, size_t size) {
 		return 0;
 	}
 
-	// I/O transfer mode is not that useful, but whatever.
-	if (_transfer_mode)
+	// I/O transfer mode is not that useful, but whatever. Any queued DMA
+	// transfer has to be completed before a manual write can be issued.
+	if (_transfer_mode) {
+		SpuQueueSync(SPU_TRANSFER_WAIT);
 		return _manual_write((const uint16_t *) data, size) * 2;
-	else
-		return _dma_transfer((uint32_t *) data, size, 1) * 4;
+	}
+
+	if (_enqueue_transfer(_transfer_addr, (uint32_t *) data, size, 1, 1) < 0)
+		return 0;
+
+	return size;
 }
 
 size_t SpuWritePartly(const uint32_t *data, size_t size) {
@@ -217,8 +341,71 @@ uint32_t SpuGetTransferStartAddr(void) {
 
 int SpuIsTransferCompleted(int mode) {
 	if (!mode)
-		return ((SPU_STAT >> 10) & 1) ^ 1;
+		return !SpuQueueSync(SPU_TRANSFER_PEEK) && !(SPU_STAT & (1 << 10));
 
-	_wait_status(0x0400, 0x0000);
+	SpuQueueSync(SPU_TRANSFER_WAIT);
 	return 1;
 }
+
+int SpuQueueWrite(uint32_t addr, const uint32_t *data, size_t size) {
+	_sdk_validate_args(data && size && (addr <= 0x7ffff), -1);
+
+	uint16_t _addr = getSPUAddr(addr);
+
+	if (_addr < WRITABLE_AREA_ADDR) {
+		_sdk_log("ignoring attempt to write to capture buffers at 0x%05x\n", _addr);
+		return -1;
+	}
+
+	// DMA transfers longer than one chunk are rounded up to a multiple of the
+	// chunk size, which would overwrite data in SPU RAM past the destination
+	// (and read past the end of the source buffer). Any trailing partial chunk
+	// is thus queued as a separate, shorter transfer.
+	size_t bulk = size;
+	if (bulk >= (DMA_CHUNK_LENGTH * 4))
+		bulk &= ~(DMA_CHUNK_LENGTH * 4 - 1);
+
+	int queued = _enqueue_transfer(_addr, (uint32_t *) data, bulk, 1, bulk == size);
+	if ((queued < 0) || (bulk == size))
+		return queued;
+
+	return _enqueue_transfer(
+		_addr + bulk / 8, (uint32_t *) data + bulk / 4, size - bulk, 1, 1
+	);
+}
+
+int SpuQueueSync(int mode) {
+	// Start any transfer the DMA IRQ handler failed to start.
+	FastEnterCriticalSection();
+	_process_queue(IRQ_STATUS_TIMEOUT);
+	FastExitCriticalSection();
+
+	if (mode == SPU_TRANSFER_PEEK)
+		return _queue_length + _transfer_busy;
+
+	for (int i = STATUS_TIMEOUT; i; i--) {
+		if (!_queue_length && !_transfer_busy) {
+			_wait_status(0x0400, 0x0000);
+			return 0;
+		}
+
+		if (!_transfer_busy) {
+			FastEnterCriticalSection();
+			_process_queue(IRQ_STATUS_TIMEOUT);
+			FastExitCriticalSection();
+		}
+	}
+
+	_sdk_log("SpuQueueSync() timeout, %d transfers pending\n", _queue_length);
+	return -1;
+}
+
+void *SpuSetTransferCallback(void (*func)(void)) {
+	FastEnterCriticalSection();
+
+	void *old_callback = _transfer_callback;
+	_transfer_callback = func;
+
+	FastExitCriticalSection();
+	return old_callback;
+}
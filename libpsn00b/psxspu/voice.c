@@ -0,0 +1,262 @@
+/*
+ * PSn00bSDK SPU library (voice allocator)
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * The voice manager keeps a shadow copy of each managed channel's state in
+ * main RAM and defers all register writes to SpuUpdateVoices(), which is meant
+ * to be called once per frame, so that all key on/off events for a frame are
+ * issued with a single write to each KEY_ON and KEY_OFF register pair. Note
+ * that stealing a channel does not key it off first: the new sound's
+ * parameters are written and the channel is keyed on in the same update,
+ * cutting off the previous sound without going through its release phase.
+ *
+ * A channel is freed once its envelope volume is zero and it has either been
+ * keyed off or reached the end of its sample (as reported by the ENDX
+ * register, which is cleared on key on). The envelope volume alone is not
+ * enough, as it is also zero for a while after key on with slow attack rates.
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include <psxetc.h>
+#include <psxspu.h>
+#include <hwregs_c.h>
+
+#define NUM_CHANNELS	24
+#define HANDLE_SHIFT	5
+
+typedef enum {
+	VOICE_ACTIVE	= 1 << 0,	// Channel is allocated to a sound
+	VOICE_KEY_ON	= 1 << 1,	// Key on pending
+	VOICE_UPDATE	= 1 << 2,	// Volume/pitch update pending
+	VOICE_RELEASED	= 1 << 3	// Channel has been keyed off
+} VoiceFlags;
+
+typedef struct {
+	int			handle;
+	uint32_t	start_frame;
+	uint16_t	addr, pitch;
+	int16_t		vol_l, vol_r;
+	uint32_t	adsr;
+	uint8_t		priority, flags;
+} Voice;
+
+/* Internal globals */
+
+static Voice	_voices[NUM_CHANNELS];
+static uint32_t	_channel_mask = 0, _frame_counter = 0;
+static uint32_t	_key_on_mask  = 0, _key_off_mask  = 0;
+static int		_next_handle  = 1;
+
+/* Private utilities */
+
+static inline Voice *_get_voice(int handle) {
+	int ch = handle & ((1 << HANDLE_SHIFT) - 1);
+
+	if ((handle < 0) || (ch >= NUM_CHANNELS))
+		return 0;
+
+	Voice *voice = &_voices[ch];
+
+	if ((voice->handle != handle) || !(voice->flags & VOICE_ACTIVE))
+		return 0;
+
+	return voice;
+}
+
+// Picks a channel to be used for a new sound. Free channels are preferred;
+// if none is available, the channel playing the sound with the lowest priority
+// (that is not higher than the new sound's) is stolen, using the current
+// envelope volume and then the age of the sound as tiebreakers.
+static int _find_channel(int priority) {
+	int      best_ch   = -1;
+	int      best_prio = 0x100, best_vol = 0x8000;
+	uint32_t best_age  = 0;
+
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (!(_channel_mask & (1 << ch)))
+			continue;
+
+		Voice *voice = &_voices[ch];
+
+		if (!(voice->flags & VOICE_ACTIVE))
+			return ch;
+		if ((voice->priority > priority) || (voice->priority > best_prio))
+			continue;
+
+		// Sounds that have not been keyed on yet are treated as being at full
+		// volume, as their envelope has not started.
+		int      vol = (voice->flags & VOICE_KEY_ON) ? 0x7fff : SPU_CH_ADSR_VOL(ch);
+		uint32_t age = _frame_counter - voice->start_frame;
+
+		if (
+			(voice->priority < best_prio) ||
+			(vol < best_vol) ||
+			((vol == best_vol) && (age > best_age))
+		) {
+			best_ch   = ch;
+			best_prio = voice->priority;
+			best_vol  = vol;
+			best_age  = age;
+		}
+	}
+
+	return best_ch;
+}
+
+/* Public API */
+
+void SpuInitVoiceManager(uint32_t channel_mask) {
+	SpuStopAllSounds();
+	SpuUpdateVoices();
+
+	for (int ch = 0; ch < NUM_CHANNELS; ch++)
+		_voices[ch].flags = 0;
+
+	_channel_mask  = channel_mask & ((1 << NUM_CHANNELS) - 1);
+	_frame_counter = 0;
+}
+
+int SpuPlaySound(const SPU_SoundParams *params) {
+	_sdk_validate_args(params, -1);
+
+	int ch = _find_channel(params->priority);
+
+	if (ch < 0)
+		return -1;
+
+	Voice *voice = &_voices[ch];
+
+	// Generate a new handle, making sure it never becomes negative or zero
+	// once the counter wraps around.
+	int handle   = (_next_handle << HANDLE_SHIFT) | ch;
+	_next_handle = (_next_handle + 1) & 0x3ffffff;
+	if (!_next_handle)
+		_next_handle = 1;
+
+	voice->handle      = handle;
+	voice->start_frame = _frame_counter;
+	voice->addr        = getSPUAddr(params->addr);
+	voice->pitch       = params->pitch;
+	voice->vol_l       = params->vol_l;
+	voice->vol_r       = params->vol_r;
+	voice->adsr        = params->adsr;
+	voice->priority    = params->priority;
+	voice->flags       = VOICE_ACTIVE | VOICE_KEY_ON | VOICE_UPDATE;
+
+	_key_on_mask  |= 1 << ch;
+	_key_off_mask &= ~(1 << ch);
+	return handle;
+}
+
+void SpuStopSound(int handle) {
+	Voice *voice = _get_voice(handle);
+
+	if (!voice)
+		return;
+
+	int ch = voice - _voices;
+
+	// If the sound hasn't been keyed on yet, simply cancel the key on.
+	// Otherwise schedule a key off, which will put the channel into the
+	// release phase of its envelope; the channel will be freed once the
+	// envelope volume reaches zero.
+	if (voice->flags & VOICE_KEY_ON) {
+		voice->flags  = 0;
+		_key_on_mask &= ~(1 << ch);
+	} else {
+		_key_off_mask |= 1 << ch;
+	}
+}
+
+void SpuStopAllSounds(void) {
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		Voice *voice = &_voices[ch];
+
+		if (voice->flags & VOICE_ACTIVE)
+			SpuStopSound(voice->handle);
+	}
+}
+
+int SpuIsSoundPlaying(int handle) {
+	return _get_voice(handle) ? 1 : 0;
+}
+
+void SpuSetSoundVolume(int handle, int left, int right) {
+	Voice *voice = _get_voice(handle);
+
+	if (!voice)
+		return;
+
+	voice->vol_l  = left;
+	voice->vol_r  = right;
+	voice->flags |= VOICE_UPDATE;
+}
+
+void SpuSetSoundPitch(int handle, int pitch) {
+	Voice *voice = _get_voice(handle);
+
+	if (!voice)
+		return;
+
+	voice->pitch  = pitch;
+	voice->flags |= VOICE_UPDATE;
+}
+
+void SpuUpdateVoices(void) {
+	uint32_t key_on  = _key_on_mask;
+	uint32_t key_off = _key_off_mask;
+	uint32_t end     = SPU_CHAN_STATUS1 | (SPU_CHAN_STATUS2 << 16);
+
+	_key_on_mask  = 0;
+	_key_off_mask = 0;
+
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		Voice    *voice = &_voices[ch];
+		uint32_t bit    = 1 << ch;
+
+		if (!(voice->flags & VOICE_ACTIVE))
+			continue;
+
+		// Free channels whose envelope has reached zero, either because they
+		// were keyed off or because the sample ended (the SPU mutes a channel
+		// immediately upon reaching a loop end block without the repeat flag).
+		if (
+			!(voice->flags & VOICE_KEY_ON) && !(key_off & bit) &&
+			((voice->flags & VOICE_RELEASED) || (end & bit))
+		) {
+			if (!SPU_CH_ADSR_VOL(ch)) {
+				voice->flags = 0;
+				continue;
+			}
+		}
+
+		if (voice->flags & VOICE_UPDATE) {
+			SPU_CH_VOL_L(ch) = voice->vol_l;
+			SPU_CH_VOL_R(ch) = voice->vol_r;
+			SPU_CH_FREQ(ch)  = voice->pitch;
+		}
+		if (voice->flags & VOICE_KEY_ON) {
+			SPU_CH_ADDR(ch)  = voice->addr;
+			SPU_CH_ADSR1(ch) = (uint16_t) voice->adsr;
+			SPU_CH_ADSR2(ch) = (uint16_t) (voice->adsr >> 16);
+		}
+
+		voice->flags &= VOICE_ACTIVE | VOICE_RELEASED;
+		if (key_off & bit)
+			voice->flags |= VOICE_RELEASED;
+	}
+
+	// Key off must be issued before key on, as a channel that is stopped and
+	// then restarted within the same frame shall end up playing.
+	if (key_off) {
+		SPU_KEY_OFF1 = (uint16_t) key_off;
+		SPU_KEY_OFF2 = (uint16_t) (key_off >> 16);
+	}
+	if (key_on) {
+		SPU_KEY_ON1 = (uint16_t) key_on;
+		SPU_KEY_ON2 = (uint16_t) (key_on >> 16);
+	}
+
+	_frame_counter++;
+}
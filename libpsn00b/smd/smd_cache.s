@@ -0,0 +1,989 @@
+# PSn00bSDK .SMD model parser library (vertex cache renderer)
+# (C) 2019-2023 Lameguy64, spicyjpeg - MPL licensed
+#
+# smdSortModel() loads and projects the vertices of each primitive as it goes,
+# so vertices shared by several faces (which on closed meshes is most of them)
+# are transformed once for every face using them. This file splits rendering
+# into two passes instead: smdTransformVerts() projects each vertex of a model
+# exactly once, three at a time using RTPT, into a cache of screen coordinates
+# and Z values, then smdSortModelCached() sorts the primitives by fetching
+# their already projected vertices from the cache. The cache can be placed in
+# the scratchpad if it is small enough (8 bytes per vertex, so up to 128
+# vertices fill the whole scratchpad).
+
+.set noreorder
+
+.include "gtereg.inc"
+.include "inline_s.inc"
+.include "smd/smd_s.inc"
+
+.section .text.smdTransformVerts, "ax", @progbits
+.global smdTransformVerts
+.type smdTransformVerts, @function
+
+smdTransformVerts:
+	# a0 - Pointer to vertex cache
+	# a1 - Pointer to vertices to transform
+	# a2 - Number of vertices
+	# v0 - Pointer to cache entry following the last one (return)
+
+	sll		$v0, $a2, 3
+	addu	$v0, $a0
+
+	addiu	$a2, -3
+	bltz	$a2, .xform_tail
+	nop
+
+.xform_loop:
+
+	lwc2	C2_VXY0, 0( $a1 )		# Load and project 3 vertices
+	lwc2	C2_VZ0 , 4( $a1 )
+	lwc2	C2_VXY1, 8( $a1 )
+	lwc2	C2_VZ1 , 12( $a1 )
+	lwc2	C2_VXY2, 16( $a1 )
+	lwc2	C2_VZ2 , 20( $a1 )
+	addiu	$a1, 24
+
+	RTPT
+
+	cfc2	$v1, C2_FLAG			# Get GTE flag value
+	addiu	$a2, -3
+
+	bltz	$v1, .xform_slow
+	nop
+
+	swc2	C2_SXY0, 0( $a0 )
+	swc2	C2_SZ1 , 4( $a0 )
+	swc2	C2_SXY1, 8( $a0 )
+	swc2	C2_SZ2 , 12( $a0 )
+	swc2	C2_SXY2, 16( $a0 )
+	swc2	C2_SZ3 , 20( $a0 )
+
+	bgez	$a2, .xform_loop
+	addiu	$a0, 24
+
+.xform_tail:
+
+	# Project the remaining 1-2 vertices one at a time, so that nothing is
+	# read or written past the end of either array. The counter is then set
+	# so that .xform_single_loop returns here and exits.
+	addiu	$t0, $a2, 3
+	blez	$t0, .xform_exit
+	addiu	$a2, $0, -3
+
+.xform_single_loop:
+
+	lwc2	C2_VXY0, 0( $a1 )
+	lwc2	C2_VZ0 , 4( $a1 )
+	addiu	$a1, 8
+
+	nRTPS
+
+	cfc2	$v1, C2_FLAG			# Set bit 31 of the Z value on overflow
+	mfc2	$t1, C2_SZ3
+	lui		$t2, 0x8000
+	and		$v1, $t2
+	or		$t1, $v1
+	swc2	C2_SXY2, 0( $a0 )
+	sw		$t1, 4( $a0 )
+
+	addiu	$t0, -1
+	bnez	$t0, .xform_single_loop
+	addiu	$a0, 8
+
+	bgez	$a2, .xform_loop
+	nop
+	b		.xform_tail
+	nop
+
+.xform_slow:
+
+	# At least one of the vertices overflowed, project them again one at a
+	# time to find out which ones
+	addiu	$a1, -24
+	b		.xform_single_loop
+	addiu	$t0, $0, 3
+
+.xform_exit:
+
+	jr		$ra
+	nop
+
+.section .text.smdSortModelCached, "ax", @progbits
+.global smdSortModelCached
+.type smdSortModelCached, @function
+
+smdSortModelCached:
+	# a0 - Pointer SC_OT structure
+	# a1 - Pointer to next primitive
+	# a2 - Pointer to SMD data address
+	# a3 - Pointer to vertex cache filled by smdTransformVerts()
+	# v0 - New pointer of primitive buffer (return)
+
+	addiu	$sp, -16
+	sw		$s0, 0($sp)
+	sw		$s1, 4($sp)
+	sw		$s2, 8($sp)
+	sw		$s3, 12($sp)
+
+	la		$v0, _sc_clip
+	lw		$t8, 0($v0)
+	lw		$t9, 4($v0)
+
+	lw		$t0, OT_LEN($a0)
+	lw		$a0, OT_ADDR($a0)
+	move	$t1, $a3				# Vertices are fetched from the cache
+	lw		$t2, SMD_HEAD_PNORMS($a2)
+	lw		$t3, SMD_HEAD_PPRIMS($a2)
+
+.sort_loop:
+
+	nop
+	lw		$a3, 0($t3)				# Get primitive ID word
+	move	$t4, $t3
+
+	beqz	$a3, .exit				# Check if terminator (just zero)
+	addiu	$t4, 4
+
+	lhu		$t5, 0( $t4 )			# Load cached vertices
+	lhu		$t6, 2( $t4 )
+	lhu		$t7, 4( $t4 )
+	sll		$t5, 3
+	sll		$t6, 3
+	sll		$t7, 3
+	addu	$t5, $t1
+	addu	$t6, $t1
+	addu	$t7, $t1
+	lw		$v0, 0( $t5 )			# Screen coordinates
+	lw		$v1, 0( $t6 )
+	mtc2	$v0, C2_SXY0
+	lw		$v0, 0( $t7 )
+	mtc2	$v1, C2_SXY1
+	mtc2	$v0, C2_SXY2
+	lw		$v0, 4( $t5 )			# Screen Z values and overflow flags
+	lw		$v1, 4( $t6 )
+	lw		$t7, 4( $t7 )
+	mtc2	$v0, C2_SZ1
+	mtc2	$v1, C2_SZ2
+	mtc2	$t7, C2_SZ3
+	or		$v0, $v1
+	or		$v0, $t7
+
+	srl		$v1, $a3, 24			# Get primitive size
+	addu	$t3, $v1				# Step main pointer to next primitive
+
+	bltz	$v0, .skip_prim			# Skip primitive if Z overflow
+	andi	$v0, $a3, 0x3
+
+	NCLIP							# Backface culling
+
+	srl		$v1, $a3, 12
+	andi	$v1, 1
+
+	bnez	$v1, .no_culling
+	nop
+
+	mfc2	$v1, C2_MAC0
+	nop
+	bltz	$v1, .skip_prim
+	nop
+
+.no_culling:
+
+	beq		$v0, 0x1, .prim_tri		# If primitive is a triangle
+	nop
+	beq		$v0, 0x2, .prim_quad	# If primitive is a quad
+	nop
+
+	b		.skip_prim
+	nop
+
+## Triangles
+
+.prim_tri:							# Triangle processing
+
+	addiu	$t4, 8					# Advance from indices
+
+	AVSZ3							# Calculate average Z
+
+	srl		$v0, $t0, 16			# Get Z divisor from OT_LEN value
+	andi	$v0, 0xff
+
+	mfc2	$t5, C2_OTZ				# Get AVSZ3 result
+
+	sra		$v1, $t0, 24			# Get Z offset from OT_LEN value
+
+	srl		$t5, $v0				# Apply divisor and offset
+	sub		$t5, $v1
+
+	blez	$t5, .skip_prim			# Skip primitive if less than zero
+	andi	$v1, $t0, 0xffff
+	bge		$t5, $v1, .skip_prim	# Skip primitive if greater than OT length
+	sll		$t5, 2
+	addu	$t5, $a0				# Append OTZ to OT address
+
+	ClipTestTri
+
+	and		$v0, $s0, $s1			# v0 & v1
+	beqz	$v0, .do_draw
+	and		$v0, $s1, $s2			# v1 & v2
+	beqz	$v0, .do_draw
+	and		$v0, $s2, $s0			# v2 & v0
+	beqz	$v0, .do_draw
+	nop
+	b		.skip_prim
+	nop
+
+.do_draw:
+
+
+	srl		$v0, $a3, 2					# Lighting enabled?
+	andi	$v0, 0x3
+	bnez	$v0, .F3_light
+	nop
+
+	andi	$v0, $a3, 0x10				# Gouraud shaded
+	bnez	$v0, .F3_gouraud
+	nop
+
+	andi	$v0, $a3, 0x20				# Textured triangle
+	bnez	$v0, .F3_textured
+	nop
+
+	lw		$v0, 0( $t4 )				# Flat color, no lighting
+	lui		$v1, 0x2000
+	or		$v0, $v1
+
+	b		.sort_F3_pri
+	sw		$v0, POLYF3_rgbc( $a1 )
+
+.F3_gouraud:
+
+	lw		$v0, 0($t4)
+	lw		$v1, 4($t4)
+	.set noat
+	lui		$at, 0x3000
+	or		$v0, $at
+	.set at
+	sw		$v0, POLYG3_rgbc0($a1)
+	lw		$v0, 8($t4)
+	sw		$v1, POLYG3_rgbc1($a1)
+	b		.sort_G3_pri
+	sw		$v0, POLYG3_rgbc2($a1)
+
+.F3_textured:
+
+	lw		$v0, 0( $t4 )				# Flat color, no lighting
+	lui		$v1, 0x2400
+	or		$v0, $v1
+	sw		$v0, POLYFT3_rgbc( $a1 )
+	addiu	$t4, 4
+
+	lhu		$v0, 0( $t4 )				# Load texture coordinates
+	lhu		$v1, 2( $t4 )
+	sh		$v0, POLYFT3_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYFT3_uv1( $a1 )
+	sh		$v0, POLYFT3_uv2( $a1 )
+
+	lw		$v0, 8( $t4 )				# Tpage + CLUT
+	nop
+	andi	$v1, $v0, 0xffff
+	sh		$v1, POLYFT3_tpage( $a1 )
+	srl		$v0, 16
+
+	b		.sort_FT3_pri
+	sh		$v0, POLYFT3_clut( $a1 )
+
+.F3_light:
+
+	lhu		$v0, 0( $t4 )				# Load normal 0
+
+	srl		$v1, $a3, 2
+	andi	$v1, $v1, 0x3
+
+	sll		$v0, 3
+	addu	$v0, $t2
+	lwc2	C2_VXY0, 0( $v0 )
+	lwc2	C2_VZ0 , 4( $v0 )
+
+	beq		$v1, 0x2, .F3_light_smt
+	nop
+
+	lw		$v0, 4( $t4 )
+	lui		$v1, 0x2000
+	or		$v0, $v1
+	mtc2	$v0, C2_RGB
+
+	addiu	$t4, 8
+	nop
+
+	NCCS
+
+	andi	$v0, $a3, 0x20				# Textured triangle
+	bnez	$v0, .F3_light_tex
+	nop
+
+	swc2	C2_RGB2, POLYF3_rgbc( $a1 )
+
+	b		.sort_F3_pri
+	nop
+
+.F3_light_tex:
+
+	lhu		$v0, 0( $t4 )				# Load texture coordinates
+	lhu		$v1, 2( $t4 )
+	sh		$v0, POLYFT3_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYFT3_uv1( $a1 )
+	sh		$v0, POLYFT3_uv2( $a1 )
+
+	lw		$v1, 8( $t4 )
+	nop
+	andi	$v0, $v1, 0xffff
+	sh		$v0, POLYFT3_tpage( $a1 )
+	srl		$v0, $v1, 16
+	sh		$v0, POLYFT3_clut( $a1 )
+
+	mfc2	$v0, C2_RGB2
+	lui		$v1, 0x2400
+	or		$v0, $v1
+
+	b		.sort_FT3_pri
+	sw		$v0, POLYFT3_rgbc( $a1 )
+
+.F3_light_smt:
+
+	lhu		$v0, 2( $t4 )			# Load normals 1 and 2
+	lhu		$v1, 4( $t4 )
+	sll		$v0, 3
+	sll		$v1, 3
+	addu	$v0, $t2
+	addu	$v1, $t2
+	lwc2	C2_VXY1, 0( $v0 )
+	lwc2	C2_VZ1 , 4( $v0 )
+	lw		$v0, 8( $t4 )
+	lwc2	C2_VXY2, 0( $v1 )
+	lwc2	C2_VZ2 , 4( $v1 )
+	lui		$v1, 0x3000				# Load color
+	or		$v0, $v1
+	mtc2	$v0, C2_RGB
+
+	addiu	$t4, 12
+	nop
+
+	NCCT
+
+	andi	$v0, $a3, 0x20				# Textured triangle
+	bnez	$v0, .F3_light_tex_smt
+	nop
+
+	swc2	C2_RGB0, POLYG3_rgbc0( $a1 )
+	swc2	C2_RGB1, POLYG3_rgbc1( $a1 )
+	swc2	C2_RGB2, POLYG3_rgbc2( $a1 )
+
+	b		.sort_G3_pri
+	nop
+
+.F3_light_tex_smt:
+
+	lhu		$v0, 0( $t4 )				# Load texture coordinates
+	lhu		$v1, 2( $t4 )
+	sh		$v0, POLYGT3_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYGT3_uv1( $a1 )
+	sh		$v0, POLYGT3_uv2( $a1 )
+
+	lw		$v1, 8( $t4 )
+	nop
+	andi	$v0, $v1, 0xffff
+	sh		$v0, POLYGT3_tpage( $a1 )
+	srl		$v0, $v1, 16
+	sh		$v0, POLYGT3_clut( $a1 )
+
+	mfc2	$v0, C2_RGB0
+	lui		$v1, 0x3400
+	or		$v0, $v1
+
+	swc2	C2_RGB1, POLYGT3_rgbc1( $a1 )
+	swc2	C2_RGB2, POLYGT3_rgbc2( $a1 )
+
+	b		.sort_GT3_pri
+	sw		$v0, POLYGT3_rgbc0( $a1 )
+
+.sort_F3_pri:
+
+	swc2	C2_SXY0, POLYF3_xy0($a1)
+	swc2	C2_SXY1, POLYF3_xy1($a1)
+	swc2	C2_SXY2, POLYF3_xy2($a1)
+
+	la		$v0, _smd_tpage_base
+	lhu		$v0, 0($v0)
+	srl		$v1, $a3, 6				# Get blend mode
+	andi	$v1, 0x3
+	sll		$v1, 5
+	or		$v0, $v1
+	lui		$v1, 0xe100
+	or		$v0, $v1
+	sw		$v0, POLYF3_tpage($a1)	# Store TPage
+
+	.set noat
+
+	lui		$v1, 0x0500
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYF3_len
+
+.sort_FT3_pri:
+
+	swc2	C2_SXY0, POLYFT3_xy0( $a1 )
+	swc2	C2_SXY1, POLYFT3_xy1( $a1 )
+	swc2	C2_SXY2, POLYFT3_xy2( $a1 )
+
+	.set noat
+
+	lui		$v1, 0x0700
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYFT3_len
+
+.sort_G3_pri:
+
+	swc2	C2_SXY0, POLYG3_xy0( $a1 )
+	swc2	C2_SXY1, POLYG3_xy1( $a1 )
+	swc2	C2_SXY2, POLYG3_xy2( $a1 )
+
+	la		$v0, _smd_tpage_base
+	lhu		$v0, 0($v0)
+	srl		$v1, $a3, 6				# Get blend mode
+	andi	$v1, 0x3
+	sll		$v1, 5
+	or		$v0, $v1
+	lui		$v1, 0xe100
+	or		$v0, $v1
+	sw		$v0, POLYG3_tpage($a1)	# Store TPage
+
+	.set noat
+
+	lui		$v1, 0x0700
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYG3_len
+
+.sort_GT3_pri:
+
+	swc2	C2_SXY0, POLYGT3_xy0( $a1 )
+	swc2	C2_SXY1, POLYGT3_xy1( $a1 )
+	swc2	C2_SXY2, POLYGT3_xy2( $a1 )
+
+	.set noat
+
+	lui		$v1, 0x0900
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYGT3_len
+
+## Quads
+
+.prim_quad:							# Quad processing
+
+	mfc2	$t6, C2_SXY0			# Retrieve first projected vertex
+
+	lhu		$t5, 6( $t4 )			# Load the last cached vertex
+	addiu	$t4, 8
+	sll		$t5, 3
+	addu	$t5, $t1
+	lw		$v0, 0( $t5 )
+	lw		$t7, 4( $t5 )
+	mtc2	$v0, C2_SXYP			# Push it into the screen XY FIFO
+
+	mfc2	$v0, C2_SZ1				# Shift the screen Z FIFO like RTPS does
+	mfc2	$v1, C2_SZ2
+	mtc2	$v0, C2_SZ0
+	mfc2	$v0, C2_SZ3
+	mtc2	$v1, C2_SZ1
+	mtc2	$v0, C2_SZ2
+	mtc2	$t7, C2_SZ3
+
+	srl		$v0, $t0, 16			# Get Z divisor from OT_LEN value
+
+	bltz	$t7, .skip_prim
+	nop
+
+	AVSZ4
+
+	andi	$v0, 0xff
+
+	mfc2	$t5, C2_OTZ
+
+	sra		$v1, $t0, 24				# Get Z offset from OT_LEN value
+
+	srl		$t5, $v0					# Apply divisor and offset
+	sub		$t5, $v1
+
+	blez	$t5, .skip_prim				# Skip primitive if less than zero
+	andi	$v1, $t0, 0xffff
+	bge		$t5, $v1, .skip_prim		# Skip primitive if greater than OT length
+	sll		$t5, 2
+	addu	$t5, $a0					# Append OTZ to OT address
+
+	# no touch:
+	# a0, a1, a2, a3, t0, t1, t2, t3, t4, t5(ot), t6(sxy0)
+
+	ClipTestQuad
+
+	and		$v0, $s0, $s1				# v0 & v1
+	beqz	$v0, .do_draw_q
+	and		$v0, $s1, $s2				# v1 & v2
+	beqz	$v0, .do_draw_q
+	and		$v0, $s2, $s3				# v2 & v3
+	beqz	$v0, .do_draw_q
+	and		$v0, $s3, $s0				# v3 & v0
+	beqz	$v0, .do_draw_q
+	and		$v0, $s0, $s2				# v0 & v2
+	beqz	$v0, .do_draw_q
+	and		$v0, $s1, $s3				# v1 & v3
+	beqz	$v0, .do_draw_q
+	nop
+	b		.skip_prim
+	nop
+
+.do_draw_q:
+
+	srl		$v0, $a3, 2					# Lighting enabled?
+	andi	$v0, 0x3
+	bnez	$v0, .F4_light
+	nop
+
+	andi	$v0, $a3, 0x10				# Gouraud quad
+	bnez	$v0, .F4_gouraud
+	nop
+
+	andi	$v0, $a3, 0x20				# Textured quad
+	bnez	$v0, .F4_textured
+	nop
+
+	lw		$v0, 0($t4)
+	lui		$v1, 0x2800
+	or		$v0, $v1
+
+	b		.sort_F4_pri
+	sw		$v0, POLYF4_rgbc($a1)
+
+.F4_gouraud:
+
+	lw		$v0, 0($t4)
+	lw		$v1, 4($t4)
+	.set noat
+	lui		$at, 0x3800
+	or		$v0, $at
+	.set at
+	sw		$v0, POLYG4_rgbc0($a1)
+	lw		$v0, 8($t4)
+	sw		$v1, POLYG4_rgbc1($a1)
+	lw		$v1, 12($t4)
+	sw		$v0, POLYG4_rgbc2($a1)
+	b		.sort_G4_pri
+	sw		$v1, POLYG4_rgbc3($a1)
+
+.F4_textured:
+
+	lw		$v0, 0($t4)
+	lui		$v1, 0x2c00
+	or		$v0, $v1
+	sw		$v0, POLYFT4_rgbc( $a1 )
+	addiu	$t4, 4
+
+	lhu		$v0, 0($t4)					# Load texture coordinates
+	lhu		$v1, 2($t4)
+	sh		$v0, POLYFT4_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYFT4_uv1( $a1 )
+	lhu		$v1, 6( $t4 )
+	sh		$v0, POLYFT4_uv2( $a1 )
+	sh		$v1, POLYFT4_uv3( $a1 )
+
+	lw		$v1, 8( $t4 )
+	nop
+	andi	$v0, $v1, 0xffff
+	sh		$v0, POLYFT4_tpage( $a1 )
+	srl		$v0, $v1, 16
+
+	b		.sort_FT4_pri
+	sh		$v0, POLYFT4_clut($a1)
+
+.F4_light:
+
+	lhu		$v0, 0( $t4 )				# Load normal 0
+
+	srl		$v1, $a3, 2
+	andi	$v1, $v1, 0x3
+
+	sll		$v0, 3
+	addu	$v0, $t2
+	lwc2	C2_VXY0, 0( $v0 )
+	lwc2	C2_VZ0 , 4( $v0 )
+
+	beq		$v1, 0x2, .F4_light_smt
+	nop
+
+	lw		$v0, 4( $t4 )
+	lui		$v1, 0x2800
+	or		$v0, $v1
+	mtc2	$v0, C2_RGB
+
+	addiu	$t4, 8
+	nop
+
+	NCCS
+
+	andi	$v0, $a3, 0x20				# Textured triangle
+	bnez	$v0, .F4_light_tex
+	nop
+
+	swc2	C2_RGB2, POLYF4_rgbc( $a1 )
+
+	b		.sort_F4_pri
+	nop
+
+.F4_light_tex:
+
+	lhu		$v0, 0( $t4 )				# Load texture coordinates
+	lhu		$v1, 2( $t4 )
+	sh		$v0, POLYFT4_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYFT4_uv1( $a1 )
+	lhu		$v1, 6( $t4 )
+	sh		$v0, POLYFT4_uv2( $a1 )
+	sh		$v1, POLYFT4_uv3( $a1 )
+
+	lw		$v1, 8( $t4 )
+	nop
+	andi	$v0, $v1, 0xffff
+	sh		$v0, POLYFT4_tpage( $a1 )
+	srl		$v0, $v1, 16
+	sh		$v0, POLYFT4_clut( $a1 )
+
+	mfc2	$v0, C2_RGB2
+	lui		$v1, 0x2c00
+	or		$v0, $v1
+
+	b		.sort_FT4_pri
+	sw		$v0, POLYFT4_rgbc( $a1 )
+
+.F4_light_smt:
+
+	lhu		$v0, 2( $t4 )			# Load normals 1 and 2
+	lhu		$v1, 4( $t4 )
+	sll		$v0, 3
+	sll		$v1, 3
+	addu	$v0, $t2
+	addu	$v1, $t2
+	lwc2	C2_VXY1, 0( $v0 )
+	lwc2	C2_VZ1 , 4( $v0 )
+	lwc2	C2_VXY2, 0( $v1 )
+	lwc2	C2_VZ2 , 4( $v1 )
+
+	lw		$v0, 8( $t4 )
+	lui		$v1, 0x3800				# Load color
+	or		$v0, $v1
+	mtc2	$v0, C2_RGB
+
+	nNCCT
+
+	lhu		$v0, 6( $t4 )			# Load normal 3
+
+	addiu	$t4, 12
+
+	sll		$v0, 3
+	addu	$v0, $t2
+	lwc2	C2_VXY0, 0( $v0 )
+	lwc2	C2_VZ0 , 4( $v0 )
+
+	andi	$v0, $a3, 0x20				# Textured triangle
+	bnez	$v0, .F4_light_tex_smt
+	nop
+
+	swc2	C2_RGB0, POLYG4_rgbc0( $a1 )
+	swc2	C2_RGB1, POLYG4_rgbc1( $a1 )
+	swc2	C2_RGB2, POLYG4_rgbc2( $a1 )
+
+	nNCCS
+
+	swc2	C2_RGB2, POLYG4_rgbc3( $a1 )
+
+	b		.sort_G4_pri
+	nop
+
+.F4_light_tex_smt:
+
+	mfc2	$v0, C2_RGB0
+	lui		$v1, 0x3400
+	or		$v0, $v1
+	sw		$v0, POLYGT4_rgbc0( $a1 )
+	swc2	C2_RGB1, POLYGT4_rgbc1( $a1 )
+	swc2	C2_RGB2, POLYGT4_rgbc2( $a1 )
+
+	NCCS
+
+	lhu		$v0, 0( $t4 )				# Load texture coordinates
+	lhu		$v1, 2( $t4 )
+	sh		$v0, POLYGT4_uv0( $a1 )
+	lhu		$v0, 4( $t4 )
+	sh		$v1, POLYGT4_uv1( $a1 )
+	lhu		$v1, 6( $t4 )
+	sh		$v0, POLYGT4_uv2( $a1 )
+	sh		$v1, POLYGT4_uv3( $a1 )
+
+	lw		$v1, 8( $t4 )
+	swc2	C2_RGB2, POLYGT4_rgbc3( $a1 )
+
+	andi	$v0, $v1, 0xffff
+	sh		$v0, POLYGT4_tpage( $a1 )
+	srl		$v0, $v1, 16
+
+	b		.sort_GT4_pri
+	sh		$v0, POLYGT4_clut( $a1 )
+
+.sort_F4_pri:
+
+	sw		$t6, POLYF4_xy0($a1)
+	swc2	C2_SXY0, POLYF4_xy1($a1)
+	swc2	C2_SXY1, POLYF4_xy2($a1)
+	swc2	C2_SXY2, POLYF4_xy3($a1)
+
+	la		$v0, _smd_tpage_base
+	lhu		$v0, 0($v0)
+	srl		$v1, $a3, 6				# Get blend mode
+	andi	$v1, 0x3
+	sll		$v1, 5
+	or		$v0, $v1
+	lui		$v1, 0xe100
+	or		$v0, $v1
+	sw		$v0, POLYF4_tpage($a1)	# Store TPage
+
+	.set noat
+
+	lui		$v1, 0x0600
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYF4_len
+
+.sort_FT4_pri:
+
+	sw		$t6, POLYFT4_xy0($a1)
+	swc2	C2_SXY0, POLYFT4_xy1($a1)
+	swc2	C2_SXY1, POLYFT4_xy2($a1)
+	swc2	C2_SXY2, POLYFT4_xy3($a1)
+
+	.set noat
+
+	lui		$v1, 0x0900
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYFT4_len
+
+.sort_G4_pri:
+
+	sw		$t6, POLYG4_xy0($a1)
+	swc2	C2_SXY0, POLYG4_xy1($a1)
+	swc2	C2_SXY1, POLYG4_xy2($a1)
+	swc2	C2_SXY2, POLYG4_xy3($a1)
+
+	la		$v0, _smd_tpage_base
+	lhu		$v0, 0($v0)
+	srl		$v1, $a3, 6				# Get blend mode
+	andi	$v1, 0x3
+	sll		$v1, 5
+	or		$v0, $v1
+	lui		$v1, 0xe100
+	or		$v0, $v1
+	sw		$v0, POLYG4_tpage($a1)	# Store TPage
+
+	.set noat
+
+	lui		$v1, 0x0900
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYG4_len
+
+.sort_GT4_pri:
+
+	sw		$t6, POLYGT4_xy0($a1)
+	swc2	C2_SXY0, POLYGT4_xy1($a1)
+	swc2	C2_SXY1, POLYGT4_xy2($a1)
+	swc2	C2_SXY2, POLYGT4_xy3($a1)
+
+	.set noat
+
+	lui		$v1, 0x0c00
+	lw		$v0, 0($t5)
+	lui		$at, 0xff00
+	and		$v1, $at
+	lui		$at, 0x00ff
+	or		$at, 0xffff
+	and		$v0, $at
+	or		$v1, $v0
+	sw		$v1, 0($a1)
+	lw		$v0, 0($t5)
+	and		$a1, $at
+	lui		$at, 0xff00
+	and		$v0, $at
+	or		$v0, $a1
+	sw		$v0, 0($t5)
+
+	.set at
+
+	lui		$v0, 0x8000
+	or		$a1, $v0
+
+	b		.sort_loop
+	addiu	$a1, POLYGT4_len
+
+.skip_prim:
+
+	b		.sort_loop
+	nop
+
+.exit:
+
+	lw		$s0, 0( $sp )
+	lw		$s1, 4( $sp )
+	lw		$s2, 8( $sp )
+	lw		$s3, 12( $sp )
+	addiu	$sp, 16
+	jr		$ra
+	move	$v0, $a1
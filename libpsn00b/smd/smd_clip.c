@@ -0,0 +1,393 @@
+/*
+ * PSn00bSDK .SMD model parser library (subdividing renderer)
+ * (C) 2019-2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * smdSortModel() drops any primitive with a vertex the GTE fails to project
+ * (i.e. too close to or behind the camera), making large ground and wall
+ * polygons pop out as soon as the camera gets near them. This renderer instead
+ * splits such polygons into four in model space (midpoints of each edge, plus
+ * the center for quads) and retries on each piece, up to a maximum depth.
+ * Polygons whose screen bounding box exceeds a given size are split the same
+ * way, which also keeps affine texture warping and the GPU's polygon size
+ * limits in check. Pieces that still can't be projected at the maximum depth
+ * are dropped, so polygons crossing the near plane get clipped at the
+ * granularity of the subdivision.
+ *
+ * Colors (including lighting, calculated once per original vertex) and
+ * texture coordinates are interpolated linearly across the pieces.
+ */
+
+#include <stdint.h>
+#include <psxgte.h>
+#include <psxgpu.h>
+#include <inline_c.h>
+#include <smd/smd.h>
+
+#define CLIP_LEFT	1
+#define CLIP_RIGHT	2
+#define CLIP_TOP	4
+#define CLIP_BOTTOM	8
+
+#define FLAG_DIV_OVERFLOW	(1 << 17)
+
+#define DEFAULT_NEAR_Z		16
+#define DEFAULT_MAX_SIZE	256
+#define DEFAULT_MAX_DEPTH	2
+
+typedef struct {
+	SVECTOR		pos;
+	uint32_t	sxy;
+	int32_t		sz;
+	CVECTOR		col;
+	uint8_t		u, v;
+	uint16_t	valid;
+} _Vertex;
+
+typedef struct {
+	uint32_t	*ot;
+	int			otlen, zdiv, zoff;
+
+	uint32_t	code, tpage_cmd;
+	uint16_t	clut, tpage;
+	int			textured, gouraud, nocull;
+} _SortState;
+
+/* Internal globals */
+
+// Defined in smd.s.
+extern DVECTOR	_sc_clip[2];
+extern uint16_t	_smd_tpage_base;
+
+static int _near_z    = DEFAULT_NEAR_Z;
+static int _max_size  = DEFAULT_MAX_SIZE;
+static int _max_depth = DEFAULT_MAX_DEPTH;
+
+/* Private utilities */
+
+static void _project(_Vertex *vert) {
+	int flag;
+
+	gte_ldv0(&vert->pos);
+	gte_rtps();
+	gte_stsxy(&vert->sxy);
+	gte_stsz(&vert->sz);
+	gte_stflg(&flag);
+
+	// The divide overflow flag is set whenever SZ3 is less than H / 2, in
+	// which case the screen coordinates are calculated from a clamped
+	// quotient and would make the vertex appear distorted.
+	vert->valid =
+		(flag >= 0) && !(flag & FLAG_DIV_OVERFLOW) && (vert->sz >= _near_z);
+}
+
+static void _midpoint(_Vertex *out, const _Vertex *a, const _Vertex *b) {
+	out->pos.vx = (a->pos.vx + b->pos.vx) / 2;
+	out->pos.vy = (a->pos.vy + b->pos.vy) / 2;
+	out->pos.vz = (a->pos.vz + b->pos.vz) / 2;
+	out->col.r  = (a->col.r + b->col.r) / 2;
+	out->col.g  = (a->col.g + b->col.g) / 2;
+	out->col.b  = (a->col.b + b->col.b) / 2;
+	out->u      = (a->u + b->u) / 2;
+	out->v      = (a->v + b->v) / 2;
+
+	_project(out);
+}
+
+static int _clip_code(uint32_t sxy) {
+	int x = (int16_t) sxy;
+	int y = (int16_t) (sxy >> 16);
+	int code = 0;
+
+	if (x < _sc_clip[0].vx)
+		code |= CLIP_LEFT;
+	if (x > _sc_clip[1].vx)
+		code |= CLIP_RIGHT;
+	if (y < _sc_clip[0].vy)
+		code |= CLIP_TOP;
+	if (y > _sc_clip[1].vy)
+		code |= CLIP_BOTTOM;
+
+	return code;
+}
+
+// Same logic as the ClipTestTri/ClipTestQuad macros in smd_s.inc. Quads also
+// have their diagonals tested, so that they are not culled when the camera is
+// facing right into them.
+static int _is_offscreen(const _Vertex **verts, int count) {
+	int c0 = _clip_code(verts[0]->sxy);
+	int c1 = _clip_code(verts[1]->sxy);
+	int c2 = _clip_code(verts[2]->sxy);
+
+	if (count == 3)
+		return (c0 & c1) && (c1 & c2) && (c2 & c0);
+
+	int c3 = _clip_code(verts[3]->sxy);
+
+	return (c0 & c1) && (c1 & c3) && (c3 & c2) && (c2 & c0) &&
+		(c0 & c3) && (c1 & c2);
+}
+
+static int _is_backface(const _Vertex **verts) {
+	int opz;
+
+	gte_ldsxy3(verts[0]->sxy, verts[1]->sxy, verts[2]->sxy);
+	gte_nclip();
+	gte_stopz(&opz);
+
+	return (opz < 0);
+}
+
+static int _is_too_large(const _Vertex **verts, int count) {
+	int min_x = 0x7fff, max_x = -0x8000;
+	int min_y = 0x7fff, max_y = -0x8000;
+
+	for (int i = 0; i < count; i++) {
+		int x = (int16_t) verts[i]->sxy;
+		int y = (int16_t) (verts[i]->sxy >> 16);
+
+		min_x = (x < min_x) ? x : min_x;
+		max_x = (x > max_x) ? x : max_x;
+		min_y = (y < min_y) ? y : min_y;
+		max_y = (y > max_y) ? y : max_y;
+	}
+
+	return ((max_x - min_x) > _max_size) || ((max_y - min_y) > _max_size);
+}
+
+static uint8_t *_emit(
+	const _SortState *state, uint8_t *pri, const _Vertex **verts, int count
+) {
+	int otz;
+
+	if (count == 4) {
+		gte_ldsz4(verts[0]->sz, verts[1]->sz, verts[2]->sz, verts[3]->sz);
+		gte_avsz4();
+	} else {
+		gte_ldsz3(verts[0]->sz, verts[1]->sz, verts[2]->sz);
+		gte_avsz3();
+	}
+	gte_stotz(&otz);
+
+	otz = (otz >> state->zdiv) - state->zoff;
+	if ((otz <= 0) || (otz >= state->otlen))
+		return pri;
+
+	// Build the packet one word at a time, in the same layout as the POLY_*
+	// structures. Untextured polygons are preceded by a texture page command
+	// to set the blending mode, like smdSortModel() does.
+	uint32_t *packet = (uint32_t *) pri;
+	uint32_t *ptr    = &packet[1];
+	uint32_t code    = state->code | ((count == 4) ? (0x08 << 24) : 0);
+
+	if (!state->textured)
+		*(ptr++) = state->tpage_cmd;
+
+	for (int i = 0; i < count; i++) {
+		const _Vertex *vert = verts[i];
+		uint32_t      rgb   = vert->col.r | (vert->col.g << 8) | (vert->col.b << 16);
+
+		if (!i)
+			*(ptr++) = rgb | code;
+		else if (state->gouraud)
+			*(ptr++) = rgb;
+
+		*(ptr++) = vert->sxy;
+
+		if (state->textured) {
+			uint32_t uv = vert->u | (vert->v << 8);
+
+			if (i == 0)
+				uv |= state->clut << 16;
+			else if (i == 1)
+				uv |= state->tpage << 16;
+
+			*(ptr++) = uv;
+		}
+	}
+
+	setlen(packet, ptr - packet - 1);
+	addPrim(&state->ot[otz], packet);
+
+	return (uint8_t *) ptr;
+}
+
+static uint8_t *_sort_tri(
+	const _SortState *state, uint8_t *pri, const _Vertex *v0,
+	const _Vertex *v1, const _Vertex *v2, int depth
+) {
+	const _Vertex *verts[3] = { v0, v1, v2 };
+
+	if ((v0->sz < _near_z) && (v1->sz < _near_z) && (v2->sz < _near_z))
+		return pri;
+
+	if (v0->valid && v1->valid && v2->valid) {
+		if (_is_offscreen(verts, 3))
+			return pri;
+		if (!state->nocull && _is_backface(verts))
+			return pri;
+		if ((depth >= _max_depth) || !_is_too_large(verts, 3))
+			return _emit(state, pri, verts, 3);
+	} else if (depth >= _max_depth) {
+		return pri;
+	}
+
+	// The inner triangle has the same winding order as the outer one.
+	_Vertex m01, m12, m20;
+
+	_midpoint(&m01, v0, v1);
+	_midpoint(&m12, v1, v2);
+	_midpoint(&m20, v2, v0);
+
+	depth++;
+	pri = _sort_tri(state, pri, v0, &m01, &m20, depth);
+	pri = _sort_tri(state, pri, &m01, v1, &m12, depth);
+	pri = _sort_tri(state, pri, &m20, &m12, v2, depth);
+	pri = _sort_tri(state, pri, &m01, &m12, &m20, depth);
+
+	return pri;
+}
+
+static uint8_t *_sort_quad(
+	const _SortState *state, uint8_t *pri, const _Vertex *v0,
+	const _Vertex *v1, const _Vertex *v2, const _Vertex *v3, int depth
+) {
+	const _Vertex *verts[4] = { v0, v1, v2, v3 };
+
+	if (
+		(v0->sz < _near_z) && (v1->sz < _near_z) &&
+		(v2->sz < _near_z) && (v3->sz < _near_z)
+	)
+		return pri;
+
+	if (v0->valid && v1->valid && v2->valid && v3->valid) {
+		if (_is_offscreen(verts, 4))
+			return pri;
+		if (!state->nocull && _is_backface(verts))
+			return pri;
+		if ((depth >= _max_depth) || !_is_too_large(verts, 4))
+			return _emit(state, pri, verts, 4);
+	} else if (depth >= _max_depth) {
+		return pri;
+	}
+
+	// Quad vertices are in GPU order (v0-v1 and v2-v3 being the top and bottom
+	// edges), so the center is the midpoint of the top and bottom midpoints.
+	_Vertex m01, m02, m13, m23, center;
+
+	_midpoint(&m01, v0, v1);
+	_midpoint(&m02, v0, v2);
+	_midpoint(&m13, v1, v3);
+	_midpoint(&m23, v2, v3);
+	_midpoint(&center, &m01, &m23);
+
+	depth++;
+	pri = _sort_quad(state, pri, v0, &m01, &m02, &center, depth);
+	pri = _sort_quad(state, pri, &m01, v1, &center, &m13, depth);
+	pri = _sort_quad(state, pri, &m02, &center, v2, &m23, depth);
+	pri = _sort_quad(state, pri, &center, &m13, &m23, v3, depth);
+
+	return pri;
+}
+
+/* Public API */
+
+void smdSetClipParam(int near_z, int max_size, int max_depth) {
+	_near_z    = near_z;
+	_max_size  = max_size;
+	_max_depth = max_depth;
+}
+
+uint8_t *smdSortModelClip(SC_OT *ot, uint8_t *pribuff, SMD *smd) {
+	_SortState state;
+	_Vertex    verts[4];
+
+	state.ot    = ot->ot;
+	state.otlen = ot->otlen;
+	state.zdiv  = ot->zdiv;
+	state.zoff  = (int8_t) ot->zoff;
+
+	const uint32_t *prim = (const uint32_t *) smd->p_prims;
+
+	for (uint32_t id = *prim; id; id = *prim) {
+		const uint8_t  *data    = (const uint8_t *) &prim[1];
+		const uint16_t *indices = (const uint16_t *) data;
+		const uint16_t *normals = 0;
+
+		int count  = ((id & 3) == 2) ? 4 : 3;
+		int l_type = (id >> 2) & 3;
+		int c_type = (id >> 4) & 1;
+
+		prim = (const uint32_t *) ((const uint8_t *) prim + (id >> 24));
+
+		if (((id & 3) != 1) && ((id & 3) != 2))
+			continue;
+
+		// Primitive data layout: vertex indices, normal indices (if lit), one
+		// color or one per vertex (if gouraud shaded), then texture
+		// coordinates and tpage/CLUT (if textured).
+		data += 8;
+		if (l_type) {
+			normals = (const uint16_t *) data;
+			data   += (l_type == 2) ? 8 : 4;
+		}
+
+		const uint32_t *colors = (const uint32_t *) data;
+		data += c_type ? (count * 4) : 4;
+
+		state.textured = (id >> 5) & 1;
+		state.gouraud  = (l_type == 2) || (!l_type && c_type);
+		state.nocull   = (id >> 12) & 1;
+
+		state.code  = (colors[0] & 0xff000000) | (0x20 << 24);
+		state.code |= state.textured ? (0x04 << 24) : 0;
+		state.code |= state.gouraud  ? (0x10 << 24) : 0;
+
+		state.tpage_cmd = 0xe1000000 | _smd_tpage_base | (((id >> 6) & 3) << 5);
+
+		for (int i = 0; i < count; i++) {
+			_Vertex *vert = &verts[i];
+
+			vert->pos = smd->p_verts[indices[i]];
+			_project(vert);
+
+			if (state.textured) {
+				vert->u = data[i * 2 + 0];
+				vert->v = data[i * 2 + 1];
+			}
+
+			if (l_type == 2) {
+				gte_ldv0(&smd->p_norms[normals[i]]);
+				gte_ldrgb(colors);
+				gte_nccs();
+				gte_strgb(&vert->col);
+			} else if (l_type == 1) {
+				if (!i) {
+					gte_ldv0(&smd->p_norms[normals[0]]);
+					gte_ldrgb(colors);
+					gte_nccs();
+					gte_strgb(&vert->col);
+				} else {
+					vert->col = verts[0].col;
+				}
+			} else {
+				*((uint32_t *) &vert->col) = colors[c_type ? i : 0];
+			}
+		}
+
+		if (state.textured) {
+			state.tpage = ((const uint16_t *) data)[4];
+			state.clut  = ((const uint16_t *) data)[5];
+		}
+
+		if (count == 4)
+			pribuff = _sort_quad(
+				&state, pribuff, &verts[0], &verts[1], &verts[2], &verts[3], 0
+			);
+		else
+			pribuff = _sort_tri(
+				&state, pribuff, &verts[0], &verts[1], &verts[2], 0
+			);
+	}
+
+	return pribuff;
+}
@@ -0,0 +1,287 @@
+/*
+ * PSn00bSDK .SMD model parser library (grouped renderer)
+ * (C) 2019-2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * smxlink -g sorts primitives by class (type, lighting, coloring and texture
+ * bits) and precedes each run of primitives of the same class with a group
+ * marker, a dummy primitive the other renderers skip. smdSortModelGrouped()
+ * reads the class once per group and processes the whole group with a loop
+ * specialized for that class (generated by the compiler from _sort_group()),
+ * rather than branching on the lighting and coloring type of every primitive
+ * like smdSortModel() does. Smooth shaded primitives are lit three vertices at
+ * a time with NCCT, or NCDT if depth cueing is enabled.
+ *
+ * Models without group markers are still rendered correctly, with each
+ * primitive treated as a group of one.
+ */
+
+#include <stdint.h>
+#include <psxgte.h>
+#include <psxgpu.h>
+#include <inline_c.h>
+#include <smd/smd.h>
+
+#define CLIP_LEFT	1
+#define CLIP_RIGHT	2
+#define CLIP_TOP	4
+#define CLIP_BOTTOM	8
+
+typedef struct {
+	uint32_t		*ot;
+	int				otlen, zdiv, zoff;
+	const SVECTOR	*verts, *norms;
+	uint8_t			*pri;
+} _SortContext;
+
+/* Internal globals */
+
+// Defined in smd.s.
+extern DVECTOR	_sc_clip[2];
+extern uint16_t	_smd_tpage_base;
+
+static int _depth_cue = 0;
+
+/* Private utilities */
+
+static inline int _clip_code(uint32_t sxy) {
+	int x = (int16_t) sxy;
+	int y = (int16_t) (sxy >> 16);
+	int code = 0;
+
+	if (x < _sc_clip[0].vx)
+		code |= CLIP_LEFT;
+	if (x > _sc_clip[1].vx)
+		code |= CLIP_RIGHT;
+	if (y < _sc_clip[0].vy)
+		code |= CLIP_TOP;
+	if (y > _sc_clip[1].vy)
+		code |= CLIP_BOTTOM;
+
+	return code;
+}
+
+static inline int _is_offscreen(const uint32_t *sxy, int quad) {
+	int c0 = _clip_code(sxy[0]);
+	int c1 = _clip_code(sxy[1]);
+	int c2 = _clip_code(sxy[2]);
+
+	if (!quad)
+		return (c0 & c1) && (c1 & c2) && (c2 & c0);
+
+	int c3 = _clip_code(sxy[3]);
+
+	return (c0 & c1) && (c1 & c3) && (c3 & c2) && (c2 & c0) &&
+		(c0 & c3) && (c1 & c2);
+}
+
+// All parameters after count are constants at each call site, so each
+// instance of this function only contains the code needed for its class.
+static inline __attribute__((always_inline)) const uint32_t *_sort_group(
+	_SortContext *ctx, const uint32_t *prim, int count, const int quad,
+	const int l_type, const int c_type, const int textured
+) {
+	const int      num_verts = quad ? 4 : 3;
+	const int      gouraud   = (l_type == 2) || (!l_type && c_type);
+	const uint32_t code      = (
+		0x20 | (quad ? 0x08 : 0) | (textured ? 0x04 : 0) | (gouraud ? 0x10 : 0)
+	) << 24;
+
+	const SVECTOR *verts = ctx->verts;
+	const SVECTOR *norms = ctx->norms;
+	uint8_t       *pri   = ctx->pri;
+
+	for (; count > 0; count--) {
+		uint32_t       id      = prim[0];
+		const uint16_t *indices = (const uint16_t *) &prim[1];
+		const uint8_t  *data    = (const uint8_t *) &prim[3];
+
+		uint32_t sxy[4], rgb[4];
+		int      flag, otz;
+
+		prim = (const uint32_t *) ((const uint8_t *) prim + (id >> 24));
+
+		gte_ldv3(&verts[indices[0]], &verts[indices[1]], &verts[indices[2]]);
+		gte_rtpt();
+		gte_stflg(&flag);
+		if (flag < 0)
+			continue;
+
+		if (!(id & (1 << 12))) {
+			int opz;
+
+			gte_nclip();
+			gte_stopz(&opz);
+			if (opz < 0)
+				continue;
+		}
+
+		if (quad) {
+			gte_stsxy0(&sxy[0]);
+			gte_ldv0(&verts[indices[3]]);
+			gte_rtps();
+			gte_stflg(&flag);
+			if (flag < 0)
+				continue;
+
+			gte_stsxy3c(&sxy[1]);
+			gte_avsz4();
+		} else {
+			gte_stsxy3c(&sxy[0]);
+			gte_avsz3();
+		}
+
+		gte_stotz(&otz);
+		otz = (otz >> ctx->zdiv) - ctx->zoff;
+		if ((otz <= 0) || (otz >= ctx->otlen))
+			continue;
+		if (_is_offscreen(sxy, quad))
+			continue;
+
+		// Primitive data layout: normal indices (if lit), one color or one
+		// per vertex (if gouraud shaded), then texture coordinates and
+		// tpage/CLUT (if textured).
+		const uint16_t *normals = (const uint16_t *) data;
+		if (l_type)
+			data += (l_type == 2) ? 8 : 4;
+
+		const uint32_t *colors = (const uint32_t *) data;
+		data += c_type ? (num_verts * 4) : 4;
+
+		const uint16_t *uvs = (const uint16_t *) data;
+
+		if (l_type == 2) {
+			gte_ldv3(&norms[normals[0]], &norms[normals[1]], &norms[normals[2]]);
+			gte_ldrgb(colors);
+			if (_depth_cue)
+				gte_ncdt();
+			else
+				gte_ncct();
+			gte_strgb3(&rgb[0], &rgb[1], &rgb[2]);
+
+			if (quad) {
+				gte_ldv0(&norms[normals[3]]);
+				if (_depth_cue)
+					gte_ncds();
+				else
+					gte_nccs();
+				gte_strgb(&rgb[3]);
+			}
+		} else if (l_type == 1) {
+			gte_ldv0(&norms[normals[0]]);
+			gte_ldrgb(colors);
+			if (_depth_cue)
+				gte_ncds();
+			else
+				gte_nccs();
+			gte_strgb(&rgb[0]);
+		} else {
+			for (int i = 0; i < (gouraud ? num_verts : 1); i++)
+				rgb[i] = colors[i];
+		}
+
+		// Build the packet. Untextured polygons are preceded by a texture page
+		// command to set the blending mode, like smdSortModel() does.
+		uint32_t *packet = (uint32_t *) pri;
+		uint32_t *ptr    = &packet[1];
+
+		if (!textured)
+			*(ptr++) = 0xe1000000 | _smd_tpage_base | (((id >> 6) & 3) << 5);
+
+		for (int i = 0; i < num_verts; i++) {
+			if (!i)
+				*(ptr++) = rgb[0] | code;
+			else if (gouraud)
+				*(ptr++) = rgb[i];
+
+			*(ptr++) = sxy[i];
+
+			if (textured) {
+				if (i == 0)
+					*(ptr++) = uvs[0] | (uvs[5] << 16); // UV0 + CLUT
+				else if (i == 1)
+					*(ptr++) = uvs[1] | (uvs[4] << 16); // UV1 + tpage
+				else
+					*(ptr++) = uvs[i];
+			}
+		}
+
+		setlen(packet, ptr - packet - 1);
+		addPrim(&ctx->ot[otz], packet);
+
+		pri = (uint8_t *) ptr;
+	}
+
+	ctx->pri = pri;
+	return prim;
+}
+
+static const uint32_t *_skip_group(const uint32_t *prim, int count) {
+	for (; count > 0; count--)
+		prim = (const uint32_t *) ((const uint8_t *) prim + (prim[0] >> 24));
+
+	return prim;
+}
+
+#define _CLASS(type, l_type, c_type, textured) \
+	((type) | ((l_type) << 2) | ((c_type) << 4) | ((textured) << 5))
+
+#define _CASE(type, l_type, c_type, textured) \
+	case _CLASS(type, l_type, c_type, textured): \
+		prim = _sort_group( \
+			&ctx, prim, count, (type) == 2, l_type, c_type, textured \
+		); \
+		break;
+
+// smxlink never generates gouraud colored primitives with textures, so no
+// loops are generated for them to save space.
+#define _CASES(type, l_type) \
+	_CASE(type, l_type, 0, 0) \
+	_CASE(type, l_type, 0, 1) \
+	_CASE(type, l_type, 1, 0)
+
+/* Public API */
+
+void smdSetDepthCue(int enable) {
+	_depth_cue = enable;
+}
+
+uint8_t *smdSortModelGrouped(SC_OT *ot, uint8_t *pribuff, SMD *smd) {
+	_SortContext ctx;
+
+	ctx.ot    = ot->ot;
+	ctx.otlen = ot->otlen;
+	ctx.zdiv  = ot->zdiv;
+	ctx.zoff  = (int8_t) ot->zoff;
+	ctx.verts = smd->p_verts;
+	ctx.norms = smd->p_norms;
+	ctx.pri   = pribuff;
+
+	const uint32_t *prim = (const uint32_t *) smd->p_prims;
+
+	for (uint32_t id = *prim; id; id = *prim) {
+		int count = 1;
+
+		if (id & SMD_GROUP_MARKER) {
+			count = ((const uint16_t *) prim)[5];
+			prim  = (const uint32_t *) ((const uint8_t *) prim + (id >> 24));
+			id    = *prim;
+
+			if (!count || !id)
+				continue;
+		}
+
+		switch (id & SMD_CLASS_MASK) {
+			_CASES(1, 0)
+			_CASES(1, 1)
+			_CASES(1, 2)
+			_CASES(2, 0)
+			_CASES(2, 1)
+			_CASES(2, 2)
+
+			default:
+				prim = _skip_group(prim, count);
+		}
+	}
+
+	return ctx.pri;
+}
@@ -0,0 +1,161 @@
+/*
+ * PSn00bSDK .SMD model parser library (LOD selection and culling)
+ * (C) 2019-2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * SML files (written by smxlink when given LODs) contain one or more meshes,
+ * each with a bounding sphere and up to SMD_MAX_LODS regular SMD models sorted
+ * from most to least detailed. smdSelectLod() transforms the center of the
+ * bounding sphere once using the current GTE matrix, tests the sphere against
+ * the planes going through the camera and the edges of the clip rectangle set
+ * by scSetClipRect(), then picks the first LOD whose minimum size is not
+ * larger than the projected radius of the sphere.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <psxgte.h>
+#include <inline_c.h>
+#include <smd/smd.h>
+
+typedef enum {
+	PLANE_LEFT   = 0,
+	PLANE_RIGHT  = 1,
+	PLANE_TOP    = 2,
+	PLANE_BOTTOM = 3
+} FrustumPlane;
+
+/* Internal globals */
+
+// Defined in smd.s.
+extern DVECTOR _sc_clip[2];
+
+// The side planes of the view frustum only depend on the projection
+// parameters and clip rectangle, so their normals are only recalculated when
+// any of those changes. Left/right planes have X and Z components, top/bottom
+// planes Y and Z.
+static struct {
+	int		h, ofx, ofy;
+	DVECTOR	clip[2];
+	int16_t	normals[4][2];
+} _frustum = { .h = -1 };
+
+/* Private utilities */
+
+static void _update_frustum(void) {
+	int h, ofx, ofy;
+
+	gte_ReadGeomScreen(&h);
+	gte_ReadGeomOffset(&ofx, &ofy);
+
+	if (
+		(h == _frustum.h) && (ofx == _frustum.ofx) && (ofy == _frustum.ofy) &&
+		!memcmp(_frustum.clip, _sc_clip, sizeof(_sc_clip))
+	)
+		return;
+
+	_frustum.h   = h;
+	_frustum.ofx = ofx;
+	_frustum.ofy = ofy;
+	memcpy(_frustum.clip, _sc_clip, sizeof(_sc_clip));
+
+	// A point is on the inner side of e.g. the left plane if
+	// (ofx + h * x / z) >= left, i.e. (h * x - (left - ofx) * z) >= 0.
+	const int edges[4][2] = {
+		{  h, ofx - _sc_clip[0].vx },
+		{ -h, _sc_clip[1].vx - ofx },
+		{  h, ofy - _sc_clip[0].vy },
+		{ -h, _sc_clip[1].vy - ofy }
+	};
+
+	for (int i = 0; i < 4; i++) {
+		int a   = edges[i][0];
+		int c   = edges[i][1];
+		int len = SquareRoot0(a * a + c * c);
+
+		if (!len)
+			len = 1;
+
+		_frustum.normals[i][0] = (a * ONE) / len;
+		_frustum.normals[i][1] = (c * ONE) / len;
+	}
+}
+
+static int _is_outside(FrustumPlane plane, int v, int z, int radius) {
+	const int16_t *normal = _frustum.normals[plane];
+
+	return (((normal[0] * v) + (normal[1] * z)) >> 12) < -radius;
+}
+
+/* Public API */
+
+SML *smdInitLodData(const void *data) {
+	SML *sml = (SML *) data;
+
+	if (memcmp(sml->id, "SML", 3))
+		return 0;
+
+	for (int i = 0; i < sml->n_meshes; i++) {
+		SMD_MESH *mesh = &sml->meshes[i];
+
+		for (int j = 0; j < mesh->n_lods; j++) {
+			uint32_t offset = (uint32_t) mesh->lods[j].smd;
+
+			mesh->lods[j].smd = smdInitData((const uint8_t *) data + offset);
+		}
+	}
+
+	return sml;
+}
+
+SMD *smdSelectLod(const SMD_MESH *mesh) {
+	VECTOR pos;
+	int    radius = mesh->bound.pad;
+
+	_update_frustum();
+
+	// Only the rotated and translated center is needed. The radius is kept in
+	// the upper half of the VZ0 word and ignored by the GTE.
+	gte_ldv0(&mesh->bound);
+	gte_rtps();
+	gte_stlvnl(&pos);
+
+	if ((pos.vz + radius) <= 0)
+		return 0;
+
+	// Scale everything down if needed so that the plane distance calculations
+	// can't overflow.
+	for (;;) {
+		int x = (pos.vx < 0) ? -pos.vx : pos.vx;
+		int y = (pos.vy < 0) ? -pos.vy : pos.vy;
+		int z = (pos.vz < 0) ? -pos.vz : pos.vz;
+
+		if ((x | y | z) < 0x40000)
+			break;
+
+		pos.vx >>= 1;
+		pos.vy >>= 1;
+		pos.vz >>= 1;
+		radius >>= 1;
+	}
+
+	if (
+		_is_outside(PLANE_LEFT,   pos.vx, pos.vz, radius) ||
+		_is_outside(PLANE_RIGHT,  pos.vx, pos.vz, radius) ||
+		_is_outside(PLANE_TOP,    pos.vy, pos.vz, radius) ||
+		_is_outside(PLANE_BOTTOM, pos.vy, pos.vz, radius)
+	)
+		return 0;
+
+	// If the camera is inside the sphere always use the most detailed LOD.
+	int size = 0x7fff;
+
+	if (pos.vz > radius)
+		size = (radius * _frustum.h) / pos.vz;
+
+	for (int i = 0; i < mesh->n_lods; i++) {
+		if (size >= mesh->lods[i].min_size)
+			return mesh->lods[i].smd;
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * PSn00bSDK .SMD model parser library (skinned models)
+ * (C) 2019-2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * Skinned SMD files (written by smxlink from SMX files with bones) contain a
+ * skeleton and keyframe animations besides the usual model data. Vertices and
+ * normals are sorted by the bone they are bound to, and vertices are stored
+ * relative to the origin of their bone, so that each bone's vertices can be
+ * transformed as a single batch with smdTransformVerts() once the bone's
+ * matrix is loaded into the GTE. The model is then drawn from the vertex cache
+ * using smdSortModelCached().
+ *
+ * Bone matrices are built in model space by chaining each bone's local
+ * rotation and offset onto its parent's matrix with CompMatrixLV(), then
+ * combined with the model's matrix to get the matrix actually used for
+ * projection. If requested, normals are rotated by the model space matrices so
+ * lighting can still be calculated using the model's light matrix.
+ */
+
+#include <stdint.h>
+#include <psxgte.h>
+#include <inline_c.h>
+#include <smd/smd.h>
+
+/* Private utilities */
+
+static inline void *_relocate(const SMD *smd, const void *offset) {
+	return (void *) ((uint32_t) smd + (uint32_t) offset);
+}
+
+static inline int _lerp(int a, int b, int t) {
+	return a + (((b - a) * t) >> 12);
+}
+
+// Interpolates between two angles through the shortest path, wrapping around
+// at 360 degrees.
+static inline int _lerp_angle(int a, int b, int t) {
+	int delta = ((b - a) << 20) >> 20;
+
+	return a + ((delta * t) >> 12);
+}
+
+/* Public API */
+
+SMD_SKIN *smdInitSkinData(SMD *smd) {
+	if (!(smd->flags & SMD_FLAG_SKINNED))
+		return 0;
+
+	// The skin header immediately follows the SMD header.
+	SMD_SKIN *skin = (SMD_SKIN *) &smd[1];
+
+	skin->p_bones = _relocate(smd, skin->p_bones);
+	skin->p_anims = _relocate(smd, skin->p_anims);
+	skin->p_norms = smd->p_norms;
+
+	for (int i = 0; i < skin->n_anims; i++) {
+		SMD_ANIM *anim = &skin->p_anims[i];
+
+		anim->p_frames = _relocate(smd, anim->p_frames);
+		anim->p_poses  = _relocate(smd, anim->p_poses);
+	}
+
+	return skin;
+}
+
+void smdGetPose(
+	SMD_POSE *pose, const SMD_SKIN *skin, const SMD_ANIM *anim, int time
+) {
+	const uint16_t *frames = anim->p_frames;
+	int            last    = anim->n_keys - 1;
+
+	// The time is in 20.12 fixed-point frames. Looping animations wrap
+	// around at their last keyframe (which should match the first one), the
+	// others stop on it.
+	if (time < 0)
+		time = 0;
+
+	if (time >= (frames[last] << 12)) {
+		if ((anim->flags & SMD_ANIM_LOOP) && frames[last])
+			time %= frames[last] << 12;
+		else
+			time = frames[last] << 12;
+	}
+
+	int key = 0;
+	while ((key < (last - 1)) && (time >= (frames[key + 1] << 12)))
+		key++;
+
+	const SMD_POSE *a = &anim->p_poses[key * skin->n_bones];
+	const SMD_POSE *b = a;
+	int            t  = 0;
+
+	if (key < last) {
+		int length = frames[key + 1] - frames[key];
+
+		b = &a[skin->n_bones];
+		if (length)
+			t = (time - (frames[key] << 12)) / length;
+		if (t > ONE)
+			t = ONE;
+	}
+
+	for (int i = 0; i < skin->n_bones; i++, a++, b++, pose++) {
+		pose->rot.vx = _lerp_angle(a->rot.vx, b->rot.vx, t);
+		pose->rot.vy = _lerp_angle(a->rot.vy, b->rot.vy, t);
+		pose->rot.vz = _lerp_angle(a->rot.vz, b->rot.vz, t);
+		pose->pos.vx = _lerp(a->pos.vx, b->pos.vx, t);
+		pose->pos.vy = _lerp(a->pos.vy, b->pos.vy, t);
+		pose->pos.vz = _lerp(a->pos.vz, b->pos.vz, t);
+	}
+}
+
+SMD_VCACHE *smdTransformSkin(
+	SMD_VCACHE *cache, SVECTOR *norms, SMD *smd, const SMD_SKIN *skin,
+	const SMD_POSE *pose, MATRIX *mtx, MATRIX *bone_mtx
+) {
+	for (int i = 0; i < skin->n_bones; i++) {
+		const SMD_BONE *bone  = &skin->p_bones[i];
+		MATRIX         *model = &bone_mtx[i];
+		MATRIX         local, view;
+
+		RotMatrix((SVECTOR *) &pose[i].rot, &local);
+		local.t[0] = bone->origin.vx + pose[i].pos.vx;
+		local.t[1] = bone->origin.vy + pose[i].pos.vy;
+		local.t[2] = bone->origin.vz + pose[i].pos.vz;
+
+		if (bone->parent < 0)
+			*model = local;
+		else
+			CompMatrixLV(&bone_mtx[bone->parent], &local, model);
+
+		// ApplyMatrixN() loads the bone's rotation into the GTE and overlaps
+		// fetching each normal with the rotation of the previous one.
+		if (norms && bone->n_norms)
+			ApplyMatrixN(
+				model, &skin->p_norms[bone->first_norm],
+				&norms[bone->first_norm], bone->n_norms
+			);
+
+		if (!bone->n_verts)
+			continue;
+
+		CompMatrixLV(mtx, model, &view);
+		gte_SetRotMatrix(&view);
+		gte_SetTransMatrix(&view);
+
+		smdTransformVerts(
+			&cache[bone->first_vert], &smd->p_verts[bone->first_vert],
+			bone->n_verts
+		);
+	}
+
+	if (norms)
+		smd->p_norms = norms;
+
+	return cache + smd->n_verts;
+}
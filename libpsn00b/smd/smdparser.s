@@ -56,6 +56,7 @@ ReadSMD:
 	lw		$v0, 0($v0)
 	nop
 
+$next_prim:
 	lw		$a2, 0($v0)				# Load primitive ID
 	addiu	$a1, $v0, 4
 
@@ -66,6 +67,12 @@ ReadSMD:
 
 	srl		$v1, $a2, 24			# Get primitive size
 	addu	$v0, $v1
+
+	srl		$v1, $a2, 23			# Skip group markers
+	andi	$v1, 0x1
+	bnez	$v1, $next_prim
+	nop
+
 	la		$v1, _smd_parse_addr
 	sw		$v0, 0($v1)
 
@@ -0,0 +1,174 @@
+#include <filesystem>
+
+#include "lzp.h"
+#include "cache.h"
+
+// Bump this whenever a change to the compressor alters its output, so that
+// stale cache entries are no longer used
+#define CACHE_VERSION	1
+
+typedef struct {
+	char		id[4];
+	uint32_t	dataSize;	// Size of uncompressed data
+	uint32_t	dataCrc;	// CRC32 of uncompressed data
+	uint32_t	compSize;	// Size of compressed data that follows
+} CACHE_HEAD;
+
+CacheClass::CacheClass() : TempCounter(0) {
+
+}
+
+bool CacheClass::Open(const char* cacheDir) {
+
+	std::error_code error;
+
+	std::filesystem::create_directories(cacheDir, error);
+
+	if (error) {
+		printf("WARNING: Could not create cache directory %s, cache disabled.\n", cacheDir);
+		return(false);
+	}
+
+	CacheDir = cacheDir;
+
+	return(true);
+
+}
+
+bool CacheClass::IsOpen() {
+
+	return(!CacheDir.empty());
+
+}
+
+std::string CacheClass::EntryPath(uint64_t key) {
+
+	char name[24];
+
+	snprintf(name, sizeof(name), "%016llx.lzk", (unsigned long long)key);
+
+	return((std::filesystem::path(CacheDir)/name).string());
+
+}
+
+// 64-bit FNV-1a, which is more than enough to tell files apart (entries are
+// also checked against the size and CRC of the data when loaded)
+uint64_t CacheClass::HashData(const void* data, int size, uint64_t hash) {
+
+	const uint8_t* ptr = (const uint8_t*)data;
+
+	for(int i=0; i<size; i++)
+		hash = (hash^ptr[i])*0x100000001b3ull;
+
+	return(hash);
+
+}
+
+uint64_t CacheClass::GetKey(const void* data, int dataSize, const FileListEntry* entry, int level, uint64_t dictHash) {
+
+	int params[] = {
+		CACHE_VERSION,
+		dataSize,
+		entry->windowSize,
+		entry->hash1Size,
+		entry->hash2Size,
+		level
+	};
+
+	uint64_t hash = HashData(params, sizeof(params));
+
+	hash = HashData(&dictHash, sizeof(dictHash), hash);
+
+	return(HashData(data, dataSize, hash));
+
+}
+
+// Returns a copy of the cached compressed data for the given key, or NULL if
+// the key is not in the cache or the entry does not match the data
+char* CacheClass::Load(uint64_t key, const void* data, int dataSize, int* compSize) {
+
+	CACHE_HEAD	head;
+	FILE*		fp;
+	char*		compData;
+
+	if (!IsOpen())
+		return(NULL);
+
+	fp = fopen(EntryPath(key).c_str(), "rb");
+
+	if (fp == NULL)
+		return(NULL);
+
+	if (
+		(fread(&head, sizeof(CACHE_HEAD), 1, fp) != 1) ||
+		(memcmp(head.id, "LZK1", 4) != 0) ||
+		(head.dataSize != (uint32_t)dataSize) ||
+		(head.dataCrc != lzCRC32(data, dataSize, LZP_CRC32_REMAINDER))
+	) {
+		fclose(fp);
+		return(NULL);
+	}
+
+	// Allocate the same amount of slack as the compressor does, as callers
+	// treat the buffer the same way
+	compData = new char[LZP_COMPRESS_BOUND(dataSize)];
+
+	if ((head.compSize > (uint32_t)LZP_COMPRESS_BOUND(dataSize)) || (fread(compData, head.compSize, 1, fp) != 1)) {
+
+		fclose(fp);
+		delete[] compData;
+		return(NULL);
+
+	}
+
+	fclose(fp);
+
+	*compSize = head.compSize;
+
+	return(compData);
+
+}
+
+// Writes compressed data to the cache. Entries are written to a temporary file
+// and then renamed, so that concurrent writers (e.g. two identical files being
+// compressed at the same time) never leave a partially written entry behind.
+void CacheClass::Store(uint64_t key, const void* data, int dataSize, const void* compData, int compSize) {
+
+	CACHE_HEAD		head;
+	FILE*			fp;
+	std::string		path, tempPath;
+	std::error_code	error;
+
+	if (!IsOpen())
+		return;
+
+	path		= EntryPath(key);
+#ifdef WIN32
+	tempPath	= path+"."+std::to_string(GetCurrentProcessId())+"."+std::to_string(TempCounter++);
+#else
+	tempPath	= path+"."+std::to_string(getpid())+"."+std::to_string(TempCounter++);
+#endif
+
+	memcpy(head.id, "LZK1", 4);
+	head.dataSize	= dataSize;
+	head.dataCrc	= lzCRC32(data, dataSize, LZP_CRC32_REMAINDER);
+	head.compSize	= compSize;
+
+	fp = fopen(tempPath.c_str(), "wb");
+
+	if (fp == NULL)
+		return;
+
+	bool ok =
+		(fwrite(&head, sizeof(CACHE_HEAD), 1, fp) == 1) &&
+		(fwrite(compData, compSize, 1, fp) == 1);
+
+	fclose(fp);
+
+	if (ok)
+		std::filesystem::rename(tempPath, path, error);
+
+	if (!ok || error)
+		std::filesystem::remove(tempPath, error);
+
+}
@@ -0,0 +1,37 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "filelist.h"
+
+// On-disk cache of compressed data, used to skip recompressing files that
+// have not changed since the last run. Entries are keyed by a hash of the
+// uncompressed data and of all the settings that affect the compressor's
+// output, and are stored as individual files in the cache directory.
+class CacheClass {
+
+	std::string			CacheDir;
+	std::atomic<int>	TempCounter;
+
+	std::string EntryPath(uint64_t key);
+
+public:
+
+	CacheClass();
+
+	bool Open(const char* cacheDir);
+	bool IsOpen();
+
+	static uint64_t HashData(const void* data, int size, uint64_t hash = 0xcbf29ce484222325ull);
+	static uint64_t GetKey(const void* data, int dataSize, const FileListEntry* entry, int level, uint64_t dictHash);
+
+	char* Load(uint64_t key, const void* data, int dataSize, int* compSize);
+	void Store(uint64_t key, const void* data, int dataSize, const void* compData, int compSize);
+
+};
+
+
+#endif
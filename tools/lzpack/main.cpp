@@ -1,9 +1,16 @@
 #include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <tinyxml2.h>
 
 #include "lzconfig.h"
 #include "lzp.h"
+#include "lzhash.h"
+#include "lzdict.h"
 #include "filelist.h"
+#include "cache.h"
 
 
 #define BUFF_SIZE	4096
@@ -35,13 +42,44 @@ typedef struct {
 } PCK_TOC;
 
 
+// PCK v2 format (see psxcd.h)
+typedef struct {
+	char			magic[4];
+	unsigned int	numEntries;
+	unsigned int	tocLength;
+	unsigned int	reserved;
+} PCK2_HEAD;
+
+typedef struct {
+	unsigned int	hash;
+	unsigned int	offset;			// In 2048 byte sector units
+	unsigned int	size;
+	unsigned int	packedSize;		// 0 if not compressed
+	unsigned int	nameOffset;
+} PCK2_ENTRY;
+
+
+typedef struct {
+	const FileListEntry*	entry;
+	const char*	data;
+	int			dataSize;
+	char*		compBuff;
+	int			compSize;
+} LZP_JOB;
+
+
 namespace param {
 
 	bool	AlwaysOverwrite		= false;
+	int		NumThreads			= 0;
+	int		Level				= LZP_COMPRESS_MAX;
+	char	CacheDir[MAX_PATH]	= { 0 };
 	char	ScriptFile[MAX_PATH]= { 0 };
 
 }
 
+CacheClass Cache;
+
 
 int ParseCreateElement(tinyxml2::XMLElement* element);
 
@@ -57,8 +95,11 @@ int main(int argc, const char* argv[]) {
 	if (argc <= 1) {
 
 		printf("Parameters:\n");
-		printf("   lzpack [-y] <scriptFile>\n\n");
+		printf("   lzpack [-y] [-j <threads>] [-l <level>] [-c <cacheDir>] <scriptFile>\n\n");
 		printf("   -y           - Always overwrite existing files.\n");
+		printf("   -j <threads> - Number of threads to compress files with (default: all cores).\n");
+		printf("   -l <level>   - LZP compression level, 0-3 (default: 2, 3 is slower but smaller).\n");
+		printf("   -c <dir>     - Cache compressed files in a directory and reuse them if unchanged.\n");
 		printf("   <scriptFile> - Script file to parse (in XML format, see readme.txt).\n");
 
 		exit(0);
@@ -73,6 +114,23 @@ int main(int argc, const char* argv[]) {
 
 			param::AlwaysOverwrite = true;
 
+        } else if ((strcmp("-j", argv[i]) == 0) && ((i+1) < argc)) {
+
+			param::NumThreads = atoi(argv[++i]);
+
+        } else if ((strcmp("-l", argv[i]) == 0) && ((i+1) < argc)) {
+
+			param::Level = atoi(argv[++i]);
+
+			if ((param::Level < LZP_COMPRESS_FAST) || (param::Level > LZP_COMPRESS_OPTIMAL)) {
+				printf("ERROR: Invalid compression level: %d\n", param::Level);
+				exit(EXIT_FAILURE);
+			}
+
+        } else if ((strcmp("-c", argv[i]) == 0) && ((i+1) < argc)) {
+
+			strcpy(param::CacheDir, argv[++i]);
+
         } else if ((argv[i][0] == '-') || (argv[i][0] == '/')) {
 
 			printf("Unknown parameter: %s\n", argv[i]);
@@ -85,11 +143,19 @@ int main(int argc, const char* argv[]) {
 
 	}
 
+	if (param::NumThreads <= 0)
+		param::NumThreads = std::thread::hardware_concurrency();
+	if (param::NumThreads <= 0)
+		param::NumThreads = 1;
+
 	if (strlen(param::ScriptFile) == 0) {
 		printf("ERROR: No script file specified.\n");
 		exit(EXIT_FAILURE);
 	}
 
+	if (strlen(param::CacheDir) > 0)
+		Cache.Open(param::CacheDir);
+
 
 	tinyxml2::XMLDocument document;
 
@@ -148,76 +214,270 @@ int main(int argc, const char* argv[]) {
 }
 
 
-int CreateLZPfile(const char* packFile, FileListClass* fileList) {
+// Compresses all jobs using a pool of worker threads, each with its own
+// compressor context. Jobs are picked in order from a shared counter, so the
+// compressed data does not depend on the number of threads. If a dictionary is
+// given, all jobs are compressed with it. Jobs whose data and settings match
+// an entry in the cache (if enabled) are not compressed again.
+void CompressJobs(LZP_JOB* jobs, int numJobs, const char* dict = NULL, int dictSize = 0) {
+
+	std::atomic<int>			nextJob(0);
+	std::atomic<int>			numCached(0);
+	std::vector<std::thread>	threads;
+
+	int			numThreads	= std::min(param::NumThreads, numJobs);
+	uint64_t	dictHash	= dict ? CacheClass::HashData(dict, dictSize) : 0;
+
+	auto worker = [&]() {
+
+		LZP_CONTEXT ctx;
+
+		lzInitContext(&ctx);
+		lzSetDictionary(&ctx, dict, dictSize);
+
+		for(int i; (i = nextJob++) < numJobs;) {
+
+			ctx.windowSize	= jobs[i].entry->windowSize;
+			ctx.hash1Size	= jobs[i].entry->hash1Size;
+			ctx.hash2Size	= jobs[i].entry->hash2Size;
+
+			uint64_t key = 0;
+
+			if (Cache.IsOpen()) {
+
+				key = CacheClass::GetKey(jobs[i].data, jobs[i].dataSize, jobs[i].entry, param::Level, dictHash);
+				jobs[i].compBuff = Cache.Load(key, jobs[i].data, jobs[i].dataSize, &jobs[i].compSize);
+
+				if (jobs[i].compBuff != NULL) {
+					numCached++;
+					continue;
+				}
+
+			}
+
+			jobs[i].compBuff = new char[LZP_COMPRESS_BOUND(jobs[i].dataSize)];
+			jobs[i].compSize = lzCompressCtx(&ctx, jobs[i].compBuff, jobs[i].data, jobs[i].dataSize, param::Level);
+
+			if (Cache.IsOpen())
+				Cache.Store(key, jobs[i].data, jobs[i].dataSize, jobs[i].compBuff, jobs[i].compSize);
+
+		}
+
+	};
+
+	for(int i=1; i<numThreads; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for(auto& thread : threads)
+		thread.join();
+
+	if (Cache.IsOpen())
+		printf("   Reused %d of %d compressed file(s) from cache.\n", numCached.load(), numJobs);
+
+}
+
+// Gets the name of a file list entry and validates it, returning NULL if it
+// is too long
+const char* GetEntryName(FileListClass* fileList, int index) {
+
+	const char* name;
+
+	if (fileList->Entry(index)->aliasName == NULL) {
+
+		name = TrimPathName(fileList->Entry(index)->fileName);
+
+	} else {
+
+		name = fileList->Entry(index)->aliasName;
+
+	}
+
+	if (strlen(name) > 15) {
+
+		printf("ERROR: Entry '%s' has more than 15 characters.\n", name);
+		return(NULL);
+
+	}
+
+	return(name);
+
+}
+
+char* LoadFile(const char* fileName, int* fileSize) {
+
+	FILE*	fp = fopen(fileName, "rb");
+
+	fseek(fp, 0, SEEK_END);
+	*fileSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	char* fileBuff = new char[*fileSize];
+	fread(fileBuff, *fileSize, 1, fp);
+
+	fclose(fp);
+
+	return(fileBuff);
+
+}
+
+void PrintPacking(FileListClass* fileList, int index) {
+
+	if (fileList->Entry(index)->aliasName == NULL) {
+		printf("   Packing %s... ", fileList->Entry(index)->fileName);
+	} else {
+		printf("   Packing %s as %s... ", fileList->Entry(index)->fileName, fileList->Entry(index)->aliasName);
+	}
+
+}
+
+// Returns the size of the name hash table written after the file table of an
+// archive, rounded up to a multiple of 4 bytes
+int HashTableSize(int numFiles) {
+
+	int numSlots = 1;
+
+	while(numSlots < (numFiles*2))
+		numSlots <<= 1;
+
+	return((sizeof(LZP_HASH)+numSlots+3)&~3);
+
+}
+
+// Writes the name hash table for an archive's file table. names points to the
+// name of the first entry and stride is the size of each entry.
+void WriteHashTable(FILE* fp, const char* names, int stride, int numFiles) {
+
+	int			tableSize = HashTableSize(numFiles);
+	uint8_t*	table = new uint8_t[tableSize];
+	LZP_HASH*	head = (LZP_HASH*)table;
+	uint8_t*	slots = table+sizeof(LZP_HASH);
+
+	memset(table, 0, tableSize);
+	memcpy(head->id, LZP_HASH_ID, 4);
+	head->numSlots = 1;
+
+	while(head->numSlots < (numFiles*2))
+		head->numSlots <<= 1;
+
+	for(int i=0; i<numFiles; i++) {
+
+		uint32_t j = lzHashName(names+(stride*i))&(head->numSlots-1);
+
+		while(slots[j] != 0)
+			j = (j+1)&(head->numSlots-1);
+
+		slots[j] = i+1;
+
+	}
+
+	fwrite(table, tableSize, 1, fp);
+	delete[] table;
+
+}
+
+// Writes the preset dictionary section of an archive
+void WriteDictionary(FILE* fp, const char* dict, int dictSize) {
+
+	LZP_DICT	head;
+	uint32_t	padding = 0;
+
+	memcpy(head.id, LZP_DICT_ID, 4);
+	head.size = dictSize;
+
+	fwrite(&head, sizeof(LZP_DICT), 1, fp);
+	fwrite(dict, dictSize, 1, fp);
+	fwrite(&padding, (4-(dictSize%4))%4, 1, fp);
+
+}
+
+int CreateLZPfile(const char* packFile, FileListClass* fileList, const char* dictFile) {
 
 	FILE*		packp;
-	LZP_FILE*	entry=new LZP_FILE[fileList->EntryCount()];
+	LZP_FILE*	entry=new LZP_FILE[fileList->EntryCount()]();
+	LZP_JOB*	jobs=new LZP_JOB[fileList->EntryCount()];
 	int			overallSize=0;
 	int			overallPackedSize=0;
+	char*		dict=NULL;
+	int			dictSize=0;
+	int			dictSectionSize=0;
 
-    packp = fopen(packFile, "wb");
+	// Validate entry names and load all files first
+	for(int i=0; i<fileList->EntryCount(); i++) {
 
-    fseek(packp, sizeof(LZP_HEAD)+(sizeof(LZP_FILE)*fileList->EntryCount()), SEEK_SET);
+		const char* name = GetEntryName(fileList, i);
 
-	for(int i=0; i<fileList->EntryCount(); i++) {
+		if (name == NULL) {
 
-        const char* name;
+			for(int j=0; j<i; j++)
+				delete[] jobs[j].data;
 
-        if (fileList->Entry(i)->aliasName == NULL) {
+			delete[] jobs;
+			delete[] entry;
 
-			name = TrimPathName(fileList->Entry(i)->fileName);
+			return(0);
 
-        } else {
+		}
 
-        	name = fileList->Entry(i)->aliasName;
+		strcpy(entry[i].fileName, name);
 
-        }
+		jobs[i].entry	= fileList->Entry(i);
+		jobs[i].data	= LoadFile(fileList->Entry(i)->fileName, &jobs[i].dataSize);
 
-        if (strlen(name) > 15) {
+	}
 
-            printf("ERROR: Entry '%s' has more than 15 characters.\n", name);
-            fclose(packp);
-            unlink(packFile);
-            delete[] entry;
+	// Only the last part of the dictionary that fits in the smallest window
+	// is referenced by the compressor, so the rest is not stored
+	if (dictFile != NULL) {
 
-            return(0);
+		int windowSize = 1<<LZP_WINDOW_SIZE;
 
-        }
+		for(int i=0; i<fileList->EntryCount(); i++)
+			windowSize = std::min(windowSize, 1<<fileList->Entry(i)->windowSize);
 
-		strcpy(entry[i].fileName, name);
+		dict = LoadFile(dictFile, &dictSize);
 
-		if (fileList->Entry(i)->aliasName == NULL) {
-			printf("   Packing %s... ", fileList->Entry(i)->fileName);
-		} else {
-			printf("   Packing %s as %s... ", fileList->Entry(i)->fileName, fileList->Entry(i)->aliasName);
+		if (dictSize > windowSize) {
+			memmove(dict, dict+(dictSize-windowSize), windowSize);
+			dictSize = windowSize;
 		}
 
+		dictSectionSize = sizeof(LZP_DICT)+((dictSize+3)&~3);
+
+		printf("   Using %d byte dictionary %s.\n", dictSize, dictFile);
 
-		FILE*	fp = fopen(fileList->Entry(i)->fileName, "rb");
+	}
 
-		fseek(fp, 0, SEEK_END);
-        int fileSize = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
+	printf("   Compressing %d file(s) using %d thread(s)...\n",
+		fileList->EntryCount(),
+		std::min(param::NumThreads, fileList->EntryCount())
+	);
 
-        char* fileBuff = new char[fileSize];
-		fread(fileBuff, fileSize, 1, fp);
+	CompressJobs(jobs, fileList->EntryCount(), dict, dictSize);
 
-		fclose(fp);
+	// Write compressed files in their original order
+    packp = fopen(packFile, "wb");
 
+    fseek(packp, sizeof(LZP_HEAD)+(sizeof(LZP_FILE)*fileList->EntryCount())+
+		HashTableSize(fileList->EntryCount())+dictSectionSize, SEEK_SET);
 
-        char*	compBuff = new char[fileSize+16384];
-        int		compSize = lzCompress(compBuff, fileBuff, fileSize, 2);
+	for(int i=0; i<fileList->EntryCount(); i++) {
+
+		PrintPacking(fileList, i);
 
+        int fileSize = jobs[i].dataSize;
+        int compSize = jobs[i].compSize;
 
-        entry[i].crc		= lzCRC32(compBuff, compSize, LZP_CRC32_REMAINDER);
+        entry[i].crc		= lzCRC32(jobs[i].compBuff, compSize, LZP_CRC32_REMAINDER);
 		entry[i].fileSize	= fileSize;
 		entry[i].packedSize	= compSize;
         entry[i].offset		= ftell(packp);
 
-        fwrite(compBuff, compSize, 1, packp);
+        fwrite(jobs[i].compBuff, compSize, 1, packp);
 
-        delete[] compBuff;
-        delete[] fileBuff;
+        delete[] jobs[i].compBuff;
+        delete[] jobs[i].data;
 
 		printf("Ok. (%.02f%%)\n", 100.f*((float)compSize/fileSize));
 
@@ -236,8 +496,158 @@ int CreateLZPfile(const char* packFile, FileListClass* fileList) {
 	fwrite(&head, sizeof(LZP_HEAD), 1, packp);
 
     fwrite(entry, sizeof(LZP_FILE), fileList->EntryCount(), packp);
+	WriteHashTable(packp, entry[0].fileName, sizeof(LZP_FILE), fileList->EntryCount());
+
+	if (dict != NULL)
+		WriteDictionary(packp, dict, dictSize);
 
 	fclose(packp);
+	delete[] jobs;
+	delete[] entry;
+	delete[] dict;
+
+    printf("Packed %d file(s) totaling %d bytes (%.02f%% compression ratio).\n",
+		fileList->EntryCount(),
+		overallPackedSize,
+		100.f*((float)overallPackedSize/overallSize)
+	);
+
+
+	return(true);
+
+}
+
+// Same as CreateLZPfile(), but each file is split into blocks of blockSize
+// bytes which are compressed independently. Each file's data is prefixed with
+// an LZP_BLOCKS index containing the offset of each block.
+int CreateLZCfile(const char* packFile, FileListClass* fileList, int blockSize) {
+
+	FILE*		packp;
+	LZP_FILE*	entry=new LZP_FILE[fileList->EntryCount()]();
+	char**		fileBuff=new char*[fileList->EntryCount()];
+	int*		firstJob=new int[fileList->EntryCount()+1];
+	int			overallSize=0;
+	int			overallPackedSize=0;
+
+	std::vector<LZP_JOB> jobs;
+
+	// Validate entry names, load all files and split them into blocks
+	for(int i=0; i<fileList->EntryCount(); i++) {
+
+		const char* name = GetEntryName(fileList, i);
+
+		if (name == NULL) {
+
+			for(int j=0; j<i; j++)
+				delete[] fileBuff[j];
+
+			delete[] firstJob;
+			delete[] fileBuff;
+			delete[] entry;
+
+			return(0);
+
+		}
+
+		strcpy(entry[i].fileName, name);
+
+		int fileSize;
+
+		fileBuff[i]	= LoadFile(fileList->Entry(i)->fileName, &fileSize);
+		firstJob[i]	= jobs.size();
+
+		entry[i].fileSize = fileSize;
+
+		for(int pos=0; pos<fileSize; pos+=blockSize) {
+
+			LZP_JOB job;
+
+			job.entry		= fileList->Entry(i);
+			job.data		= fileBuff[i]+pos;
+			job.dataSize	= std::min(blockSize, fileSize-pos);
+
+			jobs.push_back(job);
+
+		}
+
+	}
+
+	firstJob[fileList->EntryCount()] = jobs.size();
+
+	printf("   Compressing %d block(s) using %d thread(s)...\n",
+		(int)jobs.size(),
+		std::min(param::NumThreads, (int)jobs.size())
+	);
+
+	CompressJobs(jobs.data(), jobs.size());
+
+	// Write block indexes and compressed blocks in their original order
+    packp = fopen(packFile, "wb");
+
+    fseek(packp, sizeof(LZP_HEAD)+(sizeof(LZP_FILE)*fileList->EntryCount())+
+		HashTableSize(fileList->EntryCount()), SEEK_SET);
+
+	for(int i=0; i<fileList->EntryCount(); i++) {
+
+		PrintPacking(fileList, i);
+
+		int numBlocks = firstJob[i+1]-firstJob[i];
+		int indexSize = sizeof(LZP_BLOCKS)+(sizeof(uint32_t)*(numBlocks+1));
+
+		std::vector<char> packed(indexSize);
+		LZP_BLOCKS* index = (LZP_BLOCKS*)packed.data();
+
+		index->blockSize = blockSize;
+		index->numBlocks = numBlocks;
+
+		for(int j=0; j<numBlocks; j++) {
+
+			LZP_JOB* job = &jobs[firstJob[i]+j];
+
+			index = (LZP_BLOCKS*)packed.data();
+			index->offset[j] = packed.size();
+
+			packed.insert(packed.end(), job->compBuff, job->compBuff+job->compSize);
+			delete[] job->compBuff;
+
+		}
+
+		index = (LZP_BLOCKS*)packed.data();
+		index->offset[numBlocks] = packed.size();
+
+		// Keep each file's index aligned to 4 bytes
+		if (ftell(packp)%4)
+			fseek(packp, 4-(ftell(packp)%4), SEEK_CUR);
+
+		entry[i].crc		= lzCRC32(packed.data(), packed.size(), LZP_CRC32_REMAINDER);
+		entry[i].packedSize	= packed.size();
+		entry[i].offset		= ftell(packp);
+
+		fwrite(packed.data(), packed.size(), 1, packp);
+		delete[] fileBuff[i];
+
+		printf("Ok. (%d block(s), %.02f%%)\n", numBlocks, 100.f*((float)packed.size()/entry[i].fileSize));
+
+		overallSize			+= entry[i].fileSize;
+		overallPackedSize	+= packed.size();
+
+	}
+
+
+    LZP_HEAD head;
+
+    strncpy(head.id, "LZC", sizeof(head.id));
+    head.numFiles = fileList->EntryCount();
+
+	fseek(packp, 0, SEEK_SET);
+	fwrite(&head, sizeof(LZP_HEAD), 1, packp);
+
+    fwrite(entry, sizeof(LZP_FILE), fileList->EntryCount(), packp);
+	WriteHashTable(packp, entry[0].fileName, sizeof(LZP_FILE), fileList->EntryCount());
+
+	fclose(packp);
+	delete[] firstJob;
+	delete[] fileBuff;
 	delete[] entry;
 
     printf("Packed %d file(s) totaling %d bytes (%.02f%% compression ratio).\n",
@@ -255,14 +665,15 @@ int CreateQLPfile(const char* packFile, FileListClass* fileList) {
 
     FILE*		packp;
 	QLP_HEAD	head;
-	QLP_FILE*	fileEntry=new QLP_FILE[fileList->EntryCount()];
+	QLP_FILE*	fileEntry=new QLP_FILE[fileList->EntryCount()]();
 
 	strncpy(head.id, "QLP", 3);
 	head.numFiles = fileList->EntryCount();
 
 	packp = fopen(packFile, "wb");
 
-	fseek(packp, sizeof(QLP_HEAD)+(sizeof(QLP_FILE)*head.numFiles), SEEK_SET);
+	fseek(packp, sizeof(QLP_HEAD)+(sizeof(QLP_FILE)*head.numFiles)+
+		HashTableSize(head.numFiles), SEEK_SET);
 
 	for(int i=0; i<head.numFiles; i++) {
 
@@ -343,6 +754,7 @@ int CreateQLPfile(const char* packFile, FileListClass* fileList) {
 	fwrite(&head, sizeof(QLP_HEAD), 1, packp);
 
 	fwrite(fileEntry, sizeof(QLP_FILE), head.numFiles, packp);
+	WriteHashTable(packp, fileEntry[0].fileName, sizeof(QLP_FILE), head.numFiles);
 
 	fclose(packp);
 	delete[] fileEntry;
@@ -448,6 +860,149 @@ int CreatePCKfile(const char* packFile, FileListClass* fileList) {
 
 }
 
+// Must match CdHashPackName() in psxcd
+unsigned int HashPackName(const char* name) {
+
+	unsigned int hash = 2166136261u;
+
+	for(; *name; name++)
+		hash = (hash^(unsigned char)tolower(*name))*16777619u;
+
+	return(hash);
+
+}
+
+int CreatePCK2file(const char* packFile, FileListClass* fileList, bool compress) {
+
+	int			numEntries = fileList->EntryCount();
+	LZP_JOB*	jobs=new LZP_JOB[numEntries];
+	PCK2_ENTRY*	entry=new PCK2_ENTRY[numEntries];
+	int*		order=new int[numEntries];
+
+	std::vector<char> names;
+
+	// Load all files and build the name table
+	for(int i=0; i<numEntries; i++) {
+
+		const char* name;
+
+		if (fileList->Entry(i)->aliasName == NULL) {
+			name = TrimPathName(fileList->Entry(i)->fileName);
+		} else {
+			name = fileList->Entry(i)->aliasName;
+		}
+
+		entry[i].hash		= HashPackName(name);
+		entry[i].nameOffset	= names.size();
+		names.insert(names.end(), name, name+strlen(name)+1);
+
+		jobs[i].entry		= fileList->Entry(i);
+		jobs[i].data		= LoadFile(fileList->Entry(i)->fileName, &jobs[i].dataSize);
+		jobs[i].compBuff	= NULL;
+
+		order[i] = i;
+
+	}
+
+	if (compress) {
+
+		printf("   Compressing %d file(s) using %d thread(s)...\n",
+			numEntries,
+			std::min(param::NumThreads, numEntries)
+		);
+
+		CompressJobs(jobs, numEntries);
+
+	}
+
+	// Sort entries by hash (keeping the original order for identical hashes)
+	// so that the runtime can use a binary search to find them
+	std::stable_sort(order, order+numEntries, [&](int a, int b) {
+		return(entry[a].hash < entry[b].hash);
+	});
+
+	int tocLength	= sizeof(PCK2_HEAD)+(sizeof(PCK2_ENTRY)*numEntries);
+	int tocSectors	= (tocLength+names.size()+2047)/2048;
+
+	for(int i=0; i<numEntries; i++)
+		entry[i].nameOffset += tocLength;
+
+	tocLength += names.size();
+
+	FILE* packp = fopen(packFile, "wb");
+
+	fseek(packp, tocSectors*2048, SEEK_SET);
+
+	PCK2_ENTRY* sorted=new PCK2_ENTRY[numEntries];
+
+	for(int i=0; i<numEntries; i++) {
+
+		int		index	= order[i];
+		LZP_JOB*	job	= &jobs[index];
+
+		PrintPacking(fileList, index);
+
+		// Only store compressed data if it actually saves space
+		const char*	data	= job->data;
+		int			length	= job->dataSize;
+
+		entry[index].size		= job->dataSize;
+		entry[index].packedSize	= 0;
+
+		if (job->compBuff && (job->compSize < job->dataSize)) {
+			data					= job->compBuff;
+			length					= job->compSize;
+			entry[index].packedSize	= job->compSize;
+		}
+
+		entry[index].offset = ftell(packp)/2048;
+		fwrite(data, 1, length, packp);
+
+		// Pad data to a sector boundary
+		if (ftell(packp)%2048) {
+
+			std::vector<char> padding(2048-(ftell(packp)%2048), 0);
+			fwrite(padding.data(), 1, padding.size(), packp);
+
+		}
+
+		if (entry[index].packedSize)
+			printf("Ok. (%.02f%%)\n", 100.f*((float)length/job->dataSize));
+		else
+			printf("Done.\n");
+
+		sorted[i] = entry[index];
+
+		delete[] job->compBuff;
+		delete[] job->data;
+
+	}
+
+	printf("Packed %d file(s) totaling %d bytes.\n", numEntries, (int)ftell(packp));
+
+	PCK2_HEAD head;
+
+	memcpy(head.magic, "PCK2", 4);
+	head.numEntries	= numEntries;
+	head.tocLength	= tocLength;
+	head.reserved	= 0;
+
+	fseek(packp, 0, SEEK_SET);
+	fwrite(&head, sizeof(PCK2_HEAD), 1, packp);
+	fwrite(sorted, sizeof(PCK2_ENTRY), numEntries, packp);
+	fwrite(names.data(), 1, names.size(), packp);
+
+	fclose(packp);
+
+	delete[] sorted;
+	delete[] order;
+	delete[] entry;
+	delete[] jobs;
+
+	return(true);
+
+}
+
 int ParseCreateElement(tinyxml2::XMLElement* element) {
 
 
@@ -482,6 +1037,10 @@ int ParseCreateElement(tinyxml2::XMLElement* element) {
 			packFormat = 1;
 		} else if (strcmp("pck", packType) == 0) {
 			packFormat = 2;
+		} else if (strcmp("lzc", packType) == 0) {
+			packFormat = 3;
+		} else if (strcmp("pck2", packType) == 0) {
+			packFormat = 4;
 		} else {
 
 			printf("ERROR: Unknown pack format: %s\n", packType);
@@ -512,6 +1071,16 @@ int ParseCreateElement(tinyxml2::XMLElement* element) {
 		printf("PCK");
 		break;
 
+	case 3:
+
+		printf("LZC");
+		break;
+
+	case 4:
+
+		printf("PCK v2");
+		break;
+
 	}
 	printf(" format...\n");
 
@@ -572,9 +1141,27 @@ int ParseCreateElement(tinyxml2::XMLElement* element) {
 		return(true);
 	}
 
+	// Preset dictionary shared by all files (LZP archives only)
+	const char* dictFile = element->Attribute("dictionary");
+
+	if (dictFile != NULL) {
+
+		FILE* fp = fopen(dictFile, "rb");
+
+		if (!fp) {
+			printf("ERROR: Dictionary file '%s' either does not exist or it cannot be opened.\n", dictFile);
+			return(false);
+		}
+		fclose(fp);
+
+		if (packFormat != 0)
+			printf("WARNING: Dictionaries are only supported by the LZP format, ignoring.\n");
+
+	}
+
 	switch(packFormat) {
 	case 0:	// Create LZP
-		CreateLZPfile(packName, &fileList);
+		CreateLZPfile(packName, &fileList, dictFile);
 		break;
 	case 1:	// Create QLP
 		CreateQLPfile(packName, &fileList);
@@ -582,6 +1169,21 @@ int ParseCreateElement(tinyxml2::XMLElement* element) {
 	case 2:	// Create PCK
 		CreatePCKfile(packName, &fileList);
 		break;
+	case 3:	// Create chunked LZP
+		{
+			int blockSize = element->IntAttribute("blocksize", 16384);
+
+			if (blockSize <= 0) {
+				printf("ERROR: Invalid block size: %d\n", blockSize);
+				return(false);
+			}
+
+			CreateLZCfile(packName, &fileList, blockSize);
+		}
+		break;
+	case 4:	// Create PCK v2
+		CreatePCK2file(packName, &fileList, element->BoolAttribute("compress", false));
+		break;
 	}
 
 
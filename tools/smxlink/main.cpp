@@ -9,9 +9,13 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
 #include <tinyxml2.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
 //#include <windef.h>
 #include "timreader.h"
 
@@ -19,7 +23,9 @@
 #define strcasecmp _stricmp
 #endif
 
-#define VERSION "0.25b"
+#define VERSION "0.26b"
+
+#define MAX_LODS	4
 
 namespace param
 {
@@ -28,8 +34,19 @@ namespace param
 	std::string texDir;
 
 	float	scaleFactor = 1.f;
+	bool	lodOutput = false;
+	bool	groupPrims = false;
+	bool	reorder = false;
+	bool	mergeQuads = false;
 }
 
+typedef struct {
+	std::string	fileName;
+	int			minSize;
+} LOD_ENTRY;
+
+typedef std::vector<LOD_ENTRY> MESH_ENTRY;
+
 typedef struct {
 	char			id[3];		// File ID (SMD)
 	unsigned char	version;	// Version number (0x01)
@@ -37,15 +54,73 @@ typedef struct {
 	unsigned short	numverts;
 	unsigned short	numnorms;
 	unsigned short	numprims;
-	unsigned long	vtxAddr;
-	unsigned long	nrmAddr;
-	unsigned long	priAddr;
+	uint32_t		vtxAddr;
+	uint32_t		nrmAddr;
+	uint32_t		priAddr;
 } SMD_HEADER;
 
 typedef struct {
 	short vx,vy,vz,vp;
 } SVECTOR;
 
+// Extended (SML) format, holding one or more meshes each with a bounding
+// sphere and up to MAX_LODS levels of detail. Each LOD is a regular SMD.
+typedef struct {
+	char			id[3];		// File ID (SML)
+	unsigned char	version;	// Version number (0x01)
+	unsigned short	flags;
+	unsigned short	numMeshes;
+} SML_HEADER;
+
+typedef struct {
+	unsigned short	minSize;	// Minimum projected radius in pixels
+	unsigned short	reserved;
+	uint32_t		smdAddr;
+} SML_LOD;
+
+typedef struct {
+	SVECTOR			bound;		// Bounding sphere center, radius in vp
+	unsigned short	numLods;
+	unsigned short	reserved;
+	SML_LOD			lods[MAX_LODS];
+} SML_MESH;
+
+
+// Skinned SMD data, written right after the SMD header if flag 0x4 is set.
+// Vertices and normals are sorted by bone and vertices are relative to the
+// origin of their bone.
+typedef struct {
+	unsigned short	numBones;
+	unsigned short	numAnims;
+	uint32_t		boneAddr;
+	uint32_t		animAddr;
+	uint32_t		reserved;	// Filled in at runtime
+} SMD_SKIN_HEADER;
+
+typedef struct {
+	short			parent;		// Parent bone index, -1 if none
+	unsigned short	firstVert;
+	unsigned short	numVerts;
+	unsigned short	firstNorm;
+	unsigned short	numNorms;
+	unsigned short	reserved;
+	SVECTOR			origin;		// Relative to parent bone origin
+} SMD_BONE;
+
+typedef struct {
+	SVECTOR			rot;		// Rotation angles (4096 = 360 degrees)
+	SVECTOR			pos;		// Offset from bone origin
+} SMD_POSE;
+
+typedef struct {
+	unsigned short	numKeys;
+	unsigned short	flags;		// Bit 0: looping animation
+	uint32_t		frameAddr;	// Frame number of each key (16-bit)
+	uint32_t		poseAddr;	// numBones poses for each key
+} SMD_ANIM;
+
+#define SMD_FLAG_SKINNED	0x4
+
 
 #define PRIM_TYPE_LINE	0
 #define PRIM_TYPE_TRI	1
@@ -78,93 +153,865 @@ typedef struct {
 	unsigned short	v0,v1,v2,v3;
 } PRIM_V;
 
+typedef std::vector<unsigned char> PRIM_DATA;
+
+// Group markers are dummy primitives with bit 5 of the reserved field set and
+// the number of primitives following them in v3. They are type 0 so renderers
+// other than smdSortModelGrouped() discard them, although some only do so
+// after transforming their (zero) vertex indices. They are not counted in the
+// header's primitive count and are skipped by ReadSMD().
+#define PRIM_GROUP_MARKER	0x20
+#define PRIM_CLASS_MASK		0x3f	// Type, lighting, coloring and texture bits
+#define MAX_GROUP_SIZE		65535
+
 typedef struct {
 	unsigned char	r,g,b,c;
 } PRIM_RGBC;
 
-typedef struct {
-	unsigned short tpage,clut;
-} PRIM_TC;
+typedef struct {
+	unsigned short tpage,clut;
+} PRIM_TC;
+
+typedef struct {
+	unsigned char	u,v;
+} PRIM_UV;
+
+
+// Unpacked primitive, used when merging primitives and remapping indices.
+// Fields not used by a primitive (e.g. the fourth vertex of a triangle) are
+// left zeroed.
+typedef struct {
+	PRIM_ID			id;
+	unsigned short	v[4];
+	unsigned short	n[4];
+	PRIM_RGBC		c[4];
+	PRIM_UV			uv[4];
+	PRIM_TC			tc;
+} PRIM_INFO;
+
+// Triangles whose face normals are further apart than this are not merged
+// into quads, as only the first triangle of a quad is tested for culling.
+#define MERGE_MIN_COS	0.999
+
+
+static int NumPrimVerts(const PRIM_ID& id) {
+
+	return (id.type == PRIM_TYPE_QUAD) ? 4 : 3;
+
+}
+
+static void UnpackPrim(const PRIM_DATA& data, PRIM_INFO* info) {
+
+	const unsigned char* ptr = data.data();
+
+	memset(info, 0, sizeof(PRIM_INFO));
+
+	memcpy(&info->id, ptr, sizeof(PRIM_ID));
+	ptr += sizeof(PRIM_ID);
+
+	memcpy(info->v, ptr, 8);
+	ptr += 8;
+
+	if (info->id.l_type == PRIM_LIGHTING_FLAT) {
+		memcpy(info->n, ptr, 2);
+		ptr += 4;
+	} else if (info->id.l_type == PRIM_LIGHTING_SMOOTH) {
+		memcpy(info->n, ptr, 8);
+		ptr += 8;
+	}
+
+	int numColors = info->id.c_type ? NumPrimVerts(info->id) : 1;
+
+	memcpy(info->c, ptr, 4*numColors);
+	ptr += 4*numColors;
+
+	if (info->id.texture) {
+		memcpy(info->uv, ptr, 8);
+		memcpy(&info->tc, ptr+8, 4);
+	}
+
+}
+
+static void PackPrim(const PRIM_INFO* info, PRIM_DATA& data) {
+
+	PRIM_ID id = info->id;
+	int numColors = id.c_type ? NumPrimVerts(id) : 1;
+
+	id.len = sizeof(PRIM_ID)+8+(4*numColors);
+
+	if (id.l_type == PRIM_LIGHTING_FLAT)
+		id.len += 4;
+	else if (id.l_type == PRIM_LIGHTING_SMOOTH)
+		id.len += 8;
+
+	if (id.texture)
+		id.len += 12;
+
+	data.assign(id.len, 0);
+
+	unsigned char* ptr = data.data();
+
+	memcpy(ptr, &id, sizeof(PRIM_ID));
+	ptr += sizeof(PRIM_ID);
+
+	memcpy(ptr, info->v, 8);
+	ptr += 8;
+
+	if (id.l_type == PRIM_LIGHTING_FLAT) {
+		memcpy(ptr, info->n, 2);
+		ptr += 4;
+	} else if (id.l_type == PRIM_LIGHTING_SMOOTH) {
+		memcpy(ptr, info->n, 8);
+		ptr += 8;
+	}
+
+	memcpy(ptr, info->c, 4*numColors);
+	ptr += 4*numColors;
+
+	if (id.texture) {
+		memcpy(ptr, info->uv, 8);
+		memcpy(ptr+8, &info->tc, 4);
+	}
+
+}
+
+// Rotates the vertices of a triangle (along with their attributes) so that
+// vertex r becomes the first one, which keeps the winding order. The code
+// byte always stays with the first color.
+static PRIM_INFO RotateTri(const PRIM_INFO& tri, int r) {
+
+	PRIM_INFO out = tri;
+
+	for(int i=0; i<3; i++) {
+
+		int j = (i+r)%3;
+
+		out.v[i]	= tri.v[j];
+		out.uv[i]	= tri.uv[j];
+
+		if (tri.id.l_type == PRIM_LIGHTING_SMOOTH)
+			out.n[i] = tri.n[j];
+
+		if (tri.id.c_type) {
+			out.c[i]	= tri.c[j];
+			out.c[i].c	= 0;
+		}
+
+	}
+
+	out.c[0].c = tri.c[0].c;
+
+	return out;
+
+}
+
+static bool SameRGB(const PRIM_RGBC& a, const PRIM_RGBC& b) {
+
+	return (a.r == b.r) && (a.g == b.g) && (a.b == b.b);
+
+}
+
+static bool SameUV(const PRIM_UV& a, const PRIM_UV& b) {
+
+	return (a.u == b.u) && (a.v == b.v);
+
+}
+
+static bool FaceNormal(const PRIM_INFO& tri, const std::vector<SVECTOR>& vertices, double* n) {
+
+	for(int i=0; i<3; i++) {
+		if (tri.v[i] >= vertices.size())
+			return false;
+	}
+
+	const SVECTOR& p0 = vertices[tri.v[0]];
+	const SVECTOR& p1 = vertices[tri.v[1]];
+	const SVECTOR& p2 = vertices[tri.v[2]];
+
+	double e0[3] = { (double)p1.vx-p0.vx, (double)p1.vy-p0.vy, (double)p1.vz-p0.vz };
+	double e1[3] = { (double)p2.vx-p0.vx, (double)p2.vy-p0.vy, (double)p2.vz-p0.vz };
+
+	n[0] = e0[1]*e1[2]-e0[2]*e1[1];
+	n[1] = e0[2]*e1[0]-e0[0]*e1[2];
+	n[2] = e0[0]*e1[1]-e0[1]*e1[0];
+
+	double len = sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+
+	if (len == 0)
+		return false;
+
+	n[0] /= len;
+	n[1] /= len;
+	n[2] /= len;
+
+	return true;
+
+}
+
+// Checks whether triangles a (v0, v1, v2) and b (v2, v1, s) can be drawn as
+// quad (v0, v1, v2, s) without changing their appearance. The GPU splits such
+// a quad into the exact same two triangles, so all that matters is that they
+// share all attributes along the common edge and face the same direction.
+static bool CanMergeTris(const PRIM_INFO& a, const PRIM_INFO& b, const std::vector<SVECTOR>& vertices) {
+
+	if (memcmp(&a.id, &b.id, sizeof(PRIM_ID)))
+		return false;
+	if (a.v[0] == b.v[2])
+		return false;
+
+	if ((a.id.l_type == PRIM_LIGHTING_FLAT) && (a.n[0] != b.n[0]))
+		return false;
+	if ((a.id.l_type == PRIM_LIGHTING_SMOOTH) &&
+		((a.n[1] != b.n[1]) || (a.n[2] != b.n[0])))
+		return false;
+
+	if (a.c[0].c != b.c[0].c)
+		return false;
+
+	if (a.id.c_type) {
+		if (!SameRGB(a.c[1], b.c[1]) || !SameRGB(a.c[2], b.c[0]))
+			return false;
+	} else if (!SameRGB(a.c[0], b.c[0])) {
+		return false;
+	}
+
+	if (a.id.texture) {
+		if ((a.tc.tpage != b.tc.tpage) || (a.tc.clut != b.tc.clut))
+			return false;
+		if (!SameUV(a.uv[1], b.uv[1]) || !SameUV(a.uv[2], b.uv[0]))
+			return false;
+	}
+
+	// Double sided primitives are never culled, so they don't have to be
+	// coplanar
+	if (a.id.nocull)
+		return true;
+
+	double na[3], nb[3];
+
+	if (!FaceNormal(a, vertices, na) || !FaceNormal(b, vertices, nb))
+		return false;
+
+	// Triangles bound to different bones of a skinned model (bone indices are
+	// kept in vp while converting) may not stay coplanar once animated
+	for(int i=1; i<3; i++) {
+		if (vertices[a.v[i]].vp != vertices[a.v[0]].vp)
+			return false;
+	}
+
+	if (vertices[b.v[2]].vp != vertices[a.v[0]].vp)
+		return false;
+
+	return (na[0]*nb[0]+na[1]*nb[1]+na[2]*nb[2]) >= MERGE_MIN_COS;
+
+}
+
+// Merges pairs of adjacent triangles into quads where possible, replacing the
+// first triangle of each pair with the quad and removing the second one.
+// Returns the number of pairs merged.
+static int MergeTriangles(std::vector<PRIM_DATA>& prims, const std::vector<SVECTOR>& vertices) {
+
+	std::vector<PRIM_INFO> info(prims.size());
+	std::vector<bool> removed(prims.size(), false);
+	std::map<std::pair<int,int>, std::vector<size_t>> edges;
+	int merged = 0;
+
+	for(size_t i=0; i<prims.size(); i++) {
+
+		UnpackPrim(prims[i], &info[i]);
+
+		if (info[i].id.type != PRIM_TYPE_TRI)
+			continue;
+
+		for(int j=0; j<3; j++) {
+			int a = info[i].v[j];
+			int b = info[i].v[(j+1)%3];
+			edges[std::minmax(a, b)].push_back(i);
+		}
+
+	}
+
+	for(size_t i=0; i<prims.size(); i++) {
+
+		if ((info[i].id.type != PRIM_TYPE_TRI) || removed[i])
+			continue;
+
+		for(int r=0; r<3; r++) {
+
+			PRIM_INFO a = RotateTri(info[i], r);
+			bool found = false;
+
+			for(size_t j : edges[std::minmax((int)a.v[1], (int)a.v[2])]) {
+
+				if ((j == i) || removed[j] || (info[j].id.type != PRIM_TYPE_TRI))
+					continue;
+
+				// Find the rotation of the other triangle that starts with the
+				// shared edge in reverse order
+				int rb;
+
+				for(rb=0; rb<3; rb++) {
+					if ((info[j].v[rb] == a.v[2]) && (info[j].v[(rb+1)%3] == a.v[1]))
+						break;
+				}
+
+				if (rb == 3)
+					continue;
+
+				PRIM_INFO b = RotateTri(info[j], rb);
+
+				if (!CanMergeTris(a, b, vertices))
+					continue;
+
+				a.id.type	= PRIM_TYPE_QUAD;
+				a.v[3]		= b.v[2];
+				a.n[3]		= (a.id.l_type == PRIM_LIGHTING_SMOOTH) ? b.n[2] : 0;
+				a.uv[3]		= b.uv[2];
+
+				if (a.id.c_type) {
+					a.c[3]		= b.c[2];
+					a.c[3].c	= 0;
+				}
+
+				info[i] = a;
+				PackPrim(&info[i], prims[i]);
+
+				removed[j] = true;
+				found = true;
+				merged++;
+				break;
+
+			}
+
+			if (found)
+				break;
+
+		}
+
+	}
+
+	size_t count = 0;
+
+	for(size_t i=0; i<prims.size(); i++) {
+
+		if (removed[i])
+			continue;
+
+		if (count != i)
+			prims[count] = std::move(prims[i]);
+
+		count++;
+
+	}
+
+	prims.resize(count);
+
+	return merged;
+
+}
+
+// Returns the key primitives are sorted by: class first, then texture page
+// (or blend mode for untextured primitives) to minimize state changes.
+static int PrimSortKey(const PRIM_DATA& prim) {
+
+	const PRIM_ID* id = (const PRIM_ID*)prim.data();
+	int key = (prim[0]&PRIM_CLASS_MASK)<<16;
+
+	if (id->texture) {
+		unsigned short tpage;
+		memcpy(&tpage, prim.data()+prim.size()-sizeof(PRIM_TC), 2);
+		key |= tpage;
+	} else {
+		key |= id->blend;
+	}
+
+	return key;
+
+}
+
+static void SortPrimitives(std::vector<PRIM_DATA>& prims) {
+
+	std::stable_sort(prims.begin(), prims.end(),
+		[](const PRIM_DATA& a, const PRIM_DATA& b) {
+			return PrimSortKey(a) < PrimSortKey(b);
+		}
+	);
+
+}
+
+// Replaces the vertex and normal indices of all primitives using the given
+// tables, which map old indices to new ones.
+static void RemapIndices(std::vector<PRIM_DATA>& prims,
+	const std::vector<int>& vtxMap, const std::vector<int>& nrmMap) {
+
+	for(PRIM_DATA& prim : prims) {
+
+		PRIM_INFO info;
+
+		UnpackPrim(prim, &info);
+
+		int numVerts = NumPrimVerts(info.id);
+
+		for(int j=0; j<numVerts; j++)
+			info.v[j] = vtxMap[info.v[j]];
+
+		if (info.id.l_type == PRIM_LIGHTING_FLAT) {
+			info.n[0] = nrmMap[info.n[0]];
+		} else if (info.id.l_type == PRIM_LIGHTING_SMOOTH) {
+			for(int j=0; j<numVerts; j++)
+				info.n[j] = nrmMap[info.n[j]];
+		}
+
+		PackPrim(&info, prim);
+
+	}
+
+}
+
+// Renumbers vertices and normals in the order primitives first use them, so
+// that consecutive primitives fetch nearby vertices. Vertices and normals not
+// used by any primitive are moved to the end.
+static bool ReorderVertices(std::vector<PRIM_DATA>& prims,
+	std::vector<SVECTOR>& vertices, std::vector<SVECTOR>& normals) {
+
+	std::vector<PRIM_INFO> info(prims.size());
+	std::vector<int> vtxMap(vertices.size(), -1);
+	std::vector<int> nrmMap(normals.size(), -1);
+	std::vector<SVECTOR> newVertices, newNormals;
+
+	for(size_t i=0; i<prims.size(); i++) {
+
+		UnpackPrim(prims[i], &info[i]);
+
+		int numVerts = NumPrimVerts(info[i].id);
+		int numNorms = 0;
+
+		if (info[i].id.l_type == PRIM_LIGHTING_FLAT)
+			numNorms = 1;
+		else if (info[i].id.l_type == PRIM_LIGHTING_SMOOTH)
+			numNorms = numVerts;
+
+		for(int j=0; j<numVerts; j++) {
+
+			if (info[i].v[j] >= vertices.size())
+				return false;
+
+			if (vtxMap[info[i].v[j]] < 0) {
+				vtxMap[info[i].v[j]] = newVertices.size();
+				newVertices.push_back(vertices[info[i].v[j]]);
+			}
+
+		}
+
+		for(int j=0; j<numNorms; j++) {
+
+			if (info[i].n[j] >= normals.size())
+				return false;
+
+			if (nrmMap[info[i].n[j]] < 0) {
+				nrmMap[info[i].n[j]] = newNormals.size();
+				newNormals.push_back(normals[info[i].n[j]]);
+			}
+
+		}
+
+	}
+
+	for(size_t i=0; i<vertices.size(); i++) {
+		if (vtxMap[i] < 0) {
+			vtxMap[i] = newVertices.size();
+			newVertices.push_back(vertices[i]);
+		}
+	}
+
+	for(size_t i=0; i<normals.size(); i++) {
+		if (nrmMap[i] < 0) {
+			nrmMap[i] = newNormals.size();
+			newNormals.push_back(normals[i]);
+		}
+	}
+
+	RemapIndices(prims, vtxMap, nrmMap);
+
+	vertices.swap(newVertices);
+	normals.swap(newNormals);
+
+	return true;
+
+}
+
+// Sorts vertices and normals by the bone they are bound to (kept in vp while
+// converting) and sets the vertex and normal ranges of each bone. Normals are
+// bound to the bone of the vertex they are first used with. Vertices are made
+// relative to the origin of their bone.
+static bool GroupByBone(std::vector<PRIM_DATA>& prims, std::vector<SVECTOR>& vertices,
+	std::vector<SVECTOR>& normals, std::vector<SMD_BONE>& bones,
+	const std::vector<SVECTOR>& boneOrigins) {
+
+	std::vector<bool> nrmBound(normals.size(), false);
+
+	for(SVECTOR& n : normals)
+		n.vp = 0;
+
+	for(const PRIM_DATA& prim : prims) {
+
+		PRIM_INFO info;
+
+		UnpackPrim(prim, &info);
+
+		int numVerts = NumPrimVerts(info.id);
+
+		for(int j=0; j<numVerts; j++) {
+			if (info.v[j] >= vertices.size())
+				return false;
+		}
+
+		if (info.id.l_type == PRIM_LIGHTING_NONE)
+			continue;
+
+		int numNorms = (info.id.l_type == PRIM_LIGHTING_FLAT) ? 1 : numVerts;
+
+		for(int j=0; j<numNorms; j++) {
+
+			if (info.n[j] >= normals.size())
+				return false;
+
+			if (!nrmBound[info.n[j]]) {
+				normals[info.n[j]].vp = vertices[info.v[j]].vp;
+				nrmBound[info.n[j]] = true;
+			}
+
+		}
+
+	}
+
+	std::vector<int> vtxMap(vertices.size()), nrmMap(normals.size());
+	std::vector<SVECTOR> newVertices, newNormals;
+
+	for(size_t b=0; b<bones.size(); b++) {
+
+		bones[b].firstVert = newVertices.size();
+		bones[b].firstNorm = newNormals.size();
+
+		for(size_t i=0; i<vertices.size(); i++) {
+
+			if (vertices[i].vp != (short)b)
+				continue;
+
+			SVECTOR v = vertices[i];
+
+			v.vx -= boneOrigins[b].vx;
+			v.vy -= boneOrigins[b].vy;
+			v.vz -= boneOrigins[b].vz;
+			v.vp = 0;
+
+			vtxMap[i] = newVertices.size();
+			newVertices.push_back(v);
+
+		}
+
+		for(size_t i=0; i<normals.size(); i++) {
+
+			if (normals[i].vp != (short)b)
+				continue;
+
+			nrmMap[i] = newNormals.size();
+			newNormals.push_back(normals[i]);
+			newNormals.back().vp = 0;
+
+		}
+
+		bones[b].numVerts = newVertices.size()-bones[b].firstVert;
+		bones[b].numNorms = newNormals.size()-bones[b].firstNorm;
+
+	}
+
+	RemapIndices(prims, vtxMap, nrmMap);
+
+	vertices.swap(newVertices);
+	normals.swap(newNormals);
+
+	return true;
+
+}
+
+// Writes converted primitives followed by the terminator and returns the number
+// of primitives written, not counting group markers. If grouping is enabled, primitives must have been
+// sorted by SortPrimitives() beforehand and each group of primitives of the
+// same class is preceded by a group marker, so renderers can process a group
+// without checking the class of each primitive.
+static int WritePrimitives(std::vector<PRIM_DATA>& prims, FILE* smdFile) {
+
+	int count = 0;
+
+	for(size_t i=0; i<prims.size();) {
+
+		size_t groupLen = 1;
+
+		if (param::groupPrims) {
+
+			while(((i+groupLen) < prims.size()) && (groupLen < MAX_GROUP_SIZE) &&
+				((prims[i+groupLen][0]&PRIM_CLASS_MASK) == (prims[i][0]&PRIM_CLASS_MASK)))
+				groupLen++;
+
+			PRIM_ID marker;
+			PRIM_V markerData;
+
+			memset(&marker, 0, sizeof(PRIM_ID));
+			memset(&markerData, 0, sizeof(PRIM_V));
+
+			marker.reserved	= PRIM_GROUP_MARKER;
+			marker.len		= sizeof(PRIM_ID)+sizeof(PRIM_V);
+			markerData.v3	= groupLen;
+
+			fwrite(&marker, sizeof(PRIM_ID), 1, smdFile);
+			fwrite(&markerData, sizeof(PRIM_V), 1, smdFile);
+
+		}
+
+		for(size_t j=0; j<groupLen; j++) {
+			fwrite(prims[i+j].data(), 1, prims[i+j].size(), smdFile);
+			count++;
+		}
+
+		i += groupLen;
+
+	}
+
+	int term = 0;
+	fwrite(&term, 1, 4, smdFile);
+
+	return count;
+
+}
+
+// Parses the optional <bones> element of an SMX file, which makes the model
+// skinned. Each <bone> has a parent index (-1 for none, otherwise lower than
+// its own index) and an origin in model space. Vertices are bound to a bone
+// using their bone attribute (default 0).
+static bool ParseBones(tinyxml2::XMLElement* smxModel, std::vector<SMD_BONE>& bones,
+	std::vector<SVECTOR>& boneOrigins) {
+
+	tinyxml2::XMLElement* smxBone = smxModel->FirstChildElement("bones");
+
+	if (smxBone == NULL)
+		return true;
+
+	smxBone = smxBone->FirstChildElement("bone");
+
+	while(smxBone != NULL) {
+
+		SMD_BONE bone;
+		SVECTOR origin;
+
+		memset(&bone, 0, sizeof(SMD_BONE));
+
+		bone.parent = smxBone->IntAttribute("parent", -1);
+
+		if (bone.parent >= (int)bones.size()) {
+			printf("ERROR: Bone %d has a parent that is not defined before it.\n",
+				(int)bones.size());
+			return false;
+		}
+
+		origin.vx = round(param::scaleFactor * smxBone->FloatAttribute("x"));
+		origin.vy = round(param::scaleFactor * smxBone->FloatAttribute("y"));
+		origin.vz = round(param::scaleFactor * smxBone->FloatAttribute("z"));
+		origin.vp = 0;
+
+		bone.origin = origin;
+
+		if (bone.parent >= 0) {
+			bone.origin.vx -= boneOrigins[bone.parent].vx;
+			bone.origin.vy -= boneOrigins[bone.parent].vy;
+			bone.origin.vz -= boneOrigins[bone.parent].vz;
+		}
+
+		bones.push_back(bone);
+		boneOrigins.push_back(origin);
+
+		smxBone = smxBone->NextSiblingElement("bone");
+
+	}
+
+	return true;
+
+}
+
+// Writes the skeleton and the animations in the optional <animations> element
+// of an SMX file, filling in the addresses in skinHeader. Each <animation>
+// contains <key> elements with increasing frame numbers, each holding one
+// <bone> element per bone with rotation angles in degrees (rx, ry, rz) and an
+// offset from the bone origin (x, y, z). Bones without an element in a key are
+// left in their rest pose.
+static bool WriteSkin(tinyxml2::XMLElement* smxModel, const std::vector<SMD_BONE>& bones,
+	SMD_SKIN_HEADER* skinHeader, FILE* smdFile, long base) {
+
+	std::vector<SMD_ANIM> anims;
+	std::vector<std::vector<unsigned short>> frames;
+	std::vector<std::vector<SMD_POSE>> poses;
+
+	tinyxml2::XMLElement* smxAnim = smxModel->FirstChildElement("animations");
+
+	if (smxAnim != NULL)
+		smxAnim = smxAnim->FirstChildElement("animation");
+
+	while(smxAnim != NULL) {
+
+		SMD_ANIM anim;
+
+		memset(&anim, 0, sizeof(SMD_ANIM));
+
+		if (smxAnim->IntAttribute("loop"))
+			anim.flags |= 0x1;
+
+		frames.emplace_back();
+		poses.emplace_back();
+
+		tinyxml2::XMLElement* smxKey = smxAnim->FirstChildElement("key");
+
+		while(smxKey != NULL) {
+
+			int frame = smxKey->IntAttribute("frame");
+
+			if ((frame < 0) || (frame > 65535) ||
+				(!frames.back().empty() && (frame <= frames.back().back()))) {
+				printf("ERROR: Animation %d has keys out of order.\n",
+					(int)anims.size());
+				return false;
+			}
+
+			frames.back().push_back(frame);
+
+			size_t first = poses.back().size();
+			poses.back().resize(first+bones.size());
+			memset(&poses.back()[first], 0, sizeof(SMD_POSE)*bones.size());
+
+			tinyxml2::XMLElement* smxPose = smxKey->FirstChildElement("bone");
+
+			for(size_t i=0; (i<bones.size()) && (smxPose != NULL); i++) {
+
+				SMD_POSE& pose = poses.back()[first+i];
+
+				pose.rot.vx = round(smxPose->FloatAttribute("rx")*4096.0/360.0);
+				pose.rot.vy = round(smxPose->FloatAttribute("ry")*4096.0/360.0);
+				pose.rot.vz = round(smxPose->FloatAttribute("rz")*4096.0/360.0);
+				pose.pos.vx = round(param::scaleFactor * smxPose->FloatAttribute("x"));
+				pose.pos.vy = round(param::scaleFactor * smxPose->FloatAttribute("y"));
+				pose.pos.vz = round(param::scaleFactor * smxPose->FloatAttribute("z"));
+
+				smxPose = smxPose->NextSiblingElement("bone");
+
+			}
+
+			smxKey = smxKey->NextSiblingElement("key");
+
+		}
+
+		if (frames.back().empty()) {
+			printf("ERROR: Animation %d has no keys.\n", (int)anims.size());
+			return false;
+		}
+
+		anim.numKeys = frames.back().size();
+		anims.push_back(anim);
 
-typedef struct {
-	unsigned char	u,v;
-} PRIM_UV;
+		smxAnim = smxAnim->NextSiblingElement("animation");
 
+	}
 
-int main(int argc, const char* argv[]) {
+	skinHeader->numBones = bones.size();
+	skinHeader->numAnims = anims.size();
 
-	printf("SMXLINK " VERSION " - Scarlet SMX to SMD Model Converter "
-		"(part of Scarlet Engine)\n");
-	printf("Note: Outputs in *NEW* revision 1 format!\n");
-	printf("2017-2019 Meido-Tek Productions\n\n");
+	skinHeader->boneAddr = ftell(smdFile)-base;
+	fwrite(bones.data(), sizeof(SMD_BONE), bones.size(), smdFile);
 
-	if (argc <= 1) {
+	// Animation headers are followed by the frame numbers (padded to a
+	// multiple of 4 bytes) and poses of each animation
+	skinHeader->animAddr = ftell(smdFile)-base;
 
-		printf("Parameters:\n");
-		printf("   smxlink [-o <filename>] [-s <scale>] <smxfile>\n\n");
-		printf("   -o  <filename> - Specify output filename (default: first file specified)\n");
-		printf("   -s  <scale>    - Scale factor to apply to model on conversion (default: 1.0)\n");
-		printf("   -tp <path>     - Specify directory path to TIM texture files\n");
-		printf("   <smxfile>	  - SMX file to convert to SMD\n");
+	uint32_t addr = skinHeader->animAddr+(sizeof(SMD_ANIM)*anims.size());
 
-		return EXIT_SUCCESS;
+	for(size_t i=0; i<anims.size(); i++) {
+
+		anims[i].frameAddr = addr;
+		addr += (anims[i].numKeys*2+3)&~3;
+		anims[i].poseAddr = addr;
+		addr += sizeof(SMD_POSE)*poses[i].size();
 
 	}
 
-	for(int i=1; i<argc; i++) {
+	fwrite(anims.data(), sizeof(SMD_ANIM), anims.size(), smdFile);
 
-		if (strcasecmp(argv[i], "-o") == 0) {
+	for(size_t i=0; i<anims.size(); i++) {
 
-			i++;
-			param::smdFileName = argv[i];
+		if (frames[i].size()&1)
+			frames[i].push_back(0);
 
-		} else if (strcasecmp(argv[i], "-s") == 0) {
+		fwrite(frames[i].data(), 2, frames[i].size(), smdFile);
+		fwrite(poses[i].data(), sizeof(SMD_POSE), poses[i].size(), smdFile);
 
-			i++;
-			param::scaleFactor = atof(argv[i]);
+	}
 
-		} else if (strcasecmp(argv[i], "-tp") == 0) {
+	return true;
 
-			i++;
-			param::texDir = argv[i];
+}
 
-			if( ( param::texDir[param::texDir.size()-1] != '\\' ) &&
-				( param::texDir[param::texDir.size()-1] != '/') ) {
-				
-				param::texDir += "/";
-				
-			}
-			
-		} else {
+// Computes a bounding sphere for the given vertices. The center is the middle
+// of their bounding box, which is not the smallest possible sphere but is good
+// enough for culling and LOD selection.
+static void CalcBound(const std::vector<SVECTOR>& vertices, SVECTOR* bound) {
+
+	int minv[3] = { 32767, 32767, 32767 };
+	int maxv[3] = { -32768, -32768, -32768 };
+	double radius = 0;
 
-			param::smxFileName = argv[i];
+	memset(bound, 0, sizeof(SVECTOR));
 
+	if (vertices.empty())
+		return;
+
+	for(const SVECTOR& v : vertices) {
+
+		const short c[3] = { v.vx, v.vy, v.vz };
+
+		for(int i=0; i<3; i++) {
+			minv[i] = std::min(minv[i], (int)c[i]);
+			maxv[i] = std::max(maxv[i], (int)c[i]);
 		}
 
 	}
 
-	if (param::smdFileName.empty()) {
+	bound->vx = (minv[0]+maxv[0])/2;
+	bound->vy = (minv[1]+maxv[1])/2;
+	bound->vz = (minv[2]+maxv[2])/2;
 
-        param::smdFileName = param::smxFileName;
-        param::smdFileName.erase(param::smdFileName.rfind("."));
-        param::smdFileName += ".smd";
+	for(const SVECTOR& v : vertices) {
+
+		double dx = v.vx-bound->vx;
+		double dy = v.vy-bound->vy;
+		double dz = v.vz-bound->vz;
+
+		radius = std::max(radius, sqrt(dx*dx+dy*dy+dz*dz));
 
 	}
 
-	printf("Input  : %s\n", param::smxFileName.c_str());
-	printf("Output : %s\n", param::smdFileName.c_str());
+	bound->vp = (short)std::min(ceil(radius), 32767.0);
 
-	if (!param::texDir.empty())
-		printf("TexDir : %s\n", param::texDir.c_str());
+}
 
-	printf("\n");
+// Converts an SMX file and writes it as SMD data at the current position of
+// smdFile. Addresses in the SMD header are relative to the beginning of the
+// SMD data, so it can be embedded into other files (see WriteSML()). If bound
+// is not NULL, the bounding sphere of the model is stored in it.
+static bool ConvertSMX(const char* smxFileName, FILE* smdFile, SVECTOR* bound) {
 
     tinyxml2::XMLDocument smxFile;
 
-    if (smxFile.LoadFile(param::smxFileName.c_str()) != tinyxml2::XML_SUCCESS) {
+    if (smxFile.LoadFile(smxFileName) != tinyxml2::XML_SUCCESS) {
 		printf("ERROR: Unable to load SMX file:\n");
 		smxFile.PrintError();
-		return EXIT_FAILURE;
+		return false;
     }
 
     tinyxml2::XMLElement* smxModel = smxFile.FirstChildElement("model");
@@ -200,7 +1047,7 @@ int main(int argc, const char* argv[]) {
                 if (!GetTimCoords(timFileName.c_str(), &texCoords[index])) {
                     printf("ERROR: Unable to open texture file: %s\n", timFileName.c_str());
                     free(texCoords);
-                    return EXIT_FAILURE;
+                    return false;
                 }
 
 				switch(texCoords[index].flag.pmode) {
@@ -222,7 +1069,7 @@ int main(int argc, const char* argv[]) {
 	}
 
 
-    FILE* smdFile = fopen(param::smdFileName.c_str(), "wb");
+	long base = ftell(smdFile);
 
 	// Create temporary header
 	SMD_HEADER smdHeader;
@@ -231,10 +1078,35 @@ int main(int argc, const char* argv[]) {
 	fwrite(&smdHeader, sizeof(SMD_HEADER), 1, smdFile);
 
 
+	std::vector<SVECTOR> vertices;
+	std::vector<SVECTOR> normals;
+
+	// Parse bones (skinned models only) and reserve space for the skinned
+	// model header
+	std::vector<SMD_BONE> bones;
+	std::vector<SVECTOR> boneOrigins;
+	SMD_SKIN_HEADER skinHeader;
+
+	memset(&skinHeader, 0x00, sizeof(SMD_SKIN_HEADER));
+
+	if (!ParseBones(smxModel, bones, boneOrigins)) {
+
+		if (texCoords != NULL)
+			free(texCoords);
+
+		return false;
+
+	}
+
+	if (!bones.empty()) {
+		fwrite(&skinHeader, sizeof(SMD_SKIN_HEADER), 1, smdFile);
+		smdHeader.flags |= SMD_FLAG_SKINNED;
+	}
+
     // Convert vertices
 	if (smxModel->FirstChildElement("vertices") != NULL) {
 
-		smdHeader.vtxAddr = ftell(smdFile);
+		smdHeader.vtxAddr = ftell(smdFile)-base;
 		
 		tinyxml2::XMLElement* smxVertices = smxModel->FirstChildElement("vertices");
 		smxVertices = smxVertices->FirstChildElement("v");
@@ -251,19 +1123,42 @@ int main(int argc, const char* argv[]) {
 			fwrite(&vertex, sizeof(SVECTOR), 1, smdFile);
 			smdHeader.numverts++;
 			
+			// Keep the bone index in vp until vertices are grouped by bone
+			if (!bones.empty()) {
+				
+				vertex.vp = smxVertices->IntAttribute("bone");
+				
+				if ((vertex.vp < 0) || (vertex.vp >= (int)bones.size())) {
+					
+					printf("ERROR: Vertex bound to undefined bone %d.\n", vertex.vp);
+					
+					if (texCoords != NULL)
+						free(texCoords);
+					
+					return false;
+					
+				}
+				
+			}
+			
+			vertices.push_back(vertex);
+			
 			smxVertices = smxVertices->NextSiblingElement("v");
 
         }
 		
 		smdHeader.flags |= 0x1;
 
+		if (bound != NULL)
+			CalcBound(vertices, bound);
+
 	}
 
 
 	// Convert normals
 	if (smxModel->FirstChildElement("normals") != NULL) {
 
-		smdHeader.nrmAddr = ftell(smdFile);
+		smdHeader.nrmAddr = ftell(smdFile)-base;
 
 		tinyxml2::XMLElement* smxVertices = smxModel->FirstChildElement("normals");
 
@@ -281,6 +1176,8 @@ int main(int argc, const char* argv[]) {
 			fwrite(&vertex, sizeof(SVECTOR), 1, smdFile);
 			smdHeader.numnorms++;
 			
+			normals.push_back(vertex);
+			
 			smxVertices = smxVertices->NextSiblingElement("v");
 
         }
@@ -296,11 +1193,12 @@ int main(int argc, const char* argv[]) {
 
 	if (smxModel->FirstChildElement("primitives") != NULL) {
 
-		smdHeader.priAddr = ftell(smdFile);
+		smdHeader.priAddr = ftell(smdFile)-base;
 
 		tinyxml2::XMLElement* smxPrimitive = smxModel->FirstChildElement("primitives");
 		smxPrimitive = smxPrimitive->FirstChildElement("poly");
 
+		std::vector<PRIM_DATA> prims;
 		PRIM_ID *prim;
 		char pribuff[40];
 		char* priptr;
@@ -383,25 +1281,21 @@ int main(int argc, const char* argv[]) {
 
 						printf( "ERROR: Primitive with negative texture index encountered.\n" );
 
-						fclose( smdFile );
-
 						if( texCoords != NULL ) {
 							free( texCoords );
 						}
 
-						return EXIT_FAILURE;
+						return false;
 
 					} else if( texNum > numTextures-1 ) {
 
 						printf( "ERROR: Primitive with texture index greater than specified encountered.\n" );
 
-						fclose( smdFile );
-
 						if( texCoords != NULL ) {
 							free( texCoords );
 						}
 
-						return EXIT_FAILURE;
+						return false;
 
 					}
 					
@@ -445,8 +1339,7 @@ int main(int argc, const char* argv[]) {
 					
 				}
 				
-				fwrite( pribuff, 1, prim->len, smdFile );
-				smdHeader.numprims++;
+				prims.emplace_back( (unsigned char*)pribuff, (unsigned char*)pribuff+prim->len );
 			
 			} else if( strcasecmp( "G3", primType ) == 0 ) {
 				
@@ -512,8 +1405,7 @@ int main(int argc, const char* argv[]) {
 				priptr += 4;
 				prim->len += 4;
 				
-				fwrite( pribuff, 1, prim->len, smdFile );
-				smdHeader.numprims++;
+				prims.emplace_back( (unsigned char*)pribuff, (unsigned char*)pribuff+prim->len );
 				
 			} else if( ( strcasecmp( "F4", primType ) == 0 ) || 
 				( strcasecmp( "FT4", primType ) == 0 ) ) {
@@ -577,25 +1469,21 @@ int main(int argc, const char* argv[]) {
 
 						printf( "ERROR: Primitive with negative texture index encountered.\n" );
 
-						fclose( smdFile );
-
 						if( texCoords != NULL ) {
 							free( texCoords );
 						}
 
-						return EXIT_FAILURE;
+						return false;
 
 					} else if( texNum > numTextures-1 ) {
 
 						printf( "ERROR: Primitive with texture index greater than specified encountered.\n" );
 
-						fclose( smdFile );
-
 						if( texCoords != NULL ) {
 							free( texCoords );
 						}
 
-						return EXIT_FAILURE;
+						return false;
 
 					}
 					
@@ -639,8 +1527,7 @@ int main(int argc, const char* argv[]) {
 					
 				}
 				
-				fwrite( pribuff, 1, prim->len, smdFile );
-				smdHeader.numprims++;
+				prims.emplace_back( (unsigned char*)pribuff, (unsigned char*)pribuff+prim->len );
 			
 			} else if( strcasecmp( "G4", primType ) == 0 ) {
 				
@@ -719,21 +1606,18 @@ int main(int argc, const char* argv[]) {
 				priptr += 4;
 				prim->len += 4;
 				
-				fwrite( pribuff, 1, prim->len, smdFile );
-				smdHeader.numprims++;
+				prims.emplace_back( (unsigned char*)pribuff, (unsigned char*)pribuff+prim->len );
 				
 			} else {
 				
 				printf( "ERROR: Unknown or unsupported primitive type: %s\n", 
 					primType );
 				
-				fclose( smdFile );
-				
 				if( texCoords != NULL ) {
 					free( texCoords );
 				}
 				
-				return EXIT_FAILURE;
+				return false;
 				
 			}
 			
@@ -741,11 +1625,66 @@ int main(int argc, const char* argv[]) {
 			
 		}
 		
-		{
-			int term = 0;
-			fwrite( &term, 1, 4, smdFile );
+		if( param::mergeQuads ) {
+			printf( "Merged %d triangle pairs into quads.\n", 
+				MergeTriangles( prims, vertices ) );
+		}
+		
+		if( param::groupPrims || param::reorder )
+			SortPrimitives( prims );
+		
+		bool rewriteVerts = false;
+		
+		if( param::reorder ) {
+			
+			if( ReorderVertices( prims, vertices, normals ) ) {
+				
+				rewriteVerts = true;
+				
+			} else {
+				
+				printf( "WARNING: Primitive with out of range vertex or normal "
+					"index encountered, not reordering vertices.\n" );
+				
+			}
+			
+		}
+		
+		if( !bones.empty() ) {
+			
+			if( !GroupByBone( prims, vertices, normals, bones, boneOrigins ) ) {
+				
+				printf( "ERROR: Primitive with out of range vertex or normal "
+					"index encountered in skinned model.\n" );
+				
+				if( texCoords != NULL ) {
+					free( texCoords );
+				}
+				
+				return false;
+				
+			}
+			
+			rewriteVerts = true;
+			
+		}
+		
+		// Vertices and normals have already been written, so rewrite them in
+		// place (their count doesn't change) once reordered
+		if( rewriteVerts ) {
+			
+			fseek( smdFile, base+smdHeader.vtxAddr, SEEK_SET );
+			fwrite( vertices.data(), sizeof(SVECTOR), vertices.size(), smdFile );
+			
+			fseek( smdFile, base+smdHeader.nrmAddr, SEEK_SET );
+			fwrite( normals.data(), sizeof(SVECTOR), normals.size(), smdFile );
+			
+			fseek( smdFile, 0, SEEK_END );
+			
 		}
 		
+		smdHeader.numprims = WritePrimitives( prims, smdFile );
+		
 		/*
 		while(smxPrimitive != NULL) {
 
@@ -819,12 +1758,10 @@ int main(int argc, const char* argv[]) {
 
 					printf("ERROR: Primitive with negative vertex index encountered.\n");
 
-					fclose(smdFile);
-
 					if (texCoords != NULL)
 						free(texCoords);
 
-					return EXIT_FAILURE;
+					return false;
 
 				}
 
@@ -848,12 +1785,10 @@ int main(int argc, const char* argv[]) {
 
 					printf("ERROR: Primitive with negative normal index encountered.\n");
 
-					fclose(smdFile);
-
 					if (texCoords != NULL)
 						free(texCoords);
 
-					return EXIT_FAILURE;
+					return false;
 
 				}
 
@@ -909,23 +1844,19 @@ int main(int argc, const char* argv[]) {
 
 						printf("ERROR: Primitive with negative texture index encountered.\n");
 
-						fclose(smdFile);
-
 						if (texCoords != NULL)
 							free(texCoords);
 
-						return EXIT_FAILURE;
+						return false;
 
 					} else if (texNum > numTextures-1) {
 
 						printf("ERROR: Primitive with texture index greater than specified encountered.\n");
 
-						fclose(smdFile);
-
 						if (texCoords != NULL)
 							free(texCoords);
 
-						return EXIT_FAILURE;
+						return false;
 
 					}
 
@@ -989,17 +1920,245 @@ int main(int argc, const char* argv[]) {
 	}
 
 
+	if (!bones.empty()) {
+
+		if (!WriteSkin(smxModel, bones, &skinHeader, smdFile, base)) {
+
+			if (texCoords != NULL)
+				free(texCoords);
+
+			return false;
+
+		}
+
+		fseek(smdFile, base+sizeof(SMD_HEADER), SEEK_SET);
+		fwrite(&skinHeader, sizeof(SMD_SKIN_HEADER), 1, smdFile);
+		fseek(smdFile, 0, SEEK_END);
+
+	}
+
 	strcpy(smdHeader.id, "SMD");
 	smdHeader.version = 1;
 
-	fseek(smdFile, 0, SEEK_SET);
+	fseek(smdFile, base, SEEK_SET);
 	fwrite(&smdHeader, sizeof(SMD_HEADER), 1, smdFile);
-
-	fclose(smdFile);
+	fseek(smdFile, 0, SEEK_END);
 
 	if (texCoords != NULL)
 		free(texCoords);
 
+	return true;
+
+}
+
+static bool WriteSML(const std::vector<MESH_ENTRY>& meshes, FILE* smlFile) {
+
+	SML_HEADER header;
+	std::vector<SML_MESH> table(meshes.size());
+
+	memset(&header, 0, sizeof(SML_HEADER));
+	memset(table.data(), 0, sizeof(SML_MESH)*table.size());
+
+	// Write temporary header and mesh table
+	fwrite(&header, sizeof(SML_HEADER), 1, smlFile);
+	fwrite(table.data(), sizeof(SML_MESH), table.size(), smlFile);
+
+	for(size_t m=0; m<meshes.size(); m++) {
+
+		const MESH_ENTRY& mesh = meshes[m];
+
+		if (mesh.empty()) {
+			printf("ERROR: Mesh %d has no LODs.\n", (int)m);
+			return false;
+		}
+		if (mesh.size() > MAX_LODS) {
+			printf("ERROR: Mesh %d has more than %d LODs.\n", (int)m, MAX_LODS);
+			return false;
+		}
+
+		table[m].numLods = mesh.size();
+
+		for(size_t l=0; l<mesh.size(); l++) {
+
+			SVECTOR bound;
+
+			if ((l > 0) && (mesh[l].minSize > mesh[l-1].minSize))
+				printf("WARNING: LOD %d of mesh %d has a larger minimum size than the previous one.\n", (int)l, (int)m);
+
+			// Keep SMD data word aligned
+			while(ftell(smlFile)%4)
+				fputc(0, smlFile);
+
+			printf("Mesh %d, LOD %d (%d px): %s\n", (int)m, (int)l, mesh[l].minSize, mesh[l].fileName.c_str());
+
+			table[m].lods[l].minSize	= mesh[l].minSize;
+			table[m].lods[l].smdAddr	= ftell(smlFile);
+
+			if (!ConvertSMX(mesh[l].fileName.c_str(), smlFile, &bound))
+				return false;
+
+			// The most detailed LOD determines the bounding sphere
+			if (l == 0)
+				table[m].bound = bound;
+
+		}
+
+	}
+
+	memcpy(header.id, "SML", 3);
+	header.version		= 1;
+	header.numMeshes	= meshes.size();
+
+	fseek(smlFile, 0, SEEK_SET);
+	fwrite(&header, sizeof(SML_HEADER), 1, smlFile);
+	fwrite(table.data(), sizeof(SML_MESH), table.size(), smlFile);
+
+	return true;
+
+}
+
+int main(int argc, const char* argv[]) {
+
+	printf("SMXLINK " VERSION " - Scarlet SMX to SMD Model Converter "
+		"(part of Scarlet Engine)\n");
+	printf("Note: Outputs in *NEW* revision 1 format!\n");
+	printf("2017-2019 Meido-Tek Productions\n\n");
+
+	if (argc <= 1) {
+
+		printf("Parameters:\n");
+		printf("   smxlink [-o <filename>] [-s <scale>] <smxfile>\n");
+		printf("   smxlink [-o <filename>] [-s <scale>] [-m] [-l <size>] <smxfile> [[-m] [-l <size>] <smxfile>...]\n\n");
+		printf("   -o  <filename> - Specify output filename (default: first file specified)\n");
+		printf("   -s  <scale>    - Scale factor to apply to model on conversion (default: 1.0)\n");
+		printf("   -tp <path>     - Specify directory path to TIM texture files\n");
+		printf("   -g             - Group primitives by class (for smdSortModelGrouped())\n");
+		printf("   -r             - Sort primitives by class and texture page and reorder\n");
+		printf("                    vertices by first use (faster rendering)\n");
+		printf("   -q             - Merge pairs of coplanar triangles into quads\n");
+		printf("   -m             - Start a new mesh (SML output)\n");
+		printf("   -l  <size>     - Minimum projected radius in pixels for the next SMX file\n");
+		printf("                    to be used as a LOD of the current mesh (SML output)\n");
+		printf("   <smxfile>	  - SMX file to convert to SMD\n\n");
+		printf("   Only one SMX file may be given unless -m or -l is used. In that case an\n");
+		printf("   SML file is written instead, containing a bounding sphere and up to %d\n", MAX_LODS);
+		printf("   LODs (most detailed first) for each mesh.\n");
+		printf("   SMX files with bones are converted into skinned models, to be drawn\n");
+		printf("   using smdTransformSkin() and smdSortModelCached().\n");
+
+		return EXIT_SUCCESS;
+
+	}
+
+	std::vector<MESH_ENTRY> meshes(1);
+	int lodSize = 0;
+
+	for(int i=1; i<argc; i++) {
+
+		if (strcasecmp(argv[i], "-o") == 0) {
+
+			i++;
+			param::smdFileName = argv[i];
+
+		} else if (strcasecmp(argv[i], "-s") == 0) {
+
+			i++;
+			param::scaleFactor = atof(argv[i]);
+
+		} else if (strcasecmp(argv[i], "-tp") == 0) {
+
+			i++;
+			param::texDir = argv[i];
+
+			if( ( param::texDir[param::texDir.size()-1] != '\\' ) &&
+				( param::texDir[param::texDir.size()-1] != '/') ) {
+				
+				param::texDir += "/";
+				
+			}
+			
+		} else if (strcasecmp(argv[i], "-g") == 0) {
+
+			param::groupPrims = true;
+
+		} else if (strcasecmp(argv[i], "-r") == 0) {
+
+			param::reorder = true;
+
+		} else if (strcasecmp(argv[i], "-q") == 0) {
+
+			param::mergeQuads = true;
+
+		} else if (strcasecmp(argv[i], "-m") == 0) {
+
+			if (!meshes.back().empty())
+				meshes.emplace_back();
+
+			param::lodOutput = true;
+
+		} else if (strcasecmp(argv[i], "-l") == 0) {
+
+			i++;
+			lodSize = atoi(argv[i]);
+			param::lodOutput = true;
+
+		} else {
+
+			if (param::smxFileName.empty())
+				param::smxFileName = argv[i];
+
+			meshes.back().push_back({ argv[i], lodSize });
+			lodSize = 0;
+
+		}
+
+	}
+
+	if (param::smxFileName.empty()) {
+		printf("ERROR: No input file specified.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!param::lodOutput && (meshes[0].size() > 1)) {
+		printf("ERROR: Multiple input files can only be specified with -m or -l.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (param::smdFileName.empty()) {
+
+        param::smdFileName = param::smxFileName;
+        param::smdFileName.erase(param::smdFileName.rfind("."));
+        param::smdFileName += param::lodOutput ? ".sml" : ".smd";
+
+	}
+
+	printf("Input  : %s\n", param::smxFileName.c_str());
+	printf("Output : %s\n", param::smdFileName.c_str());
+
+	if (!param::texDir.empty())
+		printf("TexDir : %s\n", param::texDir.c_str());
+
+	printf("\n");
+
+	FILE* smdFile = fopen(param::smdFileName.c_str(), "wb");
+
+	if (smdFile == NULL) {
+		printf("ERROR: Unable to create output file.\n");
+		return EXIT_FAILURE;
+	}
+
+	bool success;
+
+	if (param::lodOutput)
+		success = WriteSML(meshes, smdFile);
+	else
+		success = ConvertSMX(param::smxFileName.c_str(), smdFile, NULL);
+
+	fclose(smdFile);
+
+	if (!success)
+		return EXIT_FAILURE;
+
 	printf("Converted successfully.\n");
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,266 @@
+/*
+ * PSn00bSDK SPU ADPCM encoder host test
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * adpcm.c only depends on the standard C headers and psxpress.h, so it can be
+ * built and checked on the host. Synthetic signals are encoded, decoded again
+ * using a reference implementation of the SPU's ADPCM decoder and compared
+ * against the original samples. A .VAG file generated by another encoder is
+ * also decoded and re-encoded, which should be lossless as the original
+ * filter and shift of each block reproduce its samples exactly.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <psxpress.h>
+
+#define SAMPLE_RATE		44100
+#define NUM_SAMPLES		(28 * 4096)
+#define TWO_PI			6.28318530717958647692
+
+#define BLOCK_SAMPLES	28
+#define BLOCK_SIZE		16
+#define VAG_HEADER_SIZE	48
+
+// Minimum allowed signal-to-noise ratio, in dB.
+#define MIN_SNR			35.0
+
+/* Reference decoder */
+
+static const int _filter_pos[5] = { 0, 60, 115,  98, 122 };
+static const int _filter_neg[5] = { 0,  0, -52, -55, -60 };
+
+static int _clamp_s16(int value) {
+	if (value < -0x8000)
+		return -0x8000;
+	if (value > 0x7fff)
+		return 0x7fff;
+
+	return value;
+}
+
+// Decodes a single block the same way the SPU does. Returns 0 if the block's
+// header is invalid.
+static int _decode_block(const uint8_t *block, int *state, int16_t *output) {
+	int shift  = block[0] & 15;
+	int filter = block[0] >> 4;
+
+	if ((shift > 12) || (filter > 4))
+		return 0;
+
+	for (int i = 0; i < BLOCK_SAMPLES; i++) {
+		int nibble = (block[2 + i / 2] >> ((i % 2) * 4)) & 15;
+		int sample = (int16_t) (nibble << 12) >> shift;
+
+		sample += (state[0] * _filter_pos[filter] + state[1] * _filter_neg[filter] + 32) >> 6;
+		sample  = _clamp_s16(sample);
+
+		state[1]  = state[0];
+		state[0]  = sample;
+		output[i] = sample;
+	}
+
+	return 1;
+}
+
+static int _decode(const uint8_t *input, int16_t *output, size_t length) {
+	int state[2] = { 0, 0 };
+
+	for (size_t i = 0; i < length; i += BLOCK_SAMPLES) {
+		if (!_decode_block(input, state, &output[i]))
+			return 0;
+
+		input += BLOCK_SIZE;
+	}
+
+	return 1;
+}
+
+/* Test signals */
+
+static void _gen_sine(int16_t *output, size_t length) {
+	for (size_t i = 0; i < length; i++)
+		output[i] = (int16_t) (16000.0 * sin(TWO_PI * 440.0 * i / SAMPLE_RATE));
+}
+
+static void _gen_chord(int16_t *output, size_t length) {
+	static const double freqs[3] = { 220.0, 277.18, 329.63 };
+
+	for (size_t i = 0; i < length; i++) {
+		double value = 0.0;
+
+		for (int j = 0; j < 3; j++)
+			value += 7000.0 * sin(TWO_PI * freqs[j] * i / SAMPLE_RATE);
+
+		output[i] = (int16_t) value;
+	}
+}
+
+// Decaying 110 Hz tone with harmonics, similar to a plucked string.
+static void _gen_pluck(int16_t *output, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		double t     = (double) i / SAMPLE_RATE;
+		double value = 0.0;
+
+		for (int j = 1; j <= 6; j++)
+			value += sin(TWO_PI * 110.0 * j * t) / j;
+
+		output[i] = (int16_t) (14000.0 * value * exp(-t * 0.8));
+	}
+}
+
+/* Tests */
+
+static double _snr(const int16_t *reference, const int16_t *decoded, size_t length) {
+	double signal = 0.0, noise = 0.0;
+
+	for (size_t i = 0; i < length; i++) {
+		double error = (double) decoded[i] - reference[i];
+
+		signal += (double) reference[i] * reference[i];
+		noise  += error * error;
+	}
+
+	if (noise == 0.0)
+		return INFINITY;
+
+	return 10.0 * log10(signal / noise);
+}
+
+static int _test_signal(
+	const char *name, void (*generate)(int16_t *, size_t), ENCSPU_Quality quality
+) {
+	static int16_t pcm[NUM_SAMPLES], decoded[NUM_SAMPLES];
+	static uint8_t adpcm[(NUM_SAMPLES / BLOCK_SAMPLES) * BLOCK_SIZE];
+
+	ENCSPU_Context ctx;
+
+	generate(pcm, NUM_SAMPLES);
+	EncSPUInit(&ctx, quality);
+
+	// Encode the signal in uneven chunks (multiples of 28 samples) to make
+	// sure the state is carried over correctly.
+	size_t offset = 0, length = 0;
+
+	for (int chunk = 1; offset < NUM_SAMPLES; chunk++) {
+		size_t samples = BLOCK_SAMPLES * chunk;
+		int    flags   = offset ? 0 : ENCSPU_FLAG_START;
+
+		if ((offset + samples) >= NUM_SAMPLES) {
+			samples = NUM_SAMPLES - offset;
+			flags  |= ENCSPU_FLAG_END;
+		}
+
+		length += EncSPUEncode(&ctx, &adpcm[length], &pcm[offset], samples, flags);
+		offset += samples;
+	}
+
+	if (length != sizeof(adpcm)) {
+		printf("%s: encoded %d bytes, expected %d\n", name, (int) length, (int) sizeof(adpcm));
+		return 0;
+	}
+	if (!_decode(adpcm, decoded, NUM_SAMPLES)) {
+		printf("%s: invalid block header\n", name);
+		return 0;
+	}
+	if (!(adpcm[1] & 4) || ((adpcm[length - BLOCK_SIZE + 1] & 3) != 1)) {
+		printf("%s: invalid loop flags\n", name);
+		return 0;
+	}
+
+	double snr = _snr(pcm, decoded, NUM_SAMPLES);
+
+	printf(
+		"%s (%s): SNR %.2f dB\n", name,
+		(quality == ENCSPU_QUALITY_FAST) ? "fast" : "normal", snr
+	);
+	return (snr >= MIN_SNR);
+}
+
+// Decodes a .VAG file and re-encodes the resulting samples. As the file's own
+// filter and shift choices reproduce them exactly, the encoder must find an
+// encoding that decodes to the same samples, ideally the same one.
+static int _test_vag(const char *path) {
+	FILE *file = fopen(path, "rb");
+
+	if (!file) {
+		printf("Can't open %s\n", path);
+		return 0;
+	}
+
+	uint8_t header[VAG_HEADER_SIZE];
+
+	if (fread(header, VAG_HEADER_SIZE, 1, file) != 1 || memcmp(header, "VAGp", 4)) {
+		printf("%s: invalid header\n", path);
+		fclose(file);
+		return 0;
+	}
+
+	size_t size =
+		(header[12] << 24) | (header[13] << 16) | (header[14] << 8) | header[15];
+	size_t length = (size / BLOCK_SIZE) * BLOCK_SAMPLES;
+
+	uint8_t *adpcm    = malloc(size);
+	uint8_t *encoded  = malloc(size);
+	int16_t *pcm      = malloc(length * sizeof(int16_t));
+	int16_t *decoded  = malloc(length * sizeof(int16_t));
+
+	size = fread(adpcm, 1, size, file) / BLOCK_SIZE * BLOCK_SIZE;
+	fclose(file);
+	length = (size / BLOCK_SIZE) * BLOCK_SAMPLES;
+
+	int passed = _decode(adpcm, pcm, length);
+
+	if (!passed) {
+		printf("%s: invalid block header\n", path);
+	} else {
+		ENCSPU_Context ctx;
+		int            matching = 0;
+
+		EncSPUInit(&ctx, ENCSPU_QUALITY_NORMAL);
+		EncSPUEncode(&ctx, encoded, pcm, length, ENCSPU_FLAG_START);
+		_decode(encoded, decoded, length);
+
+		// Flags are ignored as they depend on the loop settings used to
+		// generate the file.
+		for (size_t i = 0; i < size; i += BLOCK_SIZE) {
+			if (
+				(adpcm[i] == encoded[i]) &&
+				!memcmp(&adpcm[i + 2], &encoded[i + 2], BLOCK_SIZE - 2)
+			)
+				matching++;
+		}
+
+		passed = !memcmp(pcm, decoded, length * sizeof(int16_t));
+
+		printf(
+			"%s: %d of %d blocks identical, re-encoding %s\n", path,
+			matching, (int) (size / BLOCK_SIZE), passed ? "lossless" : "lossy"
+		);
+	}
+
+	free(adpcm);
+	free(encoded);
+	free(pcm);
+	free(decoded);
+	return passed;
+}
+
+int main(int argc, const char **argv) {
+	int passed = 1;
+
+	for (int i = ENCSPU_QUALITY_FAST; i <= ENCSPU_QUALITY_NORMAL; i++) {
+		passed &= _test_signal("sine",  &_gen_sine,  i);
+		passed &= _test_signal("chord", &_gen_chord, i);
+		passed &= _test_signal("pluck", &_gen_pluck, i);
+	}
+
+	for (int i = 1; i < argc; i++)
+		passed &= _test_vag(argv[i]);
+
+	printf(passed ? "All tests passed\n" : "Some tests failed\n");
+	return passed ? 0 : 1;
+}
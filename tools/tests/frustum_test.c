@@ -0,0 +1,384 @@
+/*
+ * PSn00bSDK view frustum culling host test
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * frustum.c is plain C using the inline_c.h GTE macros, so it can be built on
+ * the host against an emulated GTE (see gte_stub/inline_c.h) and checked
+ * against a double-precision reference. Culling is allowed to keep objects
+ * that are slightly outside the frustum, but never to drop visible ones.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <psxgte.h>
+#include <inline_c.h>
+
+#define NUM_VIEWS		500
+#define NUM_OBJECTS		512
+#define ANGLE_TO_RAD	(3.14159265358979323846 / 2048.0)
+
+// Maximum allowed errors. Plane normals are in 4.12 fixed-point units, plane
+// distances and culling errors in world units.
+#define MAX_NORMAL_ERROR	1
+#define MAX_DIST_ERROR		40
+#define MAX_CULL_ERROR		64
+
+// Must match the value used in frustum.c.
+#define PLANE_MARGIN		24
+
+GTE_State gte_state;
+
+/* Host replacements for assembly functions */
+
+int SquareRoot0(int v) {
+	return (int) sqrt((double) v);
+}
+
+/* Reference implementation */
+
+typedef struct {
+	double n[3], d;
+} Plane;
+
+typedef struct {
+	int w, h, znear, zfar;
+} ViewParams;
+
+// Calculates the planes of the frustum in world space from the current GTE
+// state, mirroring what InitFrustum() does.
+static int _ref_planes(const ViewParams *params, Plane *planes) {
+	const MATRIX *view = &gte_state.rot;
+	double       proj  = gte_state.h;
+	double       ofx   = gte_state.ofx;
+	double       ofy   = gte_state.ofy;
+
+	const double normals[6][3] = {
+		{  proj,  0.0,  ofx             },
+		{ -proj,  0.0,  params->w - ofx },
+		{  0.0,   proj, ofy             },
+		{  0.0,  -proj, params->h - ofy },
+		{  0.0,   0.0,  1.0             },
+		{  0.0,   0.0, -1.0             }
+	};
+	const double dists[6] = { 0.0, 0.0, 0.0, 0.0, -params->znear, params->zfar };
+	int          count    = params->zfar ? 6 : 5;
+
+	for (int i = 0; i < count; i++) {
+		const double *n  = normals[i];
+		double       len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		planes[i].d = dists[i];
+
+		for (int j = 0; j < 3; j++) {
+			planes[i].n[j] = 0.0;
+			planes[i].d   += n[j] / len * view->t[j];
+
+			for (int k = 0; k < 3; k++)
+				planes[i].n[j] += n[k] / len * view->m[k][j] / 4096.0;
+		}
+	}
+
+	return count;
+}
+
+static double _distance(const Plane *plane, const SVECTOR *point) {
+	return plane->n[0] * point->vx + plane->n[1] * point->vy +
+		plane->n[2] * point->vz + plane->d;
+}
+
+// Returns the distance of the sphere or box from the plane it is furthest
+// outside of (negative if outside the frustum).
+static double _sphere_distance(const Plane *planes, int count, const SVECTOR *sphere) {
+	double min = INFINITY;
+
+	for (int i = 0; i < count; i++)
+		min = fmin(min, _distance(&planes[i], sphere) + sphere->pad);
+
+	return min;
+}
+
+static double _box_distance(const Plane *planes, int count, const AABB *box) {
+	double min = INFINITY;
+
+	for (int i = 0; i < count; i++) {
+		double extent =
+			fabs(planes[i].n[0]) * box->size.vx +
+			fabs(planes[i].n[1]) * box->size.vy +
+			fabs(planes[i].n[2]) * box->size.vz;
+
+		min = fmin(min, _distance(&planes[i], &box->center) + extent);
+	}
+
+	return min;
+}
+
+/* Test setup */
+
+static int _random_range(int min, int max) {
+	return min + rand() % (max - min + 1);
+}
+
+// Sets up a random camera in the emulated GTE and returns random projection
+// parameters.
+static void _random_view(ViewParams *params) {
+	double a = _random_range(0, 4095) * ANGLE_TO_RAD;
+	double b = _random_range(0, 4095) * ANGLE_TO_RAD;
+	double c = _random_range(0, 4095) * ANGLE_TO_RAD;
+	double r[3][3] = {
+		{
+			cos(b) * cos(c),
+			-cos(b) * sin(c),
+			sin(b)
+		}, {
+			sin(a) * sin(b) * cos(c) + cos(a) * sin(c),
+			-sin(a) * sin(b) * sin(c) + cos(a) * cos(c),
+			-sin(a) * cos(b)
+		}, {
+			-cos(a) * sin(b) * cos(c) + sin(a) * sin(c),
+			cos(a) * sin(b) * sin(c) + sin(a) * cos(c),
+			cos(a) * cos(b)
+		}
+	};
+	int cam[3] = {
+		_random_range(-8000, 8000),
+		_random_range(-8000, 8000),
+		_random_range(-8000, 8000)
+	};
+
+	for (int i = 0; i < 3; i++) {
+		gte_state.rot.t[i] = 0;
+
+		for (int j = 0; j < 3; j++)
+			gte_state.rot.m[i][j] = (int16_t) lround(r[i][j] * 4096.0);
+		for (int j = 0; j < 3; j++)
+			gte_state.rot.t[i] -= (gte_state.rot.m[i][j] * cam[j]) >> 12;
+	}
+
+	static const int widths[3]  = { 256, 320, 640 };
+	static const int heights[3] = { 224, 240, 480 };
+	int              mode       = rand() % 3;
+
+	params->w     = widths[mode];
+	params->h     = heights[mode];
+	params->znear = _random_range(1, 200);
+	params->zfar  = (rand() % 4) ? _random_range(2000, 30000) : 0;
+
+	gte_state.h   = _random_range(params->w / 4, params->w * 2);
+	gte_state.ofx = params->w / 2 + _random_range(-params->w / 8, params->w / 8);
+	gte_state.ofy = params->h / 2 + _random_range(-params->h / 8, params->h / 8);
+}
+
+static void _random_svector(SVECTOR *v, int range) {
+	v->vx = _random_range(-range, range);
+	v->vy = _random_range(-range, range);
+	v->vz = _random_range(-range, range);
+}
+
+// Picks a random point inside the frustum and within the SVECTOR range.
+static void _random_inside(const ViewParams *params, SVECTOR *v) {
+	const MATRIX *view = &gte_state.rot;
+	int          zmax  = params->zfar ? params->zfar : 30000;
+
+	for (;;) {
+		double q[3], p[3];
+
+		// Calculate the point in view space, then transform it back into world
+		// space using the transposed view matrix.
+		q[2] = _random_range(params->znear, zmax);
+		q[0] = (_random_range(0, params->w) - gte_state.ofx) * q[2] / gte_state.h;
+		q[1] = (_random_range(0, params->h) - gte_state.ofy) * q[2] / gte_state.h;
+
+		for (int i = 0; i < 3; i++) {
+			p[i] = 0.0;
+
+			for (int j = 0; j < 3; j++)
+				p[i] += view->m[j][i] / 4096.0 * (q[j] - view->t[j]);
+		}
+
+		if ((fabs(p[0]) > 30000.0) || (fabs(p[1]) > 30000.0) || (fabs(p[2]) > 30000.0))
+			continue;
+
+		v->vx = lround(p[0]);
+		v->vy = lround(p[1]);
+		v->vz = lround(p[2]);
+		return;
+	}
+}
+
+// Moves a point so that its distance from the given plane is the specified
+// one, as long as it stays within the SVECTOR range.
+static void _move_to_plane(const Plane *plane, SVECTOR *v, int dist) {
+	double offset = dist - _distance(plane, v);
+	double p[3]   = {
+		v->vx + plane->n[0] * offset,
+		v->vy + plane->n[1] * offset,
+		v->vz + plane->n[2] * offset
+	};
+
+	if ((fabs(p[0]) > 32000.0) || (fabs(p[1]) > 32000.0) || (fabs(p[2]) > 32000.0))
+		return;
+
+	v->vx = lround(p[0]);
+	v->vy = lround(p[1]);
+	v->vz = lround(p[2]);
+}
+
+/* Tests */
+
+static int _check_planes(
+	const FRUSTUM *f, const Plane *planes, int count, int *max_normal,
+	int *max_dist
+) {
+	for (int i = 0; i < count; i++) {
+		const MATRIX *m = &f->planes[i / 3];
+		const MATRIX *e = &f->extents[i / 3];
+		int          row = i % 3;
+
+		for (int j = 0; j < 3; j++) {
+			int error = abs(m->m[row][j] - (int) lround(planes[i].n[j] * 4096.0));
+
+			if (error > *max_normal)
+				*max_normal = error;
+			if (e->m[row][j] != abs(m->m[row][j]))
+				return 0;
+		}
+
+		// The margin is expected and not counted as an error.
+		int error = abs(m->t[row] - (int) lround(planes[i].d) - PLANE_MARGIN);
+
+		if (error > *max_dist)
+			*max_dist = error;
+	}
+
+	return 1;
+}
+
+// Checks the list of visible objects returned by a culling function, given
+// the reference distances of all objects from the frustum.
+static int _check_visible(
+	const double *dists, const uint16_t *visible, int count, double *max_error
+) {
+	int next = 0;
+
+	for (int i = 0; i < NUM_OBJECTS; i++) {
+		int kept = (next < count) && (visible[next] == i);
+
+		if (kept) {
+			next++;
+
+			if (-dists[i] > *max_error)
+				*max_error = -dists[i];
+		} else if (dists[i] >= 0.0) {
+			return 0;
+		}
+	}
+
+	// Fails if the list was not in ascending order.
+	return (next == count);
+}
+
+static int _test_frustum(void) {
+	static SVECTOR  spheres[NUM_OBJECTS];
+	static AABB     boxes[NUM_OBJECTS];
+	static uint16_t visible[NUM_OBJECTS];
+	static double   dists[NUM_OBJECTS];
+
+	int    passed = 1, max_normal = 0, max_dist = 0;
+	double max_sphere_error = 0.0, max_box_error = 0.0;
+	int    num_visible = 0, num_objects = 0;
+
+	for (int i = 0; i < NUM_VIEWS; i++) {
+		ViewParams params;
+		FRUSTUM    f;
+		Plane      planes[6];
+
+		_random_view(&params);
+		int count = _ref_planes(&params, planes);
+		InitFrustum(&f, params.w, params.h, params.znear, params.zfar);
+
+		if (!_check_planes(&f, planes, count, &max_normal, &max_dist)) {
+			printf("InitFrustum(): extent matrix mismatch\n");
+			passed = 0;
+		}
+
+		// Spheres and boxes are placed randomly within the SVECTOR range, some
+		// of them extending past it. Half of them are placed inside the
+		// frustum and then moved close to one of the planes, as those are the
+		// ones most likely to be culled incorrectly.
+		for (int j = 0; j < NUM_OBJECTS; j++) {
+			if (j % 2)
+				_random_inside(&params, &spheres[j]);
+			else
+				_random_svector(&spheres[j], 30000);
+
+			spheres[j].pad = _random_range(0, 2000);
+
+			if (j % 2)
+				_move_to_plane(
+					&planes[rand() % count], &spheres[j],
+					_random_range(-spheres[j].pad - 64, -spheres[j].pad + 64)
+				);
+
+			dists[j] = _sphere_distance(planes, count, &spheres[j]);
+		}
+
+		int visible_count = FrustumCullSpheres(&f, spheres, visible, NUM_OBJECTS);
+
+		if (!_check_visible(dists, visible, visible_count, &max_sphere_error)) {
+			printf("FrustumCullSpheres(): visible sphere culled (view %d)\n", i);
+			passed = 0;
+		}
+
+		num_visible += visible_count;
+		num_objects += NUM_OBJECTS;
+
+		for (int j = 0; j < NUM_OBJECTS; j++) {
+			if (j % 2)
+				_random_inside(&params, &boxes[j].center);
+			else
+				_random_svector(&boxes[j].center, 30000);
+
+			boxes[j].size.vx = _random_range(0, 2000);
+			boxes[j].size.vy = _random_range(0, 2000);
+			boxes[j].size.vz = _random_range(0, 2000);
+
+			if (j % 2)
+				_move_to_plane(
+					&planes[rand() % count], &boxes[j].center,
+					_random_range(-2000, 64)
+				);
+
+			dists[j] = _box_distance(planes, count, &boxes[j]);
+		}
+
+		visible_count = FrustumCullBoxes(&f, boxes, visible, NUM_OBJECTS);
+
+		if (!_check_visible(dists, visible, visible_count, &max_box_error)) {
+			printf("FrustumCullBoxes(): visible box culled (view %d)\n", i);
+			passed = 0;
+		}
+	}
+
+	printf("InitFrustum(): max normal error %d, max distance error %d\n", max_normal, max_dist);
+	printf("FrustumCullSpheres(): max distance of kept sphere %.2f\n", max_sphere_error);
+	printf("FrustumCullBoxes(): max distance of kept box %.2f\n", max_box_error);
+	printf("%d of %d spheres visible\n", num_visible, num_objects);
+
+	return passed &&
+		(max_normal <= MAX_NORMAL_ERROR) &&
+		(max_dist <= MAX_DIST_ERROR) &&
+		(max_sphere_error <= MAX_CULL_ERROR) &&
+		(max_box_error <= MAX_CULL_ERROR);
+}
+
+int main(int argc, const char **argv) {
+	int passed = 1;
+
+	srand(1);
+	passed &= _test_frustum();
+
+	printf(passed ? "All tests passed\n" : "Some tests failed\n");
+	return passed ? 0 : 1;
+}
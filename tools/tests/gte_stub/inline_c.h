@@ -0,0 +1,63 @@
+/*
+ * PSn00bSDK GTE emulation for host tests
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * A replacement for inline_c.h implementing the few GTE macros used by the
+ * libpsn00b code being tested on the host. Only the registers and MVMVA
+ * variants actually used are emulated; IR saturation and flags are not.
+ */
+
+#ifndef __INLINE_C_H
+#define __INLINE_C_H
+
+#include <stdint.h>
+#include <string.h>
+#include <psxgte.h>
+
+typedef struct {
+	MATRIX  rot, light;
+	SVECTOR v0;
+	int32_t mac[3];
+	int     h, ofx, ofy;
+} GTE_State;
+
+extern GTE_State gte_state;
+
+// MVMVA with sf = 1 and lm = 0. mx selects the rotation (0) or light (1)
+// matrix, v must be 0 (V0) and cv either 0 (TR) or 3 (none).
+static inline void _gte_mvmva(int mx, int cv) {
+	const MATRIX *m = mx ? &gte_state.light : &gte_state.rot;
+	int64_t      v[3] = { gte_state.v0.vx, gte_state.v0.vy, gte_state.v0.vz };
+
+	for (int i = 0; i < 3; i++) {
+		int64_t sum = cv ? 0 : ((int64_t) gte_state.rot.t[i] * 4096);
+
+		for (int j = 0; j < 3; j++)
+			sum += m->m[i][j] * v[j];
+
+		gte_state.mac[i] = (int32_t) (sum >> 12);
+	}
+}
+
+#define gte_SetRotMatrix(r0) \
+	memcpy(gte_state.rot.m, (r0)->m, sizeof(gte_state.rot.m))
+#define gte_SetTransMatrix(r0) \
+	memcpy(gte_state.rot.t, (r0)->t, sizeof(gte_state.rot.t))
+#define gte_SetLightMatrix(r0) \
+	memcpy(gte_state.light.m, (r0)->m, sizeof(gte_state.light.m))
+
+#define gte_ReadRotMatrix(r0) \
+	(*(r0) = gte_state.rot)
+#define gte_ReadGeomScreen(r0) \
+	(*(r0) = gte_state.h)
+#define gte_ReadGeomOffset(r0, r1) \
+	(*(r0) = gte_state.ofx, *(r1) = gte_state.ofy)
+
+#define gte_ldv0(r0) \
+	(gte_state.v0 = *(const SVECTOR *) (r0))
+#define gte_mvmva(sf, mx, v, cv, lm) \
+	_gte_mvmva(mx, cv)
+#define gte_stlvnl(r0) \
+	((r0)->vx = gte_state.mac[0], (r0)->vy = gte_state.mac[1], (r0)->vz = gte_state.mac[2])
+
+#endif
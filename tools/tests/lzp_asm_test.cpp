@@ -0,0 +1,856 @@
+/*
+ * PSn00bSDK assembly LZP decompressor host test
+ * (C) 2023 spicyjpeg - MPL licensed
+ *
+ * The assembly implementation of lzDecompress() in decompress.s can't be built
+ * for the host, so this test parses the source file and runs it through a
+ * minimal MIPS-I interpreter instead. Branch and load delay slots are emulated
+ * (including lwl/lwr merging), and every memory access is checked against the
+ * input and output buffers. The output is then compared byte-for-byte against
+ * the C implementation of lzDecompress() on a set of random and edge case
+ * inputs compressed with lzCompress().
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "lzp.h"
+
+#define ENTRY_POINT		"_lz_decompress_asm"
+#define MAX_STEPS		200000000
+
+/* MIPS-I interpreter */
+
+// Number of bytes past the end of the input the decompressor is allowed to
+// read, as documented in decompress.s.
+#define INPUT_OVERREAD	7
+
+enum Opcode {
+	OP_NOP,
+	OP_ADDU, OP_ADDIU, OP_SUBU, OP_AND, OP_ANDI, OP_OR, OP_ORI, OP_XOR, OP_XORI,
+	OP_NOR, OP_SLL, OP_SRL, OP_SRA, OP_SLLV, OP_SRLV, OP_SRAV, OP_SLT, OP_SLTU,
+	OP_SLTI, OP_SLTIU, OP_LUI, OP_LI, OP_MOVE,
+	OP_B, OP_BEQ, OP_BNE, OP_BEQZ, OP_BNEZ, OP_BGTZ, OP_BGEZ, OP_BLTZ, OP_BLEZ,
+	OP_JR,
+	OP_LB, OP_LBU, OP_LH, OP_LHU, OP_LW, OP_LWL, OP_LWR,
+	OP_SB, OP_SH, OP_SW, OP_SWL, OP_SWR
+};
+
+enum OperandFormat {
+	FMT_NONE,	// nop
+	FMT_RRR,	// op rd, rs, rt (rt may be omitted: op rd, rt -> op rd, rd, rt)
+	FMT_RRI,	// op rt, rs, imm (rs may be omitted: op rt, imm -> op rt, rt, imm)
+	FMT_RI,		// op rt, imm
+	FMT_RR,		// op rd, rs
+	FMT_L,		// op label
+	FMT_RRL,	// op rs, rt, label
+	FMT_RL,		// op rs, label
+	FMT_R,		// op rs
+	FMT_RM		// op rt, imm(rs)
+};
+
+static const struct {
+	const char    *name;
+	Opcode        op;
+	OperandFormat format;
+} _opcodes[] = {
+	{ "nop",   OP_NOP,   FMT_NONE },
+	{ "addu",  OP_ADDU,  FMT_RRR  },
+	{ "addiu", OP_ADDIU, FMT_RRI  },
+	{ "subu",  OP_SUBU,  FMT_RRR  },
+	{ "and",   OP_AND,   FMT_RRR  },
+	{ "andi",  OP_ANDI,  FMT_RRI  },
+	{ "or",    OP_OR,    FMT_RRR  },
+	{ "ori",   OP_ORI,   FMT_RRI  },
+	{ "xor",   OP_XOR,   FMT_RRR  },
+	{ "xori",  OP_XORI,  FMT_RRI  },
+	{ "nor",   OP_NOR,   FMT_RRR  },
+	{ "sll",   OP_SLL,   FMT_RRI  },
+	{ "srl",   OP_SRL,   FMT_RRI  },
+	{ "sra",   OP_SRA,   FMT_RRI  },
+	{ "sllv",  OP_SLLV,  FMT_RRR  },
+	{ "srlv",  OP_SRLV,  FMT_RRR  },
+	{ "srav",  OP_SRAV,  FMT_RRR  },
+	{ "slt",   OP_SLT,   FMT_RRR  },
+	{ "sltu",  OP_SLTU,  FMT_RRR  },
+	{ "slti",  OP_SLTI,  FMT_RRI  },
+	{ "sltiu", OP_SLTIU, FMT_RRI  },
+	{ "lui",   OP_LUI,   FMT_RI   },
+	{ "li",    OP_LI,    FMT_RI   },
+	{ "move",  OP_MOVE,  FMT_RR   },
+	{ "b",     OP_B,     FMT_L    },
+	{ "beq",   OP_BEQ,   FMT_RRL  },
+	{ "bne",   OP_BNE,   FMT_RRL  },
+	{ "beqz",  OP_BEQZ,  FMT_RL   },
+	{ "bnez",  OP_BNEZ,  FMT_RL   },
+	{ "bgtz",  OP_BGTZ,  FMT_RL   },
+	{ "bgez",  OP_BGEZ,  FMT_RL   },
+	{ "bltz",  OP_BLTZ,  FMT_RL   },
+	{ "blez",  OP_BLEZ,  FMT_RL   },
+	{ "jr",    OP_JR,    FMT_R    },
+	{ "lb",    OP_LB,    FMT_RM   },
+	{ "lbu",   OP_LBU,   FMT_RM   },
+	{ "lh",    OP_LH,    FMT_RM   },
+	{ "lhu",   OP_LHU,   FMT_RM   },
+	{ "lw",    OP_LW,    FMT_RM   },
+	{ "lwl",   OP_LWL,   FMT_RM   },
+	{ "lwr",   OP_LWR,   FMT_RM   },
+	{ "sb",    OP_SB,    FMT_RM   },
+	{ "sh",    OP_SH,    FMT_RM   },
+	{ "sw",    OP_SW,    FMT_RM   },
+	{ "swl",   OP_SWL,   FMT_RM   },
+	{ "swr",   OP_SWR,   FMT_RM   }
+};
+
+static const char *const _reg_names[32] = {
+	"zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+	"t0",   "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+	"s0",   "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+	"t8",   "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+struct Instruction {
+	Opcode  op;
+	int     rd, rs, rt;	// rd is the destination of ALU and load instructions
+	int32_t imm;
+	int     target;		// Index of the branch target instruction
+	int     line;
+};
+
+class Interpreter {
+private:
+	std::vector<Instruction>	program;
+	std::map<std::string, int>	labels;
+	std::map<std::string, int>	aliases;
+	int							entry_point;
+
+	uint32_t	regs[32];
+	uint32_t	input_addr, input_size, output_addr, output_size;
+	uint32_t	max_read;
+	uint8_t		*input, *output;
+
+	int _parse_reg(const std::string &name);
+	bool _parse(Instruction &inst, OperandFormat format, const std::vector<std::string> &args);
+	bool _load_byte(uint32_t addr, uint32_t &value);
+	bool _store_byte(uint32_t addr, uint32_t value);
+
+public:
+	bool load(const char *path);
+	int run(
+		uint8_t *out, size_t out_size, const uint8_t *in, size_t in_size,
+		std::string &message
+	);
+	int overread(void) const {
+		return (max_read >= (input_addr + input_size)) ?
+			(max_read - (input_addr + input_size) + 1) : 0;
+	}
+};
+
+static std::string _trim(const std::string &str) {
+	size_t start = str.find_first_not_of(" \t\r\n");
+	size_t end   = str.find_last_not_of(" \t\r\n");
+
+	if (start == std::string::npos)
+		return "";
+
+	return str.substr(start, end - start + 1);
+}
+
+int Interpreter::_parse_reg(const std::string &name) {
+	auto alias = aliases.find(name);
+	if (alias != aliases.end())
+		return alias->second;
+
+	if (name.empty() || (name[0] != '$'))
+		return -1;
+
+	for (int i = 0; i < 32; i++) {
+		if (name.substr(1) == _reg_names[i])
+			return i;
+	}
+
+	return -1;
+}
+
+bool Interpreter::_parse(
+	Instruction &inst, OperandFormat format, const std::vector<std::string> &args
+) {
+	static const size_t min_args[] = { 0, 2, 2, 2, 2, 1, 3, 2, 1, 2 };
+	static const size_t max_args[] = { 0, 3, 3, 2, 2, 1, 3, 2, 1, 2 };
+
+	if ((args.size() < min_args[format]) || (args.size() > max_args[format]))
+		return false;
+
+	auto imm = [](const std::string &value, int32_t &out) {
+		char *end;
+
+		out = (int32_t) strtol(value.c_str(), &end, 0);
+		return !value.empty() && !*end;
+	};
+
+	// Branch targets are resolved after all labels have been collected.
+	inst.rd     = 0;
+	inst.rs     = 0;
+	inst.rt     = 0;
+	inst.imm    = 0;
+	inst.target = -1;
+
+	switch (format) {
+		case FMT_NONE:
+			return true;
+
+		case FMT_RRR:
+			inst.rd = _parse_reg(args[0]);
+			inst.rs = _parse_reg(args[args.size() - 2]);
+			inst.rt = _parse_reg(args[args.size() - 1]);
+			return (inst.rd >= 0) && (inst.rs >= 0) && (inst.rt >= 0);
+
+		case FMT_RRI:
+			inst.rd = _parse_reg(args[0]);
+			inst.rs = _parse_reg(args[args.size() - 2]);
+			return (inst.rd >= 0) && (inst.rs >= 0) &&
+				imm(args[args.size() - 1], inst.imm);
+
+		case FMT_RI:
+			inst.rd = _parse_reg(args[0]);
+			return (inst.rd >= 0) && imm(args[1], inst.imm);
+
+		case FMT_RR:
+			inst.rd = _parse_reg(args[0]);
+			inst.rs = _parse_reg(args[1]);
+			return (inst.rd >= 0) && (inst.rs >= 0);
+
+		case FMT_L:
+			return true;
+
+		case FMT_RRL:
+			inst.rs = _parse_reg(args[0]);
+			inst.rt = _parse_reg(args[1]);
+			return (inst.rs >= 0) && (inst.rt >= 0);
+
+		case FMT_RL:
+		case FMT_R:
+			inst.rs = _parse_reg(args[0]);
+			return (inst.rs >= 0);
+
+		case FMT_RM: {
+			size_t open  = args[1].find('(');
+			size_t close = args[1].find(')');
+
+			if ((open == std::string::npos) || (close != (args[1].size() - 1)))
+				return false;
+
+			// Stores read rt, loads write it.
+			inst.rd = _parse_reg(args[0]);
+			inst.rt = inst.rd;
+			inst.rs = _parse_reg(args[1].substr(open + 1, close - open - 1));
+			return (inst.rd >= 0) && (inst.rs >= 0) &&
+				imm(_trim(args[1].substr(0, open)), inst.imm);
+		}
+	}
+
+	return false;
+}
+
+bool Interpreter::load(const char *path) {
+	std::ifstream file(path);
+	if (!file) {
+		printf("Can't open %s\n", path);
+		return false;
+	}
+
+	std::map<std::string, std::vector<std::pair<std::string, int>>> macros;
+	std::vector<std::pair<std::string, int>> *macro = nullptr;
+	std::vector<std::pair<std::string, int>> lines;
+	std::vector<std::string> targets;
+	std::string line;
+
+	for (int number = 1; std::getline(file, line); number++) {
+		line = _trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+
+		// Collect macro bodies and expand macro invocations.
+		if (line.rfind(".macro", 0) == 0) {
+			macro = &macros[_trim(line.substr(6))];
+			continue;
+		}
+		if (line.rfind(".endm", 0) == 0) {
+			macro = nullptr;
+			continue;
+		}
+		if (macro) {
+			macro->push_back({ line, number });
+			continue;
+		}
+
+		auto body = macros.find(line);
+		if (body != macros.end())
+			lines.insert(lines.end(), body->second.begin(), body->second.end());
+		else
+			lines.push_back({ line, number });
+	}
+
+	for (auto &entry : lines) {
+		const std::string &text = entry.first;
+
+		if (text[text.size() - 1] == ':') {
+			labels[text.substr(0, text.size() - 1)] = program.size();
+			continue;
+		}
+
+		size_t      split = text.find_first_of(" \t");
+		std::string name  = text.substr(0, split);
+		std::string rest  = (split != std::string::npos) ? text.substr(split) : "";
+
+		std::vector<std::string> args;
+		std::stringstream        stream(rest);
+		std::string              arg;
+
+		while (std::getline(stream, arg, ','))
+			args.push_back(_trim(arg));
+
+		// Register aliases (.set name, $reg) are resolved while parsing; all
+		// other directives are ignored.
+		if (name == ".set") {
+			if (args.size() == 2) {
+				int reg = _parse_reg(args[1]);
+
+				if (reg < 0) {
+					printf("%s:%d: invalid register\n", path, entry.second);
+					return false;
+				}
+
+				aliases[args[0]] = reg;
+			}
+			continue;
+		}
+		if (name[0] == '.')
+			continue;
+
+		Instruction inst;
+		bool        found = false;
+
+		inst.line = entry.second;
+
+		for (auto &opcode : _opcodes) {
+			if (name != opcode.name)
+				continue;
+
+			inst.op = opcode.op;
+			found   = true;
+
+			if (!_parse(inst, opcode.format, args)) {
+				printf("%s:%d: invalid operands\n", path, entry.second);
+				return false;
+			}
+
+			// Keep the label name to resolve it later.
+			if ((opcode.format == FMT_L) || (opcode.format == FMT_RL) || (opcode.format == FMT_RRL))
+				targets.push_back(args[args.size() - 1]);
+			else
+				targets.push_back("");
+			break;
+		}
+
+		if (!found) {
+			printf("%s:%d: unsupported instruction %s\n", path, entry.second, name.c_str());
+			return false;
+		}
+
+		program.push_back(inst);
+	}
+
+	for (size_t i = 0; i < program.size(); i++) {
+		if (targets[i].empty())
+			continue;
+
+		auto label = labels.find(targets[i]);
+		if (label == labels.end()) {
+			printf("%s:%d: undefined label %s\n", path, program[i].line, targets[i].c_str());
+			return false;
+		}
+
+		program[i].target = label->second;
+	}
+
+	auto entry = labels.find(ENTRY_POINT);
+	if (entry == labels.end()) {
+		printf("%s: %s not found\n", path, ENTRY_POINT);
+		return false;
+	}
+
+	entry_point = entry->second;
+	return true;
+}
+
+// The decompressor may read a few bytes past the end of its input, but must
+// not write anywhere outside of the output buffer.
+bool Interpreter::_load_byte(uint32_t addr, uint32_t &value) {
+	if ((addr >= output_addr) && (addr < (output_addr + output_size))) {
+		value = output[addr - output_addr];
+		return true;
+	}
+	if ((addr >= input_addr) && (addr < (input_addr + input_size + INPUT_OVERREAD))) {
+		if (addr < (input_addr + input_size))
+			value = input[addr - input_addr];
+		else
+			value = 0xa5; // Padding
+
+		if (addr > max_read)
+			max_read = addr;
+		return true;
+	}
+
+	return false;
+}
+
+bool Interpreter::_store_byte(uint32_t addr, uint32_t value) {
+	if ((addr >= output_addr) && (addr < (output_addr + output_size))) {
+		output[addr - output_addr] = (uint8_t) value;
+		return true;
+	}
+
+	return false;
+}
+
+int Interpreter::run(
+	uint8_t *out, size_t out_size, const uint8_t *in, size_t in_size,
+	std::string &message
+) {
+	// Place the buffers at arbitrary non-overlapping addresses, with the input
+	// deliberately misaligned.
+	input_addr  = 0x80100003;
+	input_size  = in_size;
+	output_addr = 0x80200000;
+	output_size = out_size;
+	input       = (uint8_t *) in;
+	output      = out;
+	max_read    = 0;
+
+	memset(regs, 0xcc, sizeof(regs));
+	regs[0]  = 0;
+	regs[4]  = output_addr;	// $a0
+	regs[5]  = input_addr;	// $a1
+	regs[6]  = in_size;		// $a2
+	regs[31] = 0xfffffff0;	// $ra
+
+	int      pc         = entry_point;
+	int      branch     = -1; // Branch target to jump to after the delay slot
+	bool     ret        = false;
+	int      load_reg   = 0;  // Load pending in the load delay slot
+	uint32_t load_value = 0;
+	char     text[64];
+
+	for (uint64_t steps = 0; steps < MAX_STEPS; steps++) {
+		if ((pc < 0) || (pc >= (int) program.size())) {
+			message = "execution ran past the end of the program";
+			return -1;
+		}
+
+		const Instruction &inst = program[pc];
+		uint32_t rs = regs[inst.rs], rt = regs[inst.rt];
+		uint32_t addr = rs + inst.imm;
+
+		int      dest       = 0;
+		uint32_t result     = 0;
+		int      new_branch = -1;
+		bool     new_ret    = false;
+		int      new_load   = 0;
+		uint32_t new_value  = 0;
+
+		switch (inst.op) {
+			case OP_NOP:
+				break;
+
+			case OP_ADDU:  dest = inst.rd; result = rs + rt; break;
+			case OP_ADDIU: dest = inst.rd; result = rs + inst.imm; break;
+			case OP_SUBU:  dest = inst.rd; result = rs - rt; break;
+			case OP_AND:   dest = inst.rd; result = rs & rt; break;
+			case OP_ANDI:  dest = inst.rd; result = rs & (uint16_t) inst.imm; break;
+			case OP_OR:    dest = inst.rd; result = rs | rt; break;
+			case OP_ORI:   dest = inst.rd; result = rs | (uint16_t) inst.imm; break;
+			case OP_XOR:   dest = inst.rd; result = rs ^ rt; break;
+			case OP_XORI:  dest = inst.rd; result = rs ^ (uint16_t) inst.imm; break;
+			case OP_NOR:   dest = inst.rd; result = ~(rs | rt); break;
+			case OP_SLL:   dest = inst.rd; result = rs << (inst.imm & 31); break;
+			case OP_SRL:   dest = inst.rd; result = rs >> (inst.imm & 31); break;
+			case OP_SRA:   dest = inst.rd; result = (int32_t) rs >> (inst.imm & 31); break;
+			case OP_SLLV:  dest = inst.rd; result = rs << (rt & 31); break;
+			case OP_SRLV:  dest = inst.rd; result = rs >> (rt & 31); break;
+			case OP_SRAV:  dest = inst.rd; result = (int32_t) rs >> (rt & 31); break;
+			case OP_SLT:   dest = inst.rd; result = (int32_t) rs < (int32_t) rt; break;
+			case OP_SLTU:  dest = inst.rd; result = rs < rt; break;
+			case OP_SLTI:  dest = inst.rd; result = (int32_t) rs < inst.imm; break;
+			case OP_SLTIU: dest = inst.rd; result = rs < (uint32_t) inst.imm; break;
+			case OP_LUI:   dest = inst.rd; result = (uint32_t) inst.imm << 16; break;
+			case OP_LI:    dest = inst.rd; result = (uint32_t) inst.imm; break;
+			case OP_MOVE:  dest = inst.rd; result = rs; break;
+
+			case OP_B:    new_branch = inst.target; break;
+			case OP_BEQ:  if (rs == rt) new_branch = inst.target; break;
+			case OP_BNE:  if (rs != rt) new_branch = inst.target; break;
+			case OP_BEQZ: if (!rs) new_branch = inst.target; break;
+			case OP_BNEZ: if (rs) new_branch = inst.target; break;
+			case OP_BGTZ: if ((int32_t) rs >  0) new_branch = inst.target; break;
+			case OP_BGEZ: if ((int32_t) rs >= 0) new_branch = inst.target; break;
+			case OP_BLTZ: if ((int32_t) rs <  0) new_branch = inst.target; break;
+			case OP_BLEZ: if ((int32_t) rs <= 0) new_branch = inst.target; break;
+
+			case OP_JR:
+				if (rs != regs[31]) {
+					message = "jump to an address other than $ra";
+					return -1;
+				}
+
+				new_ret = true;
+				break;
+
+			case OP_LB:
+			case OP_LBU:
+			case OP_LH:
+			case OP_LHU:
+			case OP_LW: {
+				int size =
+					(inst.op == OP_LW) ? 4 :
+					((inst.op == OP_LH) || (inst.op == OP_LHU)) ? 2 : 1;
+
+				if (addr % size) {
+					snprintf(text, sizeof(text), "unaligned load from 0x%08x", addr);
+					message = text;
+					return -1;
+				}
+
+				for (int i = 0; i < size; i++) {
+					uint32_t byte;
+
+					if (!_load_byte(addr + i, byte)) {
+						snprintf(text, sizeof(text), "invalid load from 0x%08x", addr + i);
+						message = text;
+						return -1;
+					}
+
+					new_value |= byte << (i * 8);
+				}
+
+				if (inst.op == OP_LB)
+					new_value = (int8_t) new_value;
+				if (inst.op == OP_LH)
+					new_value = (int16_t) new_value;
+
+				new_load = inst.rd;
+				break;
+			}
+
+			case OP_LWL:
+			case OP_LWR: {
+				// Only the bytes actually merged into the register are loaded.
+				// lwl and lwr can be paired with a load still in the delay
+				// slot, in which case they merge with its result.
+				uint32_t base  = addr & ~3;
+				int      shift = (addr & 3) * 8;
+				int      first = (inst.op == OP_LWL) ? 0 : (addr & 3);
+				int      last  = (inst.op == OP_LWL) ? (addr & 3) : 3;
+				uint32_t word  = 0;
+
+				for (int i = first; i <= last; i++) {
+					uint32_t byte;
+
+					if (!_load_byte(base + i, byte)) {
+						snprintf(text, sizeof(text), "invalid load from 0x%08x", base + i);
+						message = text;
+						return -1;
+					}
+
+					word |= byte << (i * 8);
+				}
+
+				uint32_t value = (load_reg == inst.rd) ? load_value : regs[inst.rd];
+
+				if (inst.op == OP_LWL)
+					new_value = (value & (0x00ffffff >> shift)) | (word << (24 - shift));
+				else
+					new_value = (value & ~(0xffffffff >> shift)) | (word >> shift);
+
+				new_load = inst.rd;
+				break;
+			}
+
+			case OP_SB:
+			case OP_SH:
+			case OP_SW:
+			case OP_SWL:
+			case OP_SWR: {
+				uint32_t base  = addr;
+				uint32_t value = rt;
+				int      first = 0, last;
+
+				switch (inst.op) {
+					case OP_SB:
+						last = 0;
+						break;
+
+					case OP_SH:
+						last = 1;
+						break;
+
+					case OP_SW:
+						last = 3;
+						break;
+
+					case OP_SWL:
+						base  = addr & ~3;
+						value = rt >> (24 - (addr & 3) * 8);
+						last  = addr & 3;
+						break;
+
+					default:
+						base  = addr & ~3;
+						value = rt << ((addr & 3) * 8);
+						first = addr & 3;
+						last  = 3;
+						break;
+				}
+
+				if (((inst.op == OP_SH) || (inst.op == OP_SW)) && (addr % (last + 1))) {
+					snprintf(text, sizeof(text), "unaligned store to 0x%08x", addr);
+					message = text;
+					return -1;
+				}
+
+				for (int i = first; i <= last; i++) {
+					if (!_store_byte(base + i, value >> (i * 8))) {
+						snprintf(text, sizeof(text), "invalid store to 0x%08x", base + i);
+						message = text;
+						return -1;
+					}
+				}
+				break;
+			}
+		}
+
+		// Write back the result, then the load issued by the previous
+		// instruction (unless this instruction overwrote the same register).
+		if (dest)
+			regs[dest] = result;
+		if (load_reg && (load_reg != dest))
+			regs[load_reg] = load_value;
+
+		load_reg   = new_load;
+		load_value = new_value;
+
+		// Take the branch issued by the previous instruction, if any.
+		if (ret) {
+			if (load_reg)
+				regs[load_reg] = load_value;
+
+			return (int32_t) regs[2]; // $v0
+		}
+
+		pc     = (branch >= 0) ? branch : (pc + 1);
+		branch = new_branch;
+		ret    = new_ret;
+	}
+
+	message = "too many instructions executed";
+	return -1;
+}
+
+/* Test cases */
+
+static uint32_t _seed = 1;
+
+static uint32_t _random(void) {
+	_seed = _seed * 1103515245 + 12345;
+	return _seed >> 8;
+}
+
+typedef void (*Generator)(std::vector<uint8_t> &data, size_t size);
+
+static void _gen_random(std::vector<uint8_t> &data, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		data.push_back(_random());
+}
+
+static void _gen_text(std::vector<uint8_t> &data, size_t size) {
+	static const char *const words[] = {
+		"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ",
+		"PlayStation ", "PSn00bSDK ", "\n", "libpsn00b ", "0123456789 "
+	};
+
+	while (data.size() < size) {
+		const char *word = words[_random() % 13];
+		data.insert(data.end(), word, word + strlen(word));
+	}
+
+	data.resize(size);
+}
+
+// Long runs of a single byte produce maximum length matches whose source
+// overlaps the data being written.
+static void _gen_runs(std::vector<uint8_t> &data, size_t size) {
+	while (data.size() < size) {
+		size_t length = 1 + _random() % 2000;
+		data.insert(data.end(), length, (uint8_t) _random());
+	}
+
+	data.resize(size);
+}
+
+// Short repeating patterns produce overlapping matches with offsets of 1 to 8
+// bytes, exercising the byte-by-byte copy path.
+static void _gen_patterns(std::vector<uint8_t> &data, size_t size) {
+	while (data.size() < size) {
+		uint8_t pattern[8];
+		size_t  period = 1 + _random() % 8;
+		size_t  length = 1 + _random() % 600;
+
+		for (size_t i = 0; i < period; i++)
+			pattern[i] = _random();
+		for (size_t i = 0; i < length; i++)
+			data.push_back(pattern[i % period]);
+		if (_random() % 2)
+			data.push_back(_random());
+	}
+
+	data.resize(size);
+}
+
+// Random data mixed with copies of earlier data at random distances, to cover
+// all offset slots.
+static void _gen_mixed(std::vector<uint8_t> &data, size_t size) {
+	while (data.size() < size) {
+		if (data.size() < 16 || (_random() % 3) == 0) {
+			data.push_back(_random());
+			continue;
+		}
+
+		size_t offset = 1 + _random() % data.size();
+		size_t length = 3 + _random() % 300;
+
+		for (size_t i = 0; i < length; i++)
+			data.push_back(data[data.size() - offset]);
+	}
+
+	data.resize(size);
+}
+
+static int _max_overread = 0;
+
+static bool _run_case(
+	Interpreter &interp, const char *name, const std::vector<uint8_t> &data,
+	int level
+) {
+	std::vector<uint8_t> packed(LZP_COMPRESS_BOUND(data.size()));
+	std::vector<uint8_t> expected(data.size() + 16, 0x5a);
+	std::vector<uint8_t> actual(data.size() + 16, 0x5a);
+
+	// lzCompress() primes its hash tables by reading a few bytes from the
+	// input even if it is shorter than that, so it must be padded.
+	std::vector<uint8_t> source(data);
+	source.resize(data.size() + 64, 0);
+
+	int packed_size = lzCompress(packed.data(), source.data(), data.size(), level);
+	if (packed_size < 0) {
+		printf("FAIL %s: lzCompress() returned %d\n", name, packed_size);
+		return false;
+	}
+
+	// The asm decoder is given an output buffer of the exact size, so that
+	// any write past the end is detected.
+	std::string message;
+	int expected_size = lzDecompress(expected.data(), packed.data(), packed_size);
+	int actual_size   = interp.run(actual.data(), data.size(), packed.data(), packed_size, message);
+
+	if (!message.empty()) {
+		printf("FAIL %s (%d bytes, level %d): %s\n", name, (int) data.size(), level, message.c_str());
+		return false;
+	}
+	if (interp.overread() > _max_overread)
+		_max_overread = interp.overread();
+	if (expected_size != actual_size) {
+		printf(
+			"FAIL %s (%d bytes, level %d): returned %d, expected %d\n",
+			name, (int) data.size(), level, actual_size, expected_size
+		);
+		return false;
+	}
+	if (!std::equal(data.begin(), data.end(), actual.begin())) {
+		printf("FAIL %s (%d bytes, level %d): output mismatch\n", name, (int) data.size(), level);
+		return false;
+	}
+	if (!std::equal(data.begin(), data.end(), expected.begin())) {
+		printf("FAIL %s (%d bytes, level %d): C decoder output mismatch\n", name, (int) data.size(), level);
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, const char **argv) {
+	if (argc < 2) {
+		printf("Usage: lzp_asm_test <path to decompress.s>\n");
+		return 1;
+	}
+
+	Interpreter interp;
+	if (!interp.load(argv[1]))
+		return 1;
+
+	static const struct {
+		const char *name;
+		Generator  func;
+	} generators[] = {
+		{ "random",   &_gen_random   },
+		{ "text",     &_gen_text     },
+		{ "runs",     &_gen_runs     },
+		{ "patterns", &_gen_patterns },
+		{ "mixed",    &_gen_mixed    }
+	};
+	static const size_t sizes[] = {
+		0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 64, 255, 1000, 4097, 65536, 200000
+	};
+
+	int total = 0, failed = 0;
+
+	// Use smaller hash tables than the host defaults; clearing them takes far
+	// longer than compressing any of the test inputs.
+	lzSetHashSizes(17, 12, 14);
+
+	for (auto &gen : generators) {
+		for (size_t size : sizes) {
+			for (int level = LZP_COMPRESS_FAST; level <= LZP_COMPRESS_OPTIMAL; level++) {
+				std::vector<uint8_t> data;
+				gen.func(data, size);
+
+				total++;
+				if (!_run_case(interp, gen.name, data, level))
+					failed++;
+			}
+		}
+	}
+
+	// Larger windows change the number of offset bits in the stream.
+	for (int window = 17; window <= 20; window++) {
+		std::vector<uint8_t> data;
+
+		lzSetHashSizes(window, 12, 14);
+		_gen_mixed(data, 300000);
+
+		total++;
+		if (!_run_case(interp, "window", data, LZP_COMPRESS_MAX))
+			failed++;
+	}
+	lzResetHashSizes();
+
+	printf("%d of %d cases passed\n", total - failed, total);
+	printf("Maximum input overread: %d bytes\n", _max_overread);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * PSn00bSDK quaternion library host test
+ * (C) 2023 Lameguy64, spicyjpeg - MPL licensed
+ *
+ * quat.c is plain C, so it can be built and checked on the host against a
+ * floating-point reference. SquareRoot0() and ApplyMatrixN() are implemented
+ * in assembly in libpsn00b and are replaced here with host equivalents.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <psxgte.h>
+
+#define NUM_SAMPLES		20000
+#define ANGLE_TO_RAD	(3.14159265358979323846 / 2048.0)
+
+// Maximum allowed errors, in 4.12 fixed-point units.
+#define MAX_MATRIX_ERROR	34
+#define MAX_SLERP_ERROR		18
+#define MAX_MUL_ERROR		2
+#define MAX_AXIS_ERROR		8
+#define MAX_NLERP_ERROR		3
+#define MAX_NORMAL_ERROR	2
+
+// The matrix of a product also accumulates the rounding errors of both
+// quaternions, so it's checked against a looser bound.
+#define MAX_MUL_MATRIX_ERROR	52
+
+/* Host replacements for assembly functions */
+
+int SquareRoot0(int v) {
+	return (int) sqrt((double) v);
+}
+
+void ApplyMatrixN(MATRIX *m, SVECTOR *v0, SVECTOR *v1, int n) {
+	for (; n; n--, v0++, v1++) {
+		int x = v0->vx, y = v0->vy, z = v0->vz;
+
+		v1->vx = (m->m[0][0] * x + m->m[0][1] * y + m->m[0][2] * z) >> 12;
+		v1->vy = (m->m[1][0] * x + m->m[1][1] * y + m->m[1][2] * z) >> 12;
+		v1->vz = (m->m[2][0] * x + m->m[2][1] * y + m->m[2][2] * z) >> 12;
+	}
+}
+
+/* Reference implementations */
+
+static void _mul3(double a[3][3], double b[3][3], double out[3][3]) {
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			out[i][j] = 0.0;
+
+			for (int k = 0; k < 3; k++)
+				out[i][j] += a[i][k] * b[k][j];
+		}
+	}
+}
+
+// Same rotation order as RotMatrix() (X * Y * Z).
+static void _rot_matrix(const SVECTOR *r, double out[3][3]) {
+	double a = r->vx * ANGLE_TO_RAD;
+	double b = r->vy * ANGLE_TO_RAD;
+	double c = r->vz * ANGLE_TO_RAD;
+
+	double x[3][3] = {
+		{ 1.0,    0.0,     0.0    },
+		{ 0.0,    cos(a), -sin(a) },
+		{ 0.0,    sin(a),  cos(a) }
+	};
+	double y[3][3] = {
+		{  cos(b), 0.0,    sin(b) },
+		{  0.0,    1.0,    0.0    },
+		{ -sin(b), 0.0,    cos(b) }
+	};
+	double z[3][3] = {
+		{ cos(c), -sin(c), 0.0    },
+		{ sin(c),  cos(c), 0.0    },
+		{ 0.0,     0.0,    1.0    }
+	};
+	double xy[3][3];
+
+	_mul3(x, y, xy);
+	_mul3(xy, z, out);
+}
+
+static void _slerp(const QUATERNION *q0, const QUATERNION *q1, int t, double out[4]) {
+	double a[4] = { q0->vx, q0->vy, q0->vz, q0->vw };
+	double b[4] = { q1->vx, q1->vy, q1->vz, q1->vw };
+	double la = 0.0, lb = 0.0, dot = 0.0;
+
+	for (int i = 0; i < 4; i++) {
+		la += a[i] * a[i];
+		lb += b[i] * b[i];
+	}
+
+	la = sqrt(la);
+	lb = sqrt(lb);
+
+	for (int i = 0; i < 4; i++) {
+		a[i] /= la;
+		b[i] /= lb;
+		dot  += a[i] * b[i];
+	}
+
+	if (dot < 0.0) {
+		dot = -dot;
+
+		for (int i = 0; i < 4; i++)
+			b[i] = -b[i];
+	}
+
+	double angle = acos(fmin(dot, 1.0));
+	double f     = t / 4096.0;
+
+	for (int i = 0; i < 4; i++) {
+		if (angle < 1e-6)
+			out[i] = a[i];
+		else
+			out[i] = (sin((1.0 - f) * angle) * a[i] + sin(f * angle) * b[i])
+				/ sin(angle);
+	}
+}
+
+static void _to_double(const QUATERNION *q, double out[4]) {
+	out[0] = q->vx / 4096.0;
+	out[1] = q->vy / 4096.0;
+	out[2] = q->vz / 4096.0;
+	out[3] = q->vw / 4096.0;
+}
+
+static void _normalize(double q[4]) {
+	double len = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	for (int i = 0; i < 4; i++)
+		q[i] /= len;
+}
+
+static void _mul(const double a[4], const double b[4], double out[4]) {
+	out[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+	out[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+	out[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+	out[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+}
+
+// Returns the largest difference between a quaternion and a reference, in
+// 4.12 fixed-point units.
+static int _quat_error(const QUATERNION *q, const double ref[4]) {
+	const int16_t result[4] = { q->vx, q->vy, q->vz, q->vw };
+	int           max_error = 0;
+
+	for (int i = 0; i < 4; i++) {
+		int error = abs(result[i] - (int) lround(ref[i] * 4096.0));
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	return max_error;
+}
+
+static void _random_angles(SVECTOR *r) {
+	r->vx = rand() % 4096;
+	r->vy = rand() % 4096;
+	r->vz = rand() % 4096;
+	r->pad = 0;
+}
+
+static void _random_axis(SVECTOR *axis) {
+	double v[3], len;
+
+	do {
+		v[0] = rand() / (double) RAND_MAX * 2.0 - 1.0;
+		v[1] = rand() / (double) RAND_MAX * 2.0 - 1.0;
+		v[2] = rand() / (double) RAND_MAX * 2.0 - 1.0;
+		len  = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	} while ((len < 0.1) || (len > 1.0));
+
+	axis->vx  = (int16_t) lround(v[0] / len * 4096.0);
+	axis->vy  = (int16_t) lround(v[1] / len * 4096.0);
+	axis->vz  = (int16_t) lround(v[2] / len * 4096.0);
+	axis->pad = 0;
+}
+
+/* Tests */
+
+static int _test_euler_to_matrix(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    r;
+		QUATERNION q;
+		MATRIX     m;
+		double     ref[3][3];
+
+		_random_angles(&r);
+		QuatFromEuler(&r, &q);
+		QuatToMatrix(&q, &m);
+		_rot_matrix(&r, ref);
+
+		for (int j = 0; j < 9; j++) {
+			int error = abs(m.m[j / 3][j % 3] - (int) lround(ref[j / 3][j % 3] * 4096.0));
+
+			if (error > max_error)
+				max_error = error;
+		}
+	}
+
+	printf("QuatFromEuler() + QuatToMatrix(): max error %d\n", max_error);
+	return (max_error <= MAX_MATRIX_ERROR);
+}
+
+static int _test_slerp(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    r0, r1;
+		QUATERNION q0, q1, q2;
+		double     ref[4];
+
+		_random_angles(&r0);
+		_random_angles(&r1);
+		QuatFromEuler(&r0, &q0);
+		QuatFromEuler(&r1, &q1);
+
+		int t = rand() % 4097;
+
+		QuatSlerp(&q0, &q1, t, &q2);
+		_slerp(&q0, &q1, t, ref);
+
+		int error = _quat_error(&q2, ref);
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	printf("QuatSlerp(): max error %d\n", max_error);
+	return (max_error <= MAX_SLERP_ERROR);
+}
+
+// Quaternions less than SLERP_MIN_ANGLE apart (2.8 degrees in quaternion
+// space, i.e. a 5.6 degree rotation) make QuatSlerp() fall back to
+// QuatNlerp(), whose result should still match a real slerp closely.
+static int _test_slerp_small_angle(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    r0, r1, axis;
+		QUATERNION q0, q1, q2, delta;
+		double     ref[4];
+
+		_random_angles(&r0);
+		_random_angles(&r1);
+		QuatFromEuler(&r0, &q0);
+		_random_axis(&axis);
+		QuatAxisAngle(&axis, rand() % 64, &delta);
+		QuatMul(&q0, &delta, &q1);
+
+		int t = rand() % 4097;
+
+		QuatSlerp(&q0, &q1, t, &q2);
+		_slerp(&q0, &q1, t, ref);
+
+		int error = _quat_error(&q2, ref);
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	printf("QuatSlerp() (small angles): max error %d\n", max_error);
+	return (max_error <= MAX_SLERP_ERROR);
+}
+
+static int _test_mul(void) {
+	int max_error = 0, max_matrix_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    r0, r1;
+		QUATERNION q0, q1, q2;
+		MATRIX     m;
+		double     a[4], b[4], ref[4], m0[3][3], m1[3][3], ref_m[3][3];
+
+		_random_angles(&r0);
+		_random_angles(&r1);
+		QuatFromEuler(&r0, &q0);
+		QuatFromEuler(&r1, &q1);
+		QuatMul(&q0, &q1, &q2);
+
+		_to_double(&q0, a);
+		_to_double(&q1, b);
+		_mul(a, b, ref);
+
+		int error = _quat_error(&q2, ref);
+
+		if (error > max_error)
+			max_error = error;
+
+		// The product must also represent the rotation of q1 followed by the
+		// rotation of q0, as documented.
+		QuatToMatrix(&q2, &m);
+		_rot_matrix(&r0, m0);
+		_rot_matrix(&r1, m1);
+		_mul3(m0, m1, ref_m);
+
+		for (int j = 0; j < 9; j++) {
+			error = abs(m.m[j / 3][j % 3] - (int) lround(ref_m[j / 3][j % 3] * 4096.0));
+
+			if (error > max_matrix_error)
+				max_matrix_error = error;
+		}
+	}
+
+	printf(
+		"QuatMul(): max error %d, max matrix error %d\n", max_error,
+		max_matrix_error
+	);
+	return (max_error <= MAX_MUL_ERROR) && (max_matrix_error <= MAX_MUL_MATRIX_ERROR);
+}
+
+static int _test_axis_angle(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    axis;
+		QUATERNION q;
+		double     ref[4];
+
+		_random_axis(&axis);
+
+		int angle = rand() % 4096;
+
+		QuatAxisAngle(&axis, angle, &q);
+
+		double half = angle * ANGLE_TO_RAD / 2.0;
+
+		ref[0] = axis.vx / 4096.0 * sin(half);
+		ref[1] = axis.vy / 4096.0 * sin(half);
+		ref[2] = axis.vz / 4096.0 * sin(half);
+		ref[3] = cos(half);
+		_normalize(ref);
+
+		int error = _quat_error(&q, ref);
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	printf("QuatAxisAngle(): max error %d\n", max_error);
+	return (max_error <= MAX_AXIS_ERROR);
+}
+
+static int _test_nlerp(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		SVECTOR    r0, r1;
+		QUATERNION q0, q1, q2;
+		double     a[4], b[4], ref[4], dot = 0.0;
+
+		_random_angles(&r0);
+		_random_angles(&r1);
+		QuatFromEuler(&r0, &q0);
+		QuatFromEuler(&r1, &q1);
+
+		int t = rand() % 4097;
+
+		QuatNlerp(&q0, &q1, t, &q2);
+
+		_to_double(&q0, a);
+		_to_double(&q1, b);
+
+		for (int j = 0; j < 4; j++)
+			dot += a[j] * b[j];
+		for (int j = 0; j < 4; j++)
+			ref[j] = a[j] + ((dot < 0.0) ? -b[j] - a[j] : b[j] - a[j]) * t / 4096.0;
+
+		_normalize(ref);
+
+		int error = _quat_error(&q2, ref);
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	printf("QuatNlerp(): max error %d\n", max_error);
+	return (max_error <= MAX_NLERP_ERROR);
+}
+
+static int _test_normal(void) {
+	int max_error = 0;
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		QUATERNION q0, q1;
+		double     ref[4];
+
+		// Components are kept small enough for the squared length not to
+		// overflow.
+		q0.vx = (rand() % 32001) - 16000;
+		q0.vy = (rand() % 32001) - 16000;
+		q0.vz = (rand() % 32001) - 16000;
+		q0.vw = (rand() % 32001) - 16000;
+
+		if (!q0.vx && !q0.vy && !q0.vz && !q0.vw)
+			continue;
+
+		QuatNormal(&q0, &q1);
+		_to_double(&q0, ref);
+		_normalize(ref);
+
+		int error = _quat_error(&q1, ref);
+
+		if (error > max_error)
+			max_error = error;
+	}
+
+	// A null quaternion can't be normalized and is turned into the identity.
+	QUATERNION zero = { 0, 0, 0, 0 };
+	QuatNormal(&zero, &zero);
+
+	int identity = !zero.vx && !zero.vy && !zero.vz && (zero.vw == ONE);
+
+	printf(
+		"QuatNormal(): max error %d, null quaternion %s\n", max_error,
+		identity ? "OK" : "not identity"
+	);
+	return (max_error <= MAX_NORMAL_ERROR) && identity;
+}
+
+int main(int argc, const char **argv) {
+	int passed = 1;
+
+	srand(1);
+	passed &= _test_euler_to_matrix();
+	passed &= _test_slerp();
+	passed &= _test_slerp_small_angle();
+	passed &= _test_mul();
+	passed &= _test_axis_angle();
+	passed &= _test_nlerp();
+	passed &= _test_normal();
+
+	printf(passed ? "All tests passed\n" : "Some tests failed\n");
+	return passed ? 0 : 1;
+}